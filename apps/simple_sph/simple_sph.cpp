@@ -32,6 +32,18 @@
  #undef SPHLATCH_TRACK_TMAX
 #endif
 
+// the ballistic particles are left out of the tree,
+// so it has to be built anew for every derivation
+#if !defined SPHLATCH_GRAVITY || defined SPHLATCH_PERSISTENT_TREE
+ #undef SPHLATCH_BALLISTIC
+#endif
+
+#ifdef SPHLATCH_BALLISTIC
+ #ifndef SPHLATCH_FIND_CLUMPS
+  #define SPHLATCH_FIND_CLUMPS
+ #endif
+#endif
+
 #ifdef SPHLATCH_ESCAPEES
  #ifndef SPHLATCH_FIND_CLUMPS
   #define SPHLATCH_FIND_CLUMPS
@@ -44,6 +56,38 @@
  #endif
 #endif
 
+// the symmetric sums have no pair function for the miscible
+// formulation and work on the pairs of the neighbour lists
+#ifdef SPHLATCH_MISCIBLE
+ #undef SPHLATCH_SPH_PAIRS
+#endif
+
+#ifdef SPHLATCH_SPH_PAIRS
+ #ifndef SPHLATCH_NEIGHCACHE
+  #define SPHLATCH_NEIGHCACHE
+ #endif
+#endif
+
+// the tree is only frozen for the walks which need it: the neighbour
+// lists, the grouped walks, the higher multipoles, the fast multipole
+// method and the subset trees of the clumps. the other walks run on
+// the dynamic tree, where the time of Tree.freeze() is hardly won back
+// (see tests/dynamic_tree/frozenWalk)
+#if defined SPHLATCH_NEIGHCACHE || defined SPHLATCH_NEIGH_GROUPSIZE || \
+    defined SPHLATCH_GRAVITY_GROUPSIZE || defined SPHLATCH_GRAVITY_FMM || \
+    defined SPHLATCH_GRAVITY_OCTUPOLES || \
+    defined SPHLATCH_GRAVITY_HEXADECAPOLES
+ #ifndef SPHLATCH_FROZEN_TREE
+  #define SPHLATCH_FROZEN_TREE
+ #endif
+#endif
+
+#if defined SPHLATCH_GRAVITY && defined SPHLATCH_FIND_CLUMPS
+ #ifndef SPHLATCH_FROZEN_TREE
+  #define SPHLATCH_FROZEN_TREE
+ #endif
+#endif
+
 
 #include "typedefs.h"
 typedef sphlatch::fType             fType;
@@ -178,8 +222,8 @@ public:
 #ifdef SPHLATCH_TRACK_ACCP
    vect3dT accp;
 #endif
-#if defined SPHLATCH_FIND_CLUMPS && defined SPHLATCH_GRAVITY
-   fType morig;
+#ifdef SPHLATCH_BALLISTIC
+   bool ballistic;
 #endif
 
    ioVarLT getLoadVars()
@@ -306,8 +350,31 @@ typedef sphlatch::ParticleSet<partT>           partSetT;
 
 #ifdef SPHLATCH_GRAVITY
  #include "bhtree_worker_grav.cpp"
-typedef sphlatch::fixThetaMAC                  macT;
-typedef sphlatch::GravityWorker<macT, partT>   gravT;
+ #if defined SPHLATCH_GRAVITY_RELATIVEMAC
+typedef sphlatch::relativeMAC                  macT;
+ #elif defined SPHLATCH_GRAVITY_BMAXMAC
+typedef sphlatch::bmaxMAC                      macT;
+ #else
+typedef sphlatch::thetaMAC                     macT;
+ #endif
+ #if defined SPHLATCH_GRAVITY_HEXADECAPOLES
+typedef sphlatch::hexadecapoles                mpT;
+ #elif defined SPHLATCH_GRAVITY_OCTUPOLES
+typedef sphlatch::octupoles                    mpT;
+ #else
+typedef sphlatch::quadrupoles                  mpT;
+ #endif
+ #ifdef SPHLATCH_GRAVITY_MIXEDPREC
+typedef float                                  gravRealT;
+ #else
+typedef fType                                  gravRealT;
+ #endif
+ #ifdef SPHLATCH_GRAVITY_FMM
+  #include "bhtree_worker_fmm.cpp"
+typedef sphlatch::FMMWorker<partT>                             gravT;
+ #else
+typedef sphlatch::GravityWorker<macT, partT, mpT, gravRealT>   gravT;
+ #endif
 #endif
 
 #include "sph_algorithms.cpp"
@@ -322,6 +389,18 @@ typedef sphlatch::SPHsumWorker<densT, partT>     densSumT;
 #endif
 typedef sphlatch::accPowSum<partT, krnlT>        accPowT;
 typedef sphlatch::SPHsumWorker<accPowT, partT>   accPowSumT;
+#ifdef SPHLATCH_NEIGHCACHE
+typedef sphlatch::NeighListCache<partT>          neighCacheT;
+#endif
+#ifdef SPHLATCH_SPH_PAIRS
+ #include "bhtree_worker_sphpair.cpp"
+ #ifndef SPHLATCH_INTEGRATERHO
+typedef sphlatch::densPairSum<partT, krnlT>           densPairT;
+typedef sphlatch::SPHpairWorker<densPairT, partT>     densPairSumT;
+ #endif
+typedef sphlatch::accPowPairSum<partT, krnlT>         accPowPairT;
+typedef sphlatch::SPHpairWorker<accPowPairT, partT>   accPowPairSumT;
+#endif
 
 #include "bhtree_worker_cost.cpp"
 typedef sphlatch::CostWorker<partT>              costT;
@@ -358,11 +437,119 @@ using sphlatch::addToCOM;
 // particles are global
 partSetT parts;
 
+#ifdef SPHLATCH_NEIGHCACHE
+// the neighbour lists of the SPH sums, kept over the derivations
+neighCacheT neighCache;
+#endif
+
 #ifdef SPHLATCH_FIND_CLUMPS
 clumpsT clumps;
 #endif
 
-void derive()
+#ifdef SPHLATCH_BALLISTIC
+ #include "ballistic_particles.cpp"
+typedef sphlatch::BallisticParticles<partT>   ballisticT;
+
+// the ballistic particles and the tree particles
+ballisticT ballistic;
+
+///
+/// flag the ballistic particles with the clumps of the last save(),
+/// the tree is then filled with the other particles
+///
+void flagBallistic()
+{
+   logT& Logger(logT::instance());
+
+ #ifdef SPHLATCH_NEIGHCACHE
+   // the lists do not contain the ballistic particles
+   if (ballistic.flag(parts, clumps, parts.attributes["time"],
+                      parts.attributes["ballisticfactor"]))
+      neighCache.invalidate();
+ #else
+   ballistic.flag(parts, clumps, parts.attributes["time"],
+                  parts.attributes["ballisticfactor"]);
+ #endif
+   Logger.stream << ballistic.getNoBallistic() << " ballistic particles";
+   Logger.flushStream();
+}
+#endif
+
+#ifdef SPHLATCH_PERSISTENT_TREE
+bool treeFilled = false;
+#endif
+
+///
+/// fill the particles into the tree. if the tree is kept between
+/// the derivations, the particles are only filled in once and
+/// the next Tree.update() moves them to their new positions. the
+/// root cell grows, when particles leave it.
+///
+void fillTree()
+{
+   treeT& Tree(treeT::instance());
+   logT&  Logger(logT::instance());
+
+#ifdef SPHLATCH_PERSISTENT_TREE
+   if (treeFilled)
+   {
+      Logger << "kept tree";
+      return;
+   }
+   treeFilled = true;
+#endif
+
+#ifdef SPHLATCH_BALLISTIC
+   Tree.setExtent(ballistic.treeParts.getBox() * 1.1);
+   Tree.build(ballistic.treeParts);
+#else
+   Tree.setExtent(parts.getBox() * 1.1);
+   Tree.build(parts);
+#endif
+   Logger << "created tree";
+}
+
+#ifdef SPHLATCH_GRAVITY
+///
+/// the opening criterion of the tree walks, configured by the
+/// attributes gravtheta and, for the relative criterion, gravalpha
+///
+macT getMAC()
+{
+   const fType theta = parts.attributes["gravtheta"];
+
+ #ifdef SPHLATCH_GRAVITY_RELATIVEMAC
+   return(macT(theta, parts.attributes["gravalpha"],
+               parts.attributes["gravconst"]));
+ #else
+   return(macT(theta));
+ #endif
+}
+
+ #ifdef SPHLATCH_FIND_CLUMPS
+///
+/// selects the particles of clump <cid> for the subset trees
+///
+class clumpSelector {
+public:
+   clumpSelector(const int _cid) : cid(_cid) { }
+
+   bool operator()(const sphlatch::treeghoPtrT _part) const
+   {
+      return(static_cast<partT*>(_part)->clumpid == cid);
+   }
+
+private:
+   const int cid;
+};
+ #endif
+#endif
+
+///
+/// with <_withPot> the gravitational potential is calculated in
+/// the same walk as the acceleration, for the energies of save()
+///
+void derive(const bool _withPot = false)
 {
    treeT& Tree(treeT::instance());
    logT&  Logger(logT::instance());
@@ -371,8 +558,6 @@ void derive()
 
    const size_t nop = parts.getNop();
 
-   Tree.setExtent(parts.getBox() * 1.1);
-
    // renormalize
    fType totCost = 0.;
    for (size_t i = 0; i < nop; i++)
@@ -394,11 +579,16 @@ void derive()
          costi = minCost;
    }
 
-   for (size_t i = 0; i < nop; i++)
-      Tree.insertPart(parts[i]);
-   Logger << "created tree";
+#ifdef SPHLATCH_BALLISTIC
+   flagBallistic();
+#endif
+   fillTree();
 
    Tree.update(0.8, 1.2);
+#ifdef SPHLATCH_FROZEN_TREE
+   // the cells are kept, their slabs are reused by the next build
+   Tree.freeze();
+#endif
 
    treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
    const int           noCZbottomLoc = CZbottomLoc.size();
@@ -409,19 +599,59 @@ void derive()
    //const size_t nop = parts.getNop();
    for (size_t i = 0; i < nop; i++)
    {
+#ifdef SPHLATCH_GRAVITY_RELATIVEMAC
+      parts[i].aold = sqrt(dot(parts[i].acc, parts[i].acc));
+#endif
       parts[i].acc = 0., 0., 0.;
 #ifdef SPHLATCH_TIMEDEP_ENERGY
       parts[i].dudt = 0.;
+#endif
+#ifdef SPHLATCH_BALLISTIC
+      // the SPH sums skip the ballistic particles
+      if (parts[i].ballistic)
+      {
+ #ifdef SPHLATCH_VELDIV
+         parts[i].divv = 0.;
+ #endif
+ #ifdef SPHLATCH_INTEGRATERHO
+         parts[i].drhodt = 0.;
+ #endif
+ #ifdef SPHLATCH_TRACK_UAV
+         parts[i].dudtav = 0.;
+ #endif
+ #ifdef SPHLATCH_TRACK_ACCP
+         parts[i].accp = 0., 0., 0.;
+ #endif
+      }
 #endif
    }
 
 #ifdef SPHLATCH_GRAVITY
    const fType G = parts.attributes["gravconst"];
+ #ifdef SPHLATCH_GRAVITY_FMM
    gravT       gravWorker(&Tree, G);
- #pragma omp parallel for firstprivate(gravWorker)
+ #else
+   gravT       gravWorker(&Tree, G, getMAC());
+ #endif
+ #ifdef SPHLATCH_GRAVITY_GROUPSIZE
+   gravWorker.setGroupSize(SPHLATCH_GRAVITY_GROUPSIZE);
+ #endif
+ #ifdef SPHLATCH_GRAVITY_FMM
+   // one traversal of the whole tree, parallel inside
+   gravWorker.calcAcc(CZbottomLoc, _withPot);
+ #else
+  #pragma omp parallel for firstprivate(gravWorker)
    for (int i = 0; i < noCZbottomLoc; i++)
-      gravWorker.calcAcc(CZbottomLoc[i]);
-   Logger << "Tree.calcAcc()";
+      gravWorker.calcAcc(CZbottomLoc[i], _withPot);
+ #endif
+   if (_withPot)
+      Logger << "Tree.calcAcc() with potential";
+   else
+      Logger << "Tree.calcAcc()";
+ #ifdef SPHLATCH_BALLISTIC
+   ballistic.calcAcc(parts, clumps, parts.attributes["time"], G, _withPot);
+   Logger << "ballistic.calcAcc()";
+ #endif
 #endif
 
 #ifdef SPHLATCH_TIMEDEP_SMOOTHING
@@ -433,11 +663,41 @@ void derive()
          parts[i].h = hmin;
 #endif
 
+#ifdef SPHLATCH_NEIGHCACHE
+   if (neighCache.isValid(parts))
+      Logger << "kept neighbour lists";
+   else
+   {
+ #ifdef SPHLATCH_SPH_PAIRS
+      neighCache.buildPairs(Tree, CZbottomLoc, parts);
+      Logger.stream << "neighCache.buildPairs() -> "
+                    << neighCache.pairNeigh.size() << " pairs";
+ #else
+      neighCache.build(Tree, CZbottomLoc, parts);
+      Logger.stream << "neighCache.build() -> " << neighCache.neigh.size()
+                    << " neighbours";
+ #endif
+      Logger.flushStream();
+   }
+#endif
+
 #ifndef SPHLATCH_INTEGRATERHO
+ #ifdef SPHLATCH_SPH_PAIRS
+   densPairSumT densWorker(&Tree);
+   densWorker(CZbottomLoc, neighCache);
+ #else
    densSumT densWorker(&Tree);
- #pragma omp parallel for firstprivate(densWorker)
+  #ifdef SPHLATCH_NEIGH_GROUPSIZE
+   densWorker.setGroupSize(SPHLATCH_NEIGH_GROUPSIZE);
+  #endif
+  #pragma omp parallel for firstprivate(densWorker)
    for (int i = 0; i < noCZbottomLoc; i++)
+  #ifdef SPHLATCH_NEIGHCACHE
+      densWorker(CZbottomLoc[i], neighCache);
+  #else
       densWorker(CZbottomLoc[i]);
+  #endif
+ #endif
    Logger << "Tree.densWorker()";
 #endif
 
@@ -467,6 +727,10 @@ void derive()
    eosT& EOS(eosT::instance());
    for (size_t i = 0; i < nop; i++)
    {
+#ifdef SPHLATCH_BALLISTIC
+      if (parts[i].ballistic)
+         continue;
+#endif
       EOS(parts[i]);
 
 // FIXME: include ideal gas EOS for certain materials
@@ -492,10 +756,22 @@ void derive()
 #ifdef SPHLATCH_TIMEDEP_ENERGY
 #endif
 
+#ifdef SPHLATCH_SPH_PAIRS
+   accPowPairSumT accPowWorker(&Tree);
+   accPowWorker(CZbottomLoc, neighCache);
+#else
    accPowSumT accPowWorker(&Tree);
-#pragma omp parallel for firstprivate(accPowWorker)
+ #ifdef SPHLATCH_NEIGH_GROUPSIZE
+   accPowWorker.setGroupSize(SPHLATCH_NEIGH_GROUPSIZE);
+ #endif
+ #pragma omp parallel for firstprivate(accPowWorker)
    for (int i = 0; i < noCZbottomLoc; i++)
+ #ifdef SPHLATCH_NEIGHCACHE
+      accPowWorker(CZbottomLoc[i], neighCache);
+ #else
       accPowWorker(CZbottomLoc[i]);
+ #endif
+#endif
    Logger << "Tree.accPowWorker()";
 
 #ifdef SPHLATCH_VELDIV
@@ -506,7 +782,16 @@ void derive()
 
 #ifdef SPHLATCH_TIMEDEP_SMOOTHING
    for (size_t i = 0; i < nop; i++)
+   {
+ #ifdef SPHLATCH_BALLISTIC
+      if (parts[i].ballistic)
+      {
+         parts[i].dhdt = 0.;
+         continue;
+      }
+ #endif
       setDhDt(parts[i]);
+   }
 #endif
 
 #ifdef SPHLATCH_FRICTION
@@ -596,8 +881,16 @@ void derive()
       costWorker(CZbottomLoc[i]);
    Logger << "Tree.costWorker()";
 
-   Tree.clear();
-   Logger << "Tree.clear()";
+#ifndef SPHLATCH_PERSISTENT_TREE
+ #if defined SPHLATCH_FIND_CLUMPS && defined SPHLATCH_GRAVITY
+   // save() takes the subset trees of the clumps from this tree
+   if (not _withPot)
+ #endif
+   {
+      Tree.clear();
+      Logger << "Tree.clear()";
+   }
+#endif
 }
 
 fType timestep(const fType _stepTime, const fType _nextTime)
@@ -733,30 +1026,15 @@ void save(std::string _dumpPrefix)
       dumpStr << "0";
    dumpStr << timeStr.str();
 
+#if !defined SPHLATCH_PERSISTENT_TREE || defined SPHLATCH_ESCAPEES || \
+    (defined SPHLATCH_FIND_CLUMPS && defined SPHLATCH_GRAVITY)
    treeT& Tree(treeT::instance());
-   Tree.setExtent(parts.getBox() * 1.1);
-
-   for (size_t i = 0; i < nop; i++)
-      Tree.insertPart(parts[i]);
-
-   Logger << "created tree";
-
-   Tree.update(0.8, 1.2);
-
-   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
-   const int           noCZbottomLoc = CZbottomLoc.size();
+#endif
 
 #ifdef SPHLATCH_GRAVITY
-   const fType G = parts.attributes["gravconst"];
-   gravT       gravWorker(&Tree, G);
- #pragma omp parallel for firstprivate(gravWorker)
-   for (int i = 0; i < noCZbottomLoc; i++)
-      gravWorker.calcPot(CZbottomLoc[i]);
-   Logger << "Tree.calcPot()";
-
-
    fType Ethm = 0., Ekin = 0.;
  #ifdef SPHLATCH_GRAVITY
+   // the potential is left from the last derive(true)
    fType Epot = 0.;
  #endif
 
@@ -813,6 +1091,7 @@ void save(std::string _dumpPrefix)
    const fType cMinMass       = 10. * pMinMass;
    const fType cMinMassOrbits = 0.1 * totMass;
    const fType cMinRho        = parts.attributes["rhominclump"];
+   const fType G              = parts.attributes["gravconst"];
 
    parts.attributes["mminclump"] = cMinMass;
    parts.attributes["mminorbit"] = cMinMassOrbits;
@@ -828,6 +1107,9 @@ void save(std::string _dumpPrefix)
    else
   #endif
    clumps.getClumps(parts, cMinMass);
+  #ifdef SPHLATCH_BALLISTIC
+   ballistic.setClumpsTime(time);
+  #endif
 
    const size_t noc = clumps.getNop();
    Logger.stream << "found " << noc - 1 << " clump(s) with m > "
@@ -846,9 +1128,23 @@ void save(std::string _dumpPrefix)
    cfile.close();
 
   #ifdef SPHLATCH_GRAVITY
-   // store original mass
-   for (size_t i = 0; i < nop; i++)
-      parts[i].morig = parts[i].m;
+   ///
+   /// the potentials of the single clumps are taken from subset
+   /// trees of the frozen tree, which is left from derive(true)
+   ///
+   assert(Tree.isFrozen());
+
+   #ifdef SPHLATCH_GRAVITY_FMM
+   gravT gravWorker(&Tree, G);
+   #else
+   gravT gravWorker(&Tree, G, getMAC());
+   #endif
+   #ifdef SPHLATCH_GRAVITY_GROUPSIZE
+   gravWorker.setGroupSize(SPHLATCH_GRAVITY_GROUPSIZE);
+   #endif
+
+   typedef sphlatch::BHTreeFrozen   frzT;
+   frzT clumpTree;
   #endif
 
    for (size_t i = 1; i < noc; i++)
@@ -859,28 +1155,32 @@ void save(std::string _dumpPrefix)
          Logger.flushStream();
 
   #ifdef SPHLATCH_GRAVITY
-         const int cid = i;
-         for (size_t j = 0; j < nop; j++)
-         {
-            if (parts[j].clumpid == cid)
-               parts[j].m = parts[j].morig;
-            else
-               parts[j].m = 0.;
-            parts[j].treeNode->update();
-         }
-
-         Tree.redoMultipoles();
-         Logger << "    Tree.redoMultipoles()";
-
-   #pragma omp parallel for firstprivate(gravWorker)
-         for (int j = 0; j < noCZbottomLoc; j++)
-            gravWorker.calcPot(CZbottomLoc[j]);
-         Logger << "    Tree.calcPot()";
+         ///
+         /// only the members of the clump walk the subset tree,
+         /// so the walks are split up over its smaller nodes. the
+         /// multipole traversal takes the subset tree at once.
+         ///
+         clumpTree.setSubset(Tree.getFrozen(), clumpSelector(i));
+         Logger << "    clumpTree.setSubset()";
+
+   #ifdef SPHLATCH_GRAVITY_FMM
+         gravWorker.calcPot(clumpTree);
+   #else
+         const std::vector<frzT::idxT> cover =
+            clumpTree.getCover(clumpTree.noParts[0] / 256 + 1);
+         const int noCover = cover.size();
+    #pragma omp parallel for firstprivate(gravWorker) schedule(dynamic)
+         for (int j = 0; j < noCover; j++)
+            gravWorker.calcPot(clumpTree, cover[j]);
+   #endif
+         Logger << "    clumpTree.calcPot()";
 
          fType EpotCC = 0.;
-         for (size_t j = 0; j < nop; j++)
-            if (parts[j].clumpid == cid)
-               EpotCC += 0.5 * parts[j].pot * parts[j].m;
+         const frzT::idxT noClumpNodes = clumpTree.size();
+         for (frzT::idxT j = 0; j < noClumpNodes; j++)
+            if (clumpTree.hot[j].isParticle)
+               EpotCC += 0.5 * static_cast<partT*>(clumpTree.part[j])->pot *
+                         clumpTree.hot[j].m;
 
          clumps[i].Epot = EpotCC;
 
@@ -891,12 +1191,6 @@ void save(std::string _dumpPrefix)
   #endif
       }
 
-  #ifdef SPHLATCH_GRAVITY
-   // restore original mass
-   for (size_t i = 0; i < nop; i++)
-      parts[i].m = parts[i].morig;
-  #endif
-
    clumps.doublePrecOut();
    clumps.saveHDF5("clumps.h5part");
  #endif
@@ -914,8 +1208,10 @@ void save(std::string _dumpPrefix)
  #endif
 #endif
 
+#ifndef SPHLATCH_PERSISTENT_TREE
    Tree.clear();
    Logger << "Tree.clear()";
+#endif
 
 #ifdef SPHLATCH_LRDISK
    const fType rmin = parts.attributes["diskrmin"];
@@ -968,6 +1264,16 @@ void save(std::string _dumpPrefix)
       for (escItr = esclst.rbegin(); escItr != esclst.rend(); escItr++)
          escapees.insert(parts.pop(*escItr));
 
+#ifdef SPHLATCH_PERSISTENT_TREE
+      // removing particles invalidates the tree
+      if (esclst.size() > 0)
+      {
+         Tree.clear();
+         treeFilled = false;
+         Logger << "Tree.clear()";
+      }
+#endif
+
       escapees.step = parts.step;
       escapees.saveHDF5(dumpStr.str() + "_esc.h5part");
 
@@ -1056,6 +1362,15 @@ int main(int argc, char* argv[])
 #endif
 #ifdef SPHLATCH_TRACK_PMAX
                  << "     track Pmax\n"
+#endif
+#ifdef SPHLATCH_BALLISTIC
+                 << "     ballistic particles far from clumps\n"
+#endif
+#ifdef SPHLATCH_NEIGHCACHE
+                 << "     cached neighbour lists\n"
+#endif
+#ifdef SPHLATCH_SPH_PAIRS
+                 << "     symmetric pair sums\n"
 #endif
                  << "     ideal gas EOS\n"
                  << "     basic SPH\n";
@@ -1118,6 +1433,14 @@ int main(int argc, char* argv[])
 
    if (parts.attributes.count("courant") == 0)
       parts.attributes["courant"] = 0.3;
+#ifdef SPHLATCH_GRAVITY
+   if (parts.attributes.count("gravtheta") == 0)
+      parts.attributes["gravtheta"] = 0.70;
+ #ifdef SPHLATCH_GRAVITY_RELATIVEMAC
+   if (parts.attributes.count("gravalpha") == 0)
+      parts.attributes["gravalpha"] = 0.005;
+ #endif
+#endif
 #ifdef SPHLATCH_ESCAPEES
    if (parts.attributes.count("rmaxunbound") == 0)
       parts.attributes["rmaxunbound"] = 1.e10;
@@ -1159,6 +1482,20 @@ int main(int argc, char* argv[])
  #endif
 #endif
 
+#ifdef SPHLATCH_BALLISTIC
+   if (parts.attributes.count("ballisticfactor") == 0)
+      parts.attributes["ballisticfactor"] = 3.;
+#endif
+
+#ifdef SPHLATCH_NEIGHCACHE
+   if (parts.attributes.count("neighskin") == 0)
+      parts.attributes["neighskin"] = 0.2;
+   neighCache.setSkin(parts.attributes["neighskin"]);
+ #ifdef SPHLATCH_NEIGH_GROUPSIZE
+   neighCache.setGroupSize(SPHLATCH_NEIGH_GROUPSIZE);
+ #endif
+#endif
+
 #ifdef SPHLATCH_XSPH
    if (parts.attributes.count("xsphfactor") == 0)
       parts.attributes["xsphfactor"] = 0.5;
@@ -1169,6 +1506,12 @@ int main(int argc, char* argv[])
    fType& time(parts.attributes["time"]);
    cType& step(parts.step);
    //treeT& Tree(treeT::instance());
+#ifdef SPHLATCH_TREE_BUCKETSIZE
+   treeT::instance().setBucketSize(SPHLATCH_TREE_BUCKETSIZE);
+#endif
+#if defined SPHLATCH_GRAVITY && !defined SPHLATCH_GRAVITY_FMM
+   treeT::instance().setMultipoleOrder(mpT::order);
+#endif
 
    parts[0].noneighOpt = 50;
 
@@ -1201,9 +1544,12 @@ int main(int argc, char* argv[])
    fType nextTime = (floor(time / stepTime) + 1.) * stepTime;
    // start the loop
 
+   bool derived = false;
    while (time < stopTime)
    {
-      derive();
+      if (not derived)
+         derive();
+      derived = false;
 
       const fType dt = timestep(stepTime, nextTime);
 
@@ -1224,8 +1570,15 @@ int main(int argc, char* argv[])
 
       if (fabs(nextTime - time) < 1.e-9)
       {
+         // the derivation for the next step also
+         // gives the potential for the dump
+         const size_t nopDerived = parts.getNop();
+         derive(true);
          save(dumpPrefix);
          nextTime += stepTime;
+
+         // removed escapees invalidate the derivation
+         derived = (parts.getNop() == nopDerived);
       }
    }
 
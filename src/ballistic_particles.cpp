@@ -0,0 +1,216 @@
+#ifndef SPHLATCH_BALLISTIC_PARTICLES_CPP
+#define SPHLATCH_BALLISTIC_PARTICLES_CPP
+
+/*
+ *  ballistic_particles.cpp
+ *
+ *  particles far away from all clumps, without neighbours and
+ *  belonging to no clump are ballistic: they are left out of the
+ *  tree and only feel the clumps as point masses. the clumps are
+ *  moved along with their velocities from the time they were found.
+ *  a clump set provides getNop() and, for the clumps 1 to getNop()-1,
+ *  pos, vel, m and rc, as sphlatch::Clumps does.
+ *
+ *  Created by Andreas Reufer on 05.02.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "typedefs.h"
+#include "clump_particle.h"
+
+namespace sphlatch {
+///
+/// pointers to the particles which are not ballistic,
+/// the tree is built from them instead of all particles
+///
+template<typename _partT>
+class TreePartSet {
+public:
+   size_t getNop() const
+   {
+      return(ptrs.size());
+   }
+
+   _partT& operator[](const size_t _i)
+   {
+      return(*(ptrs[_i]));
+   }
+
+   void clear()
+   {
+      ptrs.clear();
+   }
+
+   void insert(_partT& _part)
+   {
+      ptrs.push_back(&_part);
+   }
+
+   box3dT getBox()
+   {
+      fType xmin = fTypeInf, ymin = fTypeInf, zmin = fTypeInf;
+      fType xmax = -fTypeInf, ymax = -fTypeInf, zmax = -fTypeInf;
+
+      const size_t nop = ptrs.size();
+      for (size_t i = 0; i < nop; i++)
+      {
+         const vect3dT& pos(ptrs[i]->pos);
+         xmin = xmin < pos[0] ? xmin : pos[0];
+         ymin = ymin < pos[1] ? ymin : pos[1];
+         zmin = zmin < pos[2] ? zmin : pos[2];
+
+         xmax = xmax > pos[0] ? xmax : pos[0];
+         ymax = ymax > pos[1] ? ymax : pos[1];
+         zmax = zmax > pos[2] ? zmax : pos[2];
+      }
+
+      box3dT box;
+      box.cen  = 0.5 * (xmax + xmin), 0.5 * (ymax + ymin), 0.5 * (zmax + zmin);
+      box.size = std::max(xmax - xmin, std::max(ymax - ymin, zmax - zmin));
+      return(box);
+   }
+
+private:
+   std::vector<_partT*> ptrs;
+};
+
+template<typename _partT>
+class BallisticParticles {
+public:
+   BallisticParticles() : clumpsTime(0.), noBallistic(0) { }
+   ~BallisticParticles() { }
+
+   ///
+   /// the time the clumps were found at
+   ///
+   void setClumpsTime(const fType _time)
+   {
+      clumpsTime = _time;
+   }
+
+   size_t getNoBallistic() const
+   {
+      return(noBallistic);
+   }
+
+   ///
+   /// flag the particles of <_parts> at time <_time> and fill
+   /// treeParts with the others. a particle is ballistic, when it
+   /// had no neighbours in the last step, belongs to no clump and is
+   /// farther away than <_bfact> clump radii from all clumps. when
+   /// there are no clumps, no particle is ballistic. returns true
+   /// when a particle changed its flag.
+   ///
+   template<typename _partSetT, typename _clumpsT>
+   bool flag(_partSetT& _parts, _clumpsT& _clumps, const fType _time,
+             const fType _bfact);
+
+   ///
+   /// add the acceleration of the clumps as point masses to the
+   /// ballistic particles, with <_withPot> also set their potential
+   /// (needs SPHLATCH_GRAVITY_POTENTIAL)
+   ///
+   template<typename _partSetT, typename _clumpsT>
+   void calcAcc(_partSetT& _parts, _clumpsT& _clumps, const fType _time,
+                const fType _G, const bool _withPot);
+
+   TreePartSet<_partT> treeParts;
+
+private:
+   fType  clumpsTime;
+   size_t noBallistic;
+};
+
+template<typename _partT>
+template<typename _partSetT, typename _clumpsT>
+bool BallisticParticles<_partT>::flag(_partSetT& _parts, _clumpsT& _clumps,
+                                      const fType _time, const fType _bfact)
+{
+   const fType  dt  = _time - clumpsTime;
+   const size_t nop = _parts.getNop();
+   const size_t noc = _clumps.getNop();
+
+   std::vector<vect3dT> cpos(noc);
+   std::vector<fType>   crr(noc);
+   for (size_t k = 1; k < noc; k++)
+   {
+      cpos[k] = _clumps[k].pos + dt * _clumps[k].vel;
+      crr[k]  = _bfact * _bfact * _clumps[k].rc * _clumps[k].rc;
+   }
+
+   treeParts.clear();
+   noBallistic = 0;
+
+   bool changed = false;
+   for (size_t i = 0; i < nop; i++)
+   {
+      bool ballistic = (noc > 1) && (_parts[i].noneigh <= 1) &&
+                       (_parts[i].clumpid <= CLUMPNONE);
+      for (size_t k = 1; k < noc && ballistic; k++)
+      {
+         const vect3dT rvec = _parts[i].pos - cpos[k];
+         ballistic = (dot(rvec, rvec) > crr[k]);
+      }
+
+      if (_parts[i].ballistic != ballistic)
+         changed = true;
+      _parts[i].ballistic = ballistic;
+
+      if (ballistic)
+         noBallistic++;
+      else
+         treeParts.insert(_parts[i]);
+   }
+   return(changed);
+}
+
+template<typename _partT>
+template<typename _partSetT, typename _clumpsT>
+void BallisticParticles<_partT>::calcAcc(_partSetT& _parts,
+                                         _clumpsT& _clumps,
+                                         const fType _time, const fType _G,
+                                         const bool _withPot)
+{
+   const fType dt  = _time - clumpsTime;
+   const int   nop = _parts.getNop();
+   const int   noc = _clumps.getNop();
+
+   std::vector<vect3dT> cpos(noc);
+   std::vector<fType>   cm(noc);
+   for (int k = 1; k < noc; k++)
+   {
+      cpos[k] = _clumps[k].pos + dt * _clumps[k].vel;
+      cm[k]   = _G * _clumps[k].m;
+   }
+
+#pragma omp parallel for
+   for (int i = 0; i < nop; i++)
+   {
+      if (not _parts[i].ballistic)
+         continue;
+
+      vect3dT acc(0., 0., 0.);
+      fType   pot = 0.;
+      for (int k = 1; k < noc; k++)
+      {
+         const vect3dT rvec = _parts[i].pos - cpos[k];
+         const fType   rr   = dot(rvec, rvec);
+         const fType   Gmr  = cm[k] / sqrt(rr);
+
+         acc -= (Gmr / rr) * rvec;
+         pot -= Gmr;
+      }
+      _parts[i].acc += acc;
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+      if (_withPot)
+         _parts[i].pot = pot;
+#endif
+   }
+}
+};
+
+#endif
@@ -9,6 +9,8 @@
  *
  */
 
+#include <algorithm>
+
 #ifdef SPHLATCH_OPENMP
  #include <omp.h>
 #endif
@@ -20,7 +22,6 @@
 #include "bhtree_part_insertmover.cpp"
 #include "bhtree_cz_builder.cpp"
 #include "bhtree_worker_mp.cpp"
-#include "bhtree_worker_clear.cpp"
 #include "bhtree_treedump.cpp"
 
 namespace sphlatch {
@@ -29,11 +30,16 @@ BHTree::BHTree() :
    rootPtr(new czllT),
    noCells(1),
    noParts(0),
+   bucketSize(1),
+   mpOrder(2),
 #ifdef SPHLATCH_OPENMP
    noThreads(omp_get_num_threads()),
 #else
    noThreads(1),
 #endif
+   frozen(false),
+   cellsReleased(false),
+   built(false),
    insertmover(this)
 {
    ///
@@ -43,6 +49,7 @@ BHTree::BHTree() :
    ///
    CZbottom.push_back(static_cast<czllPtrT>(rootPtr));
 
+   static_cast<czllPtrT>(rootPtr)->data = new czdtT;
    static_cast<czllPtrT>(rootPtr)->clear();
    static_cast<czllPtrT>(rootPtr)->atBottom = true;
    static_cast<czllPtrT>(rootPtr)->depth    = 0;
@@ -52,10 +59,35 @@ BHTree::BHTree() :
 
    static_cast<czllPtrT>(rootPtr)->cen  = 0.5, 0.5, 0.5;
    static_cast<czllPtrT>(rootPtr)->clSz = 1.;
+
+   ///
+   /// allocate the node arenas for each thread
+   ///
+#ifdef SPHLATCH_OPENMP
+   const size_t noArenas = omp_get_max_threads();
+#else
+   const size_t noArenas = 1;
+#endif
+   for (size_t i = 0; i < noArenas; i++)
+   {
+      qcllArenas.push_back(new qcllArenaT);
+      czllArenas.push_back(new czllArenaT);
+      czdtArenas.push_back(new czdtArenaT);
+   }
 }
 
 BHTree::~BHTree()
-{ }
+{
+   const size_t noArenas = qcllArenas.size();
+   for (size_t i = 0; i < noArenas; i++)
+   {
+      delete qcllArenas[i];
+      delete czllArenas[i];
+      delete czdtArenas[i];
+   }
+   delete static_cast<czllPtrT>(rootPtr)->data;
+   delete static_cast<czllPtrT>(rootPtr);
+}
 
 BHTree::selfPtr BHTree::_instance = NULL;
 BHTree::selfRef BHTree::instance()
@@ -71,11 +103,191 @@ void BHTree::setExtent(const box3dT _box)
    static_cast<czllPtrT>(rootPtr)->clSz = _box.size;
 }
 
+box3dT BHTree::getExtent()
+{
+   box3dT box;
+
+   box.cen  = static_cast<czllPtrT>(rootPtr)->cen;
+   box.size = static_cast<czllPtrT>(rootPtr)->clSz;
+   return(box);
+}
+
+///
+/// the bucket size can also be changed on a filled tree, buckets
+/// which became too large are split up on the next insertion
+///
+void BHTree::setBucketSize(const size_t _bucketSize)
+{
+   assert(_bucketSize > 0 && _bucketSize <= maxBucketSize);
+   bucketSize = _bucketSize;
+}
+
+size_t BHTree::getBucketSize()
+{
+   return(bucketSize);
+}
+
+///
+/// the frozen tree gets the moments up to this order, the dynamic
+/// tree always has quadrupoles
+///
+void BHTree::setMultipoleOrder(const size_t _order)
+{
+   assert(_order >= 2 && _order <= maxMultipoleOrder);
+   mpOrder = _order;
+}
+
+size_t BHTree::getMultipoleOrder()
+{
+   return(mpOrder);
+}
+
 void BHTree::insertPart(treeGhost& _part)
 {
+   assert(not cellsReleased);
+   frozen = false;
    insertmover.insert(_part);
 }
 
+///
+/// build the tree from a whole particle set:
+/// - compute the Morton keys of the particles and sort them
+/// - build the CZ tree top down from the cost sums of the key ranges
+/// - insert the particles below each bottom CZ cell in parallel
+///
+/// the tree has to be empty and its extent set. particles which do not
+/// end up in the bottom CZ cell of their key range due to round-off are
+/// inserted as orphans afterwards.
+///
+template<typename _partSetT>
+void BHTree::build(_partSetT& _parts)
+{
+   assert(rootPtr->atBottom);
+   assert(static_cast<czllPtrT>(rootPtr)->getNoChld() == 0);
+   assert(not cellsReleased);
+
+   frozen = false;
+
+   const int nop = _parts.getNop();
+
+   keyIdxVectT keys(nop);
+#pragma omp parallel for
+   for (int i = 0; i < nop; i++)
+      keys[i] = keyIdxT(getKey(_parts[i].pos), i);
+   sortKeys(keys);
+
+   std::vector<fType> costSum(nop + 1);
+   costSum[0] = 0.;
+   for (int i = 0; i < nop; i++)
+      costSum[i + 1] = costSum[i] + _parts[keys[i].second].cost;
+
+   ///
+   /// refine the CZ tree until the cost of each bottom cell lies
+   /// inside the band a later update() balances to
+   ///
+   const fType costMax = 1. / ( noThreads * cellsPerThread );
+
+   std::vector<size_t> czBegin, czEnd;
+   BHTreeCZBuilder     czbuilder(this);
+   czbuilder.buildFromKeys(keys, costSum, costMax, czBegin, czEnd);
+
+   const czllPtrVectT& CZbottomV(CZbottom);
+   const int           noCZBottomCells = CZbottomV.size();
+
+   std::vector<size_t>    misfits;
+   BHTreePartsInsertMover IM(this);
+   BHTreeHousekeeper      HK(this);
+#pragma omp parallel for firstprivate(IM, HK) schedule(dynamic)
+   for (int i = 0; i < noCZBottomCells; i++)
+   {
+      for (size_t j = czBegin[i]; j < czEnd[i]; j++)
+      {
+         if (not IM.insertBelow(CZbottomV[i], _parts[keys[j].second]))
+         {
+#pragma omp critical
+            misfits.push_back(keys[j].second);
+         }
+      }
+      HK.setNext(CZbottomV[i]);
+   }
+
+   const size_t noMisfits = misfits.size();
+   for (size_t i = 0; i < noMisfits; i++)
+      insertmover.insert(_parts[misfits[i]]);
+
+   ///
+   /// the misfits are counted in the cost of their key range and of
+   /// the cell they are inserted to, the moving in the next update()
+   /// recounts the costs then
+   ///
+   built = (noMisfits == 0);
+}
+
+///
+/// get the Morton key of a position relative to the root cell
+///
+BHTree::keyT BHTree::getKey(const vect3dT& _pos)
+{
+   const gcllPtrT rootCell = static_cast<gcllPtrT>(rootPtr);
+   const keyT     maxIdx   = (static_cast<keyT>(1) << maxKeyDepth) - 1;
+   const fType    scale    = static_cast<fType>(maxIdx + 1) / rootCell->clSz;
+
+   keyT key = 0;
+   for (size_t i = 0; i < 3; i++)
+   {
+      const fType rel = (_pos[i] - rootCell->cen[i]) * scale +
+                        0.5 * static_cast<fType>(maxIdx + 1);
+
+      keyT idx = rel > 0. ? static_cast<keyT>(rel) : 0;
+      idx = idx > maxIdx ? maxIdx : idx;
+
+      ///
+      /// spread the 21 bits of the index to every third bit
+      ///
+      idx = (idx | idx << 32) & 0x001f00000000ffffULL;
+      idx = (idx | idx << 16) & 0x001f0000ff0000ffULL;
+      idx = (idx | idx << 8)  & 0x100f00f00f00f00fULL;
+      idx = (idx | idx << 4)  & 0x10c30c30c30c30c3ULL;
+      idx = (idx | idx << 2)  & 0x1249249249249249ULL;
+
+      key |= idx << i;
+   }
+   return(key);
+}
+
+///
+/// sort the keys in chunks per thread and merge them
+///
+void BHTree::sortKeys(keyIdxVectT& _keys)
+{
+#ifdef SPHLATCH_OPENMP
+   const int noChunks = omp_get_max_threads();
+#else
+   const int noChunks = 1;
+#endif
+   const size_t noKeys = _keys.size();
+
+   std::vector<size_t> bounds(noChunks + 1);
+   for (int i = 0; i <= noChunks; i++)
+      bounds[i] = (noKeys * i) / noChunks;
+
+#pragma omp parallel for
+   for (int i = 0; i < noChunks; i++)
+      std::sort(_keys.begin() + bounds[i], _keys.begin() + bounds[i + 1]);
+
+   for (int width = 1; width < noChunks; width *= 2)
+   {
+#pragma omp parallel for
+      for (int i = 0; i < noChunks - width; i += 2 * width)
+      {
+         const int last = std::min(i + 2 * width, noChunks);
+         std::inplace_merge(_keys.begin() + bounds[i],
+                            _keys.begin() + bounds[i + width],
+                            _keys.begin() + bounds[last]);
+      }
+   }
+}
+
 void BHTree::update(const fType _cmarkLow, const fType _cmarkHigh)
 {
    /*std::cout << "entered Tree.update() ... round " << round << "\n";
@@ -90,19 +302,26 @@ void BHTree::update(const fType _cmarkLow, const fType _cmarkHigh)
    //dumper.dotDump(dumpName + "_0.dot");
    //dumper.ptrDump(dumpName + "_0.ptr");
 
+   assert(not cellsReleased);
+   frozen = false;
+
    // move particles
-   // (prepare next walk?)
-   czllPtrListT::iterator       CZItr = CZbottom.begin();
-   czllPtrListT::const_iterator CZEnd = CZbottom.end();
-   
-   /*std::cout << "move parts in " << CZbottom.size() << " CZ cells\n";
-   while (CZItr != CZEnd)
+   //
+   // when the tree is kept from the last update, the particles are moved
+   // to their new positions and the cost of the CZ cells is recounted.
+   // the computing time of the CZ cells is reset for the coming walks.
+   // after build() every particle already sits in its cell and the cost
+   // of the CZ cells is counted by the CZ builder, so the moving is left
+   // out. particles filled in by insertPart() are still orphans and are
+   // pushed down below.
+   const size_t noOldCZBottomCells = CZbottom.size();
+   for (size_t i = 0; i < noOldCZBottomCells; i++)
    {
-      insertmover.move(*CZItr);
-      CZItr++;
+      if (not built)
+         insertmover.move(CZbottom[i]);
+      CZbottom[i]->compTime = 0.;
    }
-
-   std::cout << "move done!\n";*/
+   built = false;
 
    // rebalance trees
    //dumper.dotDump(dumpName + "_1.dot");
@@ -120,33 +339,25 @@ void BHTree::update(const fType _cmarkLow, const fType _cmarkHigh)
    //dumper.ptrDump(dumpName + "_2.txt");
    //
 
-   // compose vector of CZ cell pointers
-   czllPtrVectT CZbottomV       = getCzllPtrVect(CZbottom);
-   const int    noCZBottomCells = CZbottomV.size();
+   const czllPtrVectT& CZbottomV(CZbottom);
+   const int           noCZBottomCells = CZbottomV.size();
 
    // exchange costzone cells and their particles
 
    // push down orphans
-   //std::cout << "push down orphans\n";
-   CZItr = CZbottom.begin();
-   while (CZItr != CZEnd)
-   {
-      insertmover.pushDownOrphans(*CZItr);
-      CZItr++;
-   }
-
-   //dumper.dotDump(dumpName + "_3.dot");
-   //dumper.ptrDump(dumpName + "_3.txt");
-
    // clean up tree
    // prepare walks (next & skip)
    //std::cout << "housekeeping          \n";
 
-   BHTreeHousekeeper HK(this);
-   BHTreeMPWorker    MP(this);
-#pragma omp parallel for firstprivate(HK, MP)
+   BHTreePartsInsertMover IM(this);
+   BHTreeHousekeeper      HK(this);
+   BHTreeMPWorker         MP(this);
+#pragma omp parallel for firstprivate(IM, HK, MP) schedule(dynamic)
    for (int i = 0; i < noCZBottomCells; i++)
    {
+      // push down orphans
+      IM.pushDownOrphans(CZbottomV[i]);
+
       // set next pointers
       HK.setNext(CZbottomV[i]);
 
@@ -162,9 +373,12 @@ void BHTree::update(const fType _cmarkLow, const fType _cmarkHigh)
    //std::cout << "prepare CZ next walk  \n";
    HK.setNextCZ();
    //std::cout << "prepare    skip walk  \n";
-   HK.setSkip();
+   HK.setSkipCZ();
+#pragma omp parallel for firstprivate(HK) schedule(dynamic)
+   for (int i = 0; i < noCZBottomCells; i++)
+      HK.setSkip(CZbottomV[i]);
    //std::cout << "calculate MP moments  \n\n";
-   MP.calcMultipolesCZ();
+   calcMultipolesCZ();
 
    //dumper.dotDump(dumpName + "_5.dot");
    //dumper.ptrDump(dumpName + "_5.txt");
@@ -174,13 +388,12 @@ void BHTree::update(const fType _cmarkLow, const fType _cmarkHigh)
 
    //FIXME: change this in parallel version
    CZbottomLoc.clear();
-   for (czllPtrListT::iterator itr = CZbottom.begin();
-        itr != CZbottom.end(); itr++)
+   for (int j = 0; j < noCZBottomCells; j++)
    {
      for (size_t i = 0; i < 8; i++)
-       if ( (*itr)->child[i] != NULL )
+       if ( CZbottomV[j]->child[i] != NULL )
        {
-         CZbottomLoc.push_back( *itr );
+         CZbottomLoc.push_back( CZbottomV[j] );
          break;
        }
    }
@@ -188,30 +401,111 @@ void BHTree::update(const fType _cmarkLow, const fType _cmarkHigh)
 
 void BHTree::redoMultipoles()
 {
-   // compose vector of CZ cell pointers
-   czllPtrVectT CZbottomV       = getCzllPtrVect(CZbottom);
-   const int    noCZBottomCells = CZbottomV.size();
+   assert(not cellsReleased);
+
+   const czllPtrVectT& CZbottomV(CZbottom);
+   const int           noCZBottomCells = CZbottomV.size();
   
    // update particle masses
    BHTreeMPWorker    MP(this);
 #pragma omp parallel for firstprivate(MP)
    for (int i = 0; i < noCZBottomCells; i++)
       MP.calcMultipoles(CZbottomV[i]);
-   MP.calcMultipolesCZ();
+   calcMultipolesCZ();
+
+   if (frozen)
+      freeze();
+}
+
+///
+/// calculate the multipoles of the CZ cells above the bottom level
+/// by level, the cells of one level are done concurrently
+///
+void BHTree::calcMultipolesCZ()
+{
+   const czllPtrVectT CZnodes   = getCZnodes();
+   const size_t       noCZnodes = CZnodes.size();
+
+   std::vector<czllPtrVectT> CZlevels;
+   for (size_t i = 0; i < noCZnodes; i++)
+   {
+      if (CZnodes[i]->atBottom)
+         continue;
+
+      const size_t depth = CZnodes[i]->depth;
+      if (CZlevels.size() <= depth)
+         CZlevels.resize(depth + 1);
+      CZlevels[depth].push_back(CZnodes[i]);
+   }
+
+   for (int depth = static_cast<int>(CZlevels.size()) - 1; depth >= 0;
+        depth--)
+   {
+      const czllPtrVectT& CZlevel(CZlevels[depth]);
+      const int           noCZlevel = CZlevel.size();
+#pragma omp parallel for
+      for (int i = 0; i < noCZlevel; i++)
+         CZlevel[i]->calcMultipole();
+   }
+}
+
+///
+/// get the CZ cells in walk order, the subtrees
+/// of the bottom CZ cells are jumped over
+///
+BHTree::czllPtrVectT BHTree::getCZnodes()
+{
+   czllPtrVectT CZnodes;
+   nodePtrT     curPtr = rootPtr;
+
+   while (curPtr != NULL)
+   {
+      CZnodes.push_back(static_cast<czllPtrT>(curPtr));
+      if (curPtr->atBottom)
+         curPtr = static_cast<czllPtrT>(curPtr)->chldLast->next;
+      else
+         curPtr = curPtr->next;
+   }
+   return(CZnodes);
 }
 
 void BHTree::clear()
 {
-  BHTreeClear TC(this); 
-  TC(rootPtr);
+  frozen        = false;
+  cellsReleased = false;
+  built         = false;
+
+  ///
+  /// release all nodes except the root cell at once
+  ///
+  for (size_t i = 0; i < 8; i++)
+    static_cast<czllPtrT>(rootPtr)->child[i] = NULL;
+
+  const size_t noArenas = qcllArenas.size();
+  for (size_t i = 0; i < noArenas; i++)
+  {
+    qcllArenas[i]->clear();
+    czllArenas[i]->clear();
+    czdtArenas[i]->clear();
+  }
 
   noParts = 0;
   noCells = 0;
 
   static_cast<czllPtrT>(rootPtr)->noParts = 0;
   static_cast<czllPtrT>(rootPtr)->relCost = 0.;
+  static_cast<czllPtrT>(rootPtr)->compTime = 0.;
   static_cast<czllPtrT>(rootPtr)->atBottom = true;
 
+  // the walks of the old tree have to be forgotten, as update()
+  // moves the particles along the child walk of the CZ cells
+  static_cast<czllPtrT>(rootPtr)->next     = NULL;
+  static_cast<czllPtrT>(rootPtr)->skip     = NULL;
+  static_cast<czllPtrT>(rootPtr)->chldFrst = NULL;
+  static_cast<czllPtrT>(rootPtr)->chldLast = NULL;
+  static_cast<czllPtrT>(rootPtr)->orphFrst = NULL;
+  static_cast<czllPtrT>(rootPtr)->orphLast = NULL;
+
   CZbottomLoc.clear();
   CZbottom.clear();
   
@@ -222,38 +516,226 @@ void BHTree::clear()
 
 BHTree::czllPtrVectT BHTree::getCZbottomLoc()
 {
-   return(getCzllPtrVect(CZbottomLoc));
+   return(CZbottomLoc);
+}
+
+///
+/// copy the tree into the frozen arrays in the order of the next-walk:
+/// - walk the CZ tree and count the nodes and the cells below each
+///   bottom CZ cell
+/// - assign the node and the cell index ranges and set the CZ cells
+/// - copy the subtrees of the bottom CZ cells in parallel
+///
+/// the skip index of a node is the index of the next node with the
+/// same or a lower depth, the parent index is the last cell seen one
+/// level above.
+///
+/// the moments above the quadrupoles are added at the end when a
+/// higher multipole order is set.
+///
+void BHTree::freeze()
+{
+   typedef BHTreeFrozen::idxT   idxT;
+
+   assert(not cellsReleased);
+
+   const czllPtrVectT CZnodes   = getCZnodes();
+   const int          noCZnodes = CZnodes.size();
+
+   std::vector<idxT> noBelow(noCZnodes, 0), noCellsBelow(noCZnodes, 0);
+#pragma omp parallel for
+   for (int i = 0; i < noCZnodes; i++)
+   {
+      const czllPtrT czll = CZnodes[i];
+      if (czll->atBottom && czll->chldFrst != NULL)
+      {
+         idxT     noNodes = 0, noCells = 0;
+         nodePtrT nodePtr = czll->chldFrst;
+         while (true)
+         {
+            noNodes++;
+            if (not nodePtr->isParticle)
+               noCells++;
+            if (nodePtr == czll->chldLast)
+               break;
+            nodePtr = nodePtr->next;
+         }
+         noBelow[i]      = noNodes;
+         noCellsBelow[i] = noCells;
+      }
+   }
+
+   ///
+   /// index the CZ cells, a bottom cell is followed by its subtree
+   ///
+   std::vector<idxT> lastAtDepth(maxDepth);
+   std::vector<idxT> pending;
+
+   std::vector<idxT> cellIdx(noCZnodes);
+   idxT noNodes = 0, noCells = 0;
+   for (int i = 0; i < noCZnodes; i++)
+   {
+      CZnodes[i]->frozenIdx = noNodes;
+      cellIdx[i]            = noCells;
+      noNodes += 1 + noBelow[i];
+      noCells += 1 + noCellsBelow[i];
+   }
+   frozenTree.resize(noNodes, noCells);
+
+   for (int i = 0; i < noCZnodes; i++)
+   {
+      const idxT   idx   = CZnodes[i]->frozenIdx;
+      const size_t depth = CZnodes[i]->depth;
+
+      while (not pending.empty() &&
+             CZnodes[pending.back()]->depth >= depth)
+      {
+         frozenTree.hot[CZnodes[pending.back()]->frozenIdx].skip = idx;
+         pending.pop_back();
+      }
+      pending.push_back(i);
+
+      frozenTree.set(idx, CZnodes[i], cellIdx[i]);
+      if (depth > 0)
+         frozenTree.parent[idx] = lastAtDepth[depth - 1];
+      else
+         frozenTree.parent[idx] = BHTreeFrozen::nil;
+      lastAtDepth[depth] = idx;
+   }
+   while (not pending.empty())
+   {
+      frozenTree.hot[CZnodes[pending.back()]->frozenIdx].skip = noNodes;
+      pending.pop_back();
+   }
+
+   ///
+   /// copy the subtrees of the bottom cells
+   ///
+#pragma omp parallel for firstprivate(lastAtDepth, pending) schedule(dynamic)
+   for (int i = 0; i < noCZnodes; i++)
+   {
+      if (noBelow[i] == 0)
+         continue;
+
+      const czllPtrT czll     = CZnodes[i];
+      const idxT     czllIdx  = czll->frozenIdx;
+      const idxT     czllSkip = frozenTree.hot[czllIdx].skip;
+
+      ///
+      /// pending holds the depths of the cells still waiting for their
+      /// skip index, the cells themselves are found over lastAtDepth
+      ///
+      lastAtDepth[czll->depth] = czllIdx;
+      pending.clear();
+
+      nodePtrT nodePtr = czll->chldFrst;
+      idxT     cell    = cellIdx[i] + 1;
+      for (idxT idx = czllIdx + 1; idx <= czllIdx + noBelow[i]; idx++)
+      {
+         const size_t depth = nodePtr->depth;
+
+         while (not pending.empty() && pending.back() >= depth)
+         {
+            frozenTree.hot[lastAtDepth[pending.back()]].skip = idx;
+            pending.pop_back();
+         }
+
+         frozenTree.set(idx, nodePtr, cell);
+         frozenTree.parent[idx] = lastAtDepth[depth - 1];
+
+         if (not nodePtr->isParticle)
+         {
+            lastAtDepth[depth] = idx;
+            pending.push_back(depth);
+            cell++;
+         }
+         nodePtr = nodePtr->next;
+      }
+
+      while (not pending.empty())
+      {
+         frozenTree.hot[lastAtDepth[pending.back()]].skip = czllSkip;
+         pending.pop_back();
+      }
+
+      ///
+      /// sum up the number of particles and the extent below each
+      /// cell, the parent of a node always comes before the node
+      ///
+      for (idxT idx = czllIdx + noBelow[i]; idx > czllIdx; idx--)
+         frozenTree.addToParent(idx);
+   }
+
+   for (int i = noCZnodes - 1; i > 0; i--)
+      frozenTree.addToParent(CZnodes[i]->frozenIdx);
+
+   frozenTree.calcMultipoles(mpOrder);
+
+   frozen = true;
 }
 
-BHTree::czllPtrVectT BHTree::getCzllPtrVect(czllPtrListT _czllList)
+///
+/// the cells below the bottom CZ cells all come from the quadrupole
+/// cell arenas, the CZ cells from the CZ cell arenas. the pointers
+/// of the dynamic tree into the released cells are left dangling, the
+/// workers take the frozen tree as long as it is set. the peak memory
+/// at the freeze is not lowered and the next build has to allocate
+/// the slabs again, so this only pays for a frozen tree kept long.
+///
+void BHTree::releaseCells()
 {
-   czllPtrVectT vect;
+   assert(frozen);
 
-   vect.resize(_czllList.size());
+   const size_t noArenas = qcllArenas.size();
+   for (size_t i = 0; i < noArenas; i++)
+      qcllArenas[i]->release();
 
-   czllPtrListT::iterator       CZItr = _czllList.begin();
-   czllPtrListT::const_iterator CZEnd = _czllList.end();
+   cellsReleased = true;
+}
+
+///
+/// memory used by the tree cells and by the frozen tree in bytes,
+/// the particle nodes are part of the particles
+///
+size_t BHTree::getNodeMemory()
+{
+   size_t noBytes = 0;
 
-   size_t i = 0;
-   while (CZItr != CZEnd)
+   const size_t noArenas = qcllArenas.size();
+   for (size_t i = 0; i < noArenas; i++)
    {
-      vect[i] = *CZItr;
-      CZItr++;
-      i++;
+      noBytes += qcllArenas[i]->getNoUsed() * sizeof(qcllT);
+      noBytes += czllArenas[i]->getNoUsed() * sizeof(czllT);
+      noBytes += czdtArenas[i]->getNoUsed() * sizeof(czdtT);
    }
-   return(vect);
+   return(noBytes);
+}
+
+size_t BHTree::getFrozenMemory()
+{
+   return(frozenTree.getNoBytes());
+}
+
+bool BHTree::isFrozen()
+{
+   return(frozen);
+}
+
+const BHTreeFrozen& BHTree::getFrozen()
+{
+   return(frozenTree);
 }
 
 void BHTree::normalizeCost()
 {
-   czllPtrListT::iterator       CZItr;
+   const size_t noCZBottomCells = CZbottom.size();
    
    fType totCost = 0.;
-   for (CZItr = CZbottom.begin(); CZItr != CZbottom.end(); CZItr++)
-     totCost += (*CZItr)->compTime;
+   for (size_t i = 0; i < noCZBottomCells; i++)
+     totCost += CZbottom[i]->compTime;
 
-   for (CZItr = CZbottom.begin(); CZItr != CZbottom.end(); CZItr++)
-     (*CZItr)->compTime /= totCost;
+   for (size_t i = 0; i < noCZBottomCells; i++)
+     CZbottom[i]->compTime /= totCost;
 }
 
 
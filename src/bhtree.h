@@ -11,9 +11,13 @@
  *
  */
 
+#include <stdint.h>
+
 #include "typedefs.h"
 
 #include "bhtree_nodes.h"
+#include "bhtree_node_arena.h"
+#include "bhtree_frozen.h"
 #include "bhtree_housekeeper.h"
 #include "bhtree_part_insertmover.h"
 
@@ -33,6 +37,17 @@ public:
    typedef std::list<czllPtrT>      czllPtrListT;
    typedef std::vector<czllPtrT>    czllPtrVectT;
 
+   ///
+   /// Morton keys of particles and their index
+   ///
+   typedef uint64_t                 keyT;
+   typedef std::pair<keyT, size_t>  keyIdxT;
+   typedef std::vector<keyIdxT>     keyIdxVectT;
+
+   typedef BHTreeNodeArena<qcllT, 4096>   qcllArenaT;
+   typedef BHTreeNodeArena<czllT, 256>    czllArenaT;
+   typedef BHTreeNodeArena<czdtT, 256>    czdtArenaT;
+
    BHTree();
    ~BHTree();
 
@@ -41,8 +56,11 @@ public:
    ///
    /// some constants
    ///
-   static const size_t maxDepth       = 128;
-   static const size_t maxCZBottCells = 16384;
+   static const size_t maxDepth          = 128;
+   static const size_t maxCZBottCells    = 16384;
+   static const size_t maxKeyDepth       = 21;
+   static const size_t maxBucketSize     = 8;
+   static const size_t maxMultipoleOrder = 4;
 
    static const fType cellsPerThread = 100;
 
@@ -50,17 +68,62 @@ public:
    /// public functions
    ///
    void setExtent(const box3dT _box);
+   box3dT getExtent();
    void insertPart(treeGhost& _part);
+
+   template<typename _partSetT>
+   void build(_partSetT& _parts);
+
+   keyT getKey(const vect3dT& _pos);
+
+   ///
+   /// maximal number of particles in a leaf cell, the
+   /// default of 1 gives a leaf cell for every particle
+   ///
+   void setBucketSize(const size_t _bucketSize);
+   size_t getBucketSize();
+
+   ///
+   /// order of the multipole moments in the frozen tree, 2 for
+   /// quadrupoles, 3 for octupoles and 4 for hexadecapoles
+   ///
+   void setMultipoleOrder(const size_t _order);
+   size_t getMultipoleOrder();
+
    void update(const fType _cmin, const fType _cmax);
    void clear();
    void redoMultipoles();
    czllPtrVectT getCZbottomLoc();
    void normalizeCost();
 
+   ///
+   /// copy the tree into a read-only snapshot for the walks,
+   /// the snapshot is dropped by update(), clear() and insertions
+   ///
+   void freeze();
+   bool isFrozen();
+   const BHTreeFrozen& getFrozen();
+
+   ///
+   /// free the cells below the bottom CZ cells of a frozen tree, the
+   /// frozen tree replaces them until the next clear(). only the walks
+   /// on the frozen tree are possible in between, the tree can not be
+   /// updated or filled.
+   ///
+   void releaseCells();
+
+   ///
+   /// memory used by the nodes and the frozen tree in bytes
+   ///
+   size_t getNodeMemory();
+   size_t getFrozenMemory();
+
 private:
    static selfPtr _instance;
 
-   czllPtrVectT getCzllPtrVect(czllPtrListT _czllList);
+   void sortKeys(keyIdxVectT& _keys);
+   void calcMultipolesCZ();
+   czllPtrVectT getCZnodes();
    void sumUpCosts(), sumUpCostsRec();
    size_t round;
 
@@ -70,12 +133,29 @@ protected:
    ///
    /// first and last (local) CZ cell at bottom
    ///
-   std::list<czllPtrT> CZbottom, CZbottomLoc;
+   czllPtrVectT CZbottom, CZbottomLoc;
 
    size_t noCells, noParts;
+   size_t bucketSize;
+   size_t mpOrder;
 
    const size_t noThreads;
 
+   ///
+   /// node arenas, one of each type per thread
+   ///
+   std::vector<qcllArenaT*> qcllArenas;
+   std::vector<czllArenaT*> czllArenas;
+   std::vector<czdtArenaT*> czdtArenas;
+
+   BHTreeFrozen frozenTree;
+   bool         frozen, cellsReleased;
+
+   ///
+   /// set by build(), the next update() has no particles to move
+   ///
+   bool built;
+
 private:
    BHTreePartsInsertMover insertmover;
 };
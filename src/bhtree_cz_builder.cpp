@@ -9,6 +9,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "typedefs.h"
 #include "bhtree_worker.cpp"
 
@@ -40,6 +42,16 @@ public:
 
    void rebalance(const fType _lowMark, const fType _highMark);
 
+   typedef BHTree::keyT          keyT;
+   typedef BHTree::keyIdxT       keyIdxT;
+   typedef BHTree::keyIdxVectT   keyIdxVectT;
+
+   void buildFromKeys(const keyIdxVectT& _keys,
+                      const std::vector<fType>& _costSum,
+                      const fType _highMark,
+                      std::vector<size_t>& _czBegin,
+                      std::vector<size_t>& _czEnd);
+
 private:
 #ifdef SPHLATCH_MPI
    commT & CommManager;
@@ -51,6 +63,12 @@ private:
    void refineCZcell(const czllPtrT _czllPtr);
    void gatherCZcell(const czllPtrT _czllPtr);
 
+   void rebalanceRecursor();
+   void collectBottomRecursor();
+
+   fType  costLowMark, costHighMark;
+   size_t noCZbottom;
+
    nodePtrT gathOrphFrst, gathOrphLast;
 
    void sumCZcosts();
@@ -60,107 +78,195 @@ private:
 
    size_t countParts;
 
+   void buildRecursor(const size_t _begin, const size_t _end,
+                      const keyT _prefix);
+
+   const keyIdxVectT*        buildKeys;
+   const std::vector<fType>* buildCostSum;
+   std::vector<size_t>*      buildBegin, * buildEnd;
+   fType buildHighMark;
+
    dumpT dumper;
 };
 
-///  - particles have been moved inside the tree
-///  - do iterate CZ cells list
-///    - globally sum up particle counts in CZ cells
-///    - if a CZ cell contains too much particles, split it up
-///      into CZ cell children and delete current CZ cell from list.
-///      deleted normals cells which were replaced by CZ cells and rewire
-///      everything again
-///    - if a CZ cell contains too little particles, go to parent, add
-///      up all its children and check if those are enough particles to
-///      build a new CZ cell. if so, merge all children to the new CZ
-///      cell and replace them by normal cells
-///    while not all CZ cells are balanced
+///
+/// rebalance the CZ tree after the particles have been moved:
+///  - sum up the costs once from the bottom cells upwards
+///  - walk the CZ tree top down:
+///    - if a CZ cell costs less than the low mark, merge all its
+///      CZ children to a new bottom CZ cell and replace them by
+///      normal cells
+///    - if a bottom CZ cell costs more than the high mark, split it
+///      up into CZ cell children and check those in turn
+///  - collect the bottom CZ cells in walk order
+///
+/// the costs of the refined and gathered cells are set on the way,
+/// so every CZ cell is visited only once. the number of bottom CZ
+/// cells is kept below maxCZBottCells.
 ///
 void BHTreeCZBuilder::rebalance(const fType _lowMark, const fType _highMark)
 {
-   std::list<czllPtrT>& CZbottom(treePtr->CZbottom);
+   sumCZcosts();
+
+   costLowMark  = _lowMark;
+   costHighMark = _highMark;
+   noCZbottom   = treePtr->CZbottom.size();
+
+   goRoot();
+   rebalanceRecursor();
 
-   bool CZbalanced = false;
+   treePtr->CZbottom.clear();
+   goRoot();
+   collectBottomRecursor();
+}
 
-   const fType costHighMark = _highMark;
-   const fType costLowMark  = _lowMark;
+void BHTreeCZBuilder::rebalanceRecursor()
+{
+   const czllPtrT czllPtr = static_cast<czllPtrT>(curPtr);
 
-   while (not CZbalanced)
+   if (not czllPtr->atBottom)
    {
-      ///
-      /// sum up CZ cost
-      ///
-      sumCZcosts();
+      if (czllPtr->relCost < costLowMark)
+      {
+         gathOrphFrst = NULL;
+         gathOrphLast = NULL;
+         gatherCZcell(czllPtr);
+         czllPtr->orphFrst = static_cast<pnodPtrT>(gathOrphFrst);
+         czllPtr->orphLast = static_cast<pnodPtrT>(gathOrphLast);
+
+         czllPtr->atBottom = true;
+         noCZbottom++;
+         return;
+      }
+   }
+   else
+   {
+      if (czllPtr->relCost > costHighMark && czllPtr->noParts > 1 &&
+          noCZbottom + 7 <= treePtr->maxCZBottCells)
+      {
+         refineCZcell(czllPtr);
 
-      czllPtrListT::iterator       CZlistItr = CZbottom.begin();
-      czllPtrListT::const_iterator CZlistEnd = CZbottom.end();
+         for (size_t i = 0; i < 8; i++)
+            static_cast<czllPtrT>(czllPtr->child[i])->atBottom = true;
+         czllPtr->atBottom = false;
+         noCZbottom       += 7;
+      }
+      else
+         return;
+   }
 
-      CZbalanced = true;
-      while (CZlistItr != CZlistEnd)
+   for (size_t i = 0; i < 8; i++)
+   {
+      if (czllPtr->child[i] != NULL)
       {
-         ///
-         ///    - if a CZ cell contains too much particles, split it up
-         ///      into CZ cell children and delete current CZ cell from list.
-         ///      delete normal cells which were replaced by CZ cells and rewire
-         ///      everything again
-         ///    - if a CZ cell contains too little particles, go to parent, add
-         ///      up all its children and check if those are enough particles to
-         ///      build a new CZ cell. if so, merge all children to the new CZ
-         ///      cell and replace them by normal cells
-         ///
-
-         if ((*CZlistItr)->relCost > costHighMark)
-         {
-            CZbalanced = false;
-            const czllPtrT refdCellPtr = *CZlistItr;
+         goChild(i);
+         rebalanceRecursor();
+         goUp();
+      }
+   }
+}
 
-            // refine the cell
-            refineCZcell(refdCellPtr);
+void BHTreeCZBuilder::collectBottomRecursor()
+{
+   if (curPtr->atBottom)
+   {
+      treePtr->CZbottom.push_back(static_cast<czllPtrT>(curPtr));
+      return;
+   }
 
-            // delete from list and insert new ones
-            for (int i = 7; i >= 0; i--)
-            {
-               CZbottom.insert(CZlistItr,
-                               static_cast<czllPtrT>(refdCellPtr->child[i]));
-               static_cast<czllPtrT>(refdCellPtr->child[i])->atBottom = true;
-            }
-            refdCellPtr->atBottom = false;
+   for (size_t i = 0; i < 8; i++)
+   {
+      if (static_cast<gcllPtrT>(curPtr)->child[i] != NULL)
+      {
+         goChild(i);
+         collectBottomRecursor();
+         goUp();
+      }
+   }
+}
 
-            CZlistItr--;
-            CZbottom.remove(refdCellPtr);
-         }
-         else
-         if ((*CZlistItr)->parent != NULL)
+///
+/// build the CZ tree of an empty tree top down from the sorted
+/// particle keys: a CZ cell is refined, as long as the cost of
+/// the particles in its key range is above the high mark. the
+/// key ranges of the bottom cells are stored in the order of the
+/// CZbottom list.
+///
+void BHTreeCZBuilder::buildFromKeys(const keyIdxVectT& _keys,
+                                    const std::vector<fType>& _costSum,
+                                    const fType _highMark,
+                                    std::vector<size_t>& _czBegin,
+                                    std::vector<size_t>& _czEnd)
+{
+   buildKeys     = &_keys;
+   buildCostSum  = &_costSum;
+   buildHighMark = _highMark;
+   buildBegin    = &_czBegin;
+   buildEnd      = &_czEnd;
+
+   _czBegin.clear();
+   _czEnd.clear();
+   treePtr->CZbottom.clear();
+
+   goRoot();
+   buildRecursor(0, _keys.size(), 0);
+}
+
+void BHTreeCZBuilder::buildRecursor(const size_t _begin, const size_t _end,
+                                    const keyT _prefix)
+{
+   const czllPtrT czll = static_cast<czllPtrT>(curPtr);
+
+   czll->relCost = (*buildCostSum)[_end] - (*buildCostSum)[_begin];
+   czll->noParts = _end - _begin;
+
+   const size_t depth = czll->depth;
+
+   if (czll->relCost > buildHighMark && czll->noParts > 1 &&
+       depth < treePtr->maxKeyDepth)
+   {
+      czll->atBottom = false;
+
+      ///
+      /// the key range of the cell is split up into the
+      /// ranges of its 8 children
+      ///
+      const size_t shift     = 3 * (treePtr->maxKeyDepth - depth - 1);
+      size_t       chldBegin = _begin;
+      for (size_t i = 0; i < 8; i++)
+      {
+         const keyT chldPrefix = _prefix + (static_cast<keyT>(i) << shift);
+         size_t     chldEnd    = _end;
+
+         if (i < 7)
          {
-            const czllPtrT gathCellPtr =
-               static_cast<czllPtrT>((*CZlistItr)->parent);
-            if (gathCellPtr->relCost < costLowMark)
-            {
-               ///
-               /// go back again in the CZ cell list just to make sure,
-               /// that the iterator doesn't point to a CZ cell which was
-               /// deleted by gatherCZcell()
-               ///
-               CZlistItr--;
-
-               gathOrphFrst = NULL;
-               gathOrphLast = NULL;
-               gatherCZcell(gathCellPtr);
-               gathCellPtr->orphFrst = static_cast<pnodPtrT>(gathOrphFrst);
-               gathCellPtr->orphLast = static_cast<pnodPtrT>(gathOrphLast);
-
-               gathCellPtr->atBottom = true;
-               CZbottom.insert(CZlistItr, gathCellPtr);
-
-               CZbalanced = false;
-            }
+            const keyT nextPrefix = chldPrefix + (static_cast<keyT>(1) << shift);
+            chldEnd = std::lower_bound(buildKeys->begin() + chldBegin,
+                                       buildKeys->begin() + _end,
+                                       keyIdxT(nextPrefix, 0))
+                      - buildKeys->begin();
          }
-         CZlistItr++;
-      }
-   }
 
+         const czllPtrT chld = newCZll();
+         chld->clear();
+         chld->parent   = czll;
+         czll->child[i] = chld;
+
+         goChild(i);
+         chld->inheritCellPos(i);
+         buildRecursor(chldBegin, chldEnd, chldPrefix);
+         goUp();
 
-   // delete empty cells
+         chldBegin = chldEnd;
+      }
+   }
+   else
+   {
+      czll->atBottom = true;
+      treePtr->CZbottom.push_back(czll);
+      buildBegin->push_back(_begin);
+      buildEnd->push_back(_end);
+   }
 }
 
 // FIXME: move this to tree
@@ -170,16 +276,13 @@ void BHTreeCZBuilder::sumCZcosts()
    ///
    /// CZ cell list -> vector
    ///
-   czllPtrListT::const_iterator CZlistCItr = treePtr->CZbottom.begin();
-   czllPtrListT::const_iterator CZlistEnd  = treePtr->CZbottom.end();
-   size_t i = 0;
+   const BHTree::czllPtrVectT& CZbottom(treePtr->CZbottom);
+   const size_t                noCZbottomCells = CZbottom.size();
 
-   while (CZlistCItr != CZlistEnd)
+   for (size_t i = 0; i < noCZbottomCells; i++)
    {
-      CZcosts[i] = (*CZlistCItr)->relCost;
-      CZparts[i] = (*CZlistCItr)->noParts;
-      i++;
-      CZlistCItr++;
+      CZcosts[i] = CZbottom[i]->relCost;
+      CZparts[i] = CZbottom[i]->noParts;
    }
 
    ///
@@ -191,15 +294,10 @@ void BHTreeCZBuilder::sumCZcosts()
    ///
    /// vector -> CZ cell list
    ///
-   czllPtrListT::iterator CZlistItr = treePtr->CZbottom.begin();
-   i = 0;
-
-   while (CZlistItr != CZlistEnd)
+   for (size_t i = 0; i < noCZbottomCells; i++)
    {
-      (*CZlistItr)->relCost = CZcosts[i];
-      (*CZlistItr)->noParts = CZparts[i];
-      i++;
-      CZlistItr++;
+      CZbottom[i]->relCost = CZcosts[i];
+      CZbottom[i]->noParts = CZparts[i];
    }
 #endif
    ///
@@ -246,7 +344,7 @@ void BHTreeCZBuilder::refineCZcell(const czllPtrT _czllPtr)
    {
       if (static_cast<gcllPtrT>(curPtr)->child[i] == NULL)
       {
-         static_cast<gcllPtrT>(curPtr)->child[i] = new czllT;
+         static_cast<gcllPtrT>(curPtr)->child[i] = newCZll();
          goChild(i);
          static_cast<czllPtrT>(curPtr)->clear();
          curPtr->parent = _czllPtr;
@@ -258,7 +356,7 @@ void BHTreeCZBuilder::refineCZcell(const czllPtrT _czllPtr)
          const pnodPtrT resPartPtr =
             static_cast<pnodPtrT>(static_cast<gcllPtrT>(curPtr)->child[i]);
 
-         static_cast<gcllPtrT>(curPtr)->child[i] = new czllT;
+         static_cast<gcllPtrT>(curPtr)->child[i] = newCZll();
 
          goChild(i);
          static_cast<czllPtrT>(curPtr)->clear();
@@ -276,11 +374,16 @@ void BHTreeCZBuilder::refineCZcell(const czllPtrT _czllPtr)
       {
          const qcllPtrT oldCell =
             static_cast<qcllPtrT>(static_cast<gcllPtrT>(curPtr)->child[i]);
-         static_cast<gcllPtrT>(curPtr)->child[i] = new czllT;
+
+         // the children of CZ cells need to be in their octants
+         if (oldCell->isBucket)
+            bucketToCell(oldCell);
+
+         static_cast<gcllPtrT>(curPtr)->child[i] = newCZll();
          goChild(i);
          static_cast<czllPtrT>(curPtr)->clear();
          static_cast<czllPtrT>(curPtr)->initFromCell(*oldCell);
-         delete oldCell;
+         delCell(oldCell);
          goUp();
       }
    }
@@ -370,12 +473,15 @@ void BHTreeCZBuilder::gatherCZcell(const czllPtrT _czllPtr)
                   gathOrphLast       = oldCell->orphLast;
                }
             }
-            treePtr->CZbottom.remove(oldCell);
+            noCZbottom--;
             _czllPtr->child[i] = czllToCell(oldCell);
          }
          else
          {
-            gatherCZcell(static_cast<czllPtrT>(_czllPtr->child[i]));
+            const czllPtrT oldCell = static_cast<czllPtrT>(_czllPtr->child[i]);
+
+            gatherCZcell(oldCell);
+            _czllPtr->child[i] = czllToCell(oldCell);
          }
       }
    }
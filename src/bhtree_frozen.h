@@ -0,0 +1,529 @@
+#ifndef BHTREE_FROZEN_H
+#define BHTREE_FROZEN_H
+
+/*
+ *  bhtree_frozen.h
+ *
+ *  read-only snapshot of the dynamic tree for the walks. the nodes
+ *  are stored in contiguous arrays in the order of the next-walk
+ *  and are linked by 32-bit indices, so the next node of a walk is
+ *  always the following array element. the fields needed by every
+ *  walk step are kept apart from the quadrupole moments and the
+ *  cell geometry, which are only stored for the cells and are found
+ *  over the cell index of a node.
+ *
+ *  Created by Andreas Reufer on 20.01.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <cassert>
+#include <stdint.h>
+#include <vector>
+
+#include "bhtree_nodes.h"
+#include "bhtree_particle.h"
+
+namespace sphlatch {
+class BHTreeFrozen {
+public:
+   typedef uint32_t   idxT;
+
+   ///
+   /// the parent index of the root node
+   ///
+   static const idxT nil = 0xffffffff;
+
+   ///
+   /// fields used in every step of a walk. for particles com is the
+   /// particle position and clSz is zero. the skip index of the nodes
+   /// at the end of the walk points behind the last node. cell is the
+   /// index of the cell data and only set for cells.
+   ///
+   class hotNode {
+public:
+      vect3dT com;
+      fType   m;
+      fType   clSz;
+      idxT    skip;
+      idxT    cell       : 31;
+      idxT    isParticle : 1;
+   };
+
+   class quadNode {
+public:
+      fType q11, q22, q33, q12, q13, q23;
+   };
+
+   ///
+   /// the traceless octupole and hexadecapole moments, the symmetric
+   /// components are stored in lexicographic order of their sorted
+   /// indices (xxx, xxy, xxz, xyy, xyz, xzz, yyy, ...)
+   ///
+   class octNode {
+public:
+      fType o[10];
+   };
+
+   class hexNode {
+public:
+      fType h[15];
+   };
+
+   ///
+   /// the data of every node
+   ///
+   std::vector<hotNode>     hot;
+   std::vector<idxT>        parent;
+   std::vector<idxT>        noParts;
+   std::vector<treeghoPtrT> part;
+
+   ///
+   /// the data of the cells only. the higher moments are only present
+   /// up to the multipole order of the last calcMultipoles()
+   ///
+   std::vector<quadNode> quad;
+   std::vector<vect3dT>  cen;
+   std::vector<fType>    rmax;
+   std::vector<octNode>  oct;
+   std::vector<hexNode>  hex;
+   size_t mpOrder;
+
+   BHTreeFrozen() : mpOrder(2) { }
+
+   idxT size() const
+   {
+      return(static_cast<idxT>(hot.size()));
+   }
+
+   idxT getNoCells() const
+   {
+      return(static_cast<idxT>(quad.size()));
+   }
+
+   size_t getNoBytes() const
+   {
+      return(hot.size() * (sizeof(hotNode) + 2 * sizeof(idxT) +
+                           sizeof(treeghoPtrT)) +
+             quad.size() * (sizeof(quadNode) + sizeof(vect3dT) +
+                            sizeof(fType)) +
+             oct.size() * sizeof(octNode) + hex.size() * sizeof(hexNode));
+   }
+
+   ///
+   /// add the particles and the extent of node <_idx> to its parent,
+   /// rmax is the distance of the farthest particle from the center
+   /// of mass
+   ///
+   void addToParent(const idxT _idx)
+   {
+      const idxT par = parent[_idx];
+      noParts[par] += noParts[_idx];
+
+      if (noParts[_idx] > 0)
+      {
+         const vect3dT off  = hot[_idx].com - hot[par].com;
+         const fType   rm   = hot[_idx].isParticle ?
+                              0. : rmax[hot[_idx].cell];
+         const fType   dist = sqrt(dot(off, off)) + rm;
+         fType&        rmp(rmax[hot[par].cell]);
+         rmp = dist > rmp ? dist : rmp;
+      }
+   }
+
+   ///
+   /// calculate the moments above the quadrupoles up to order <_order>
+   /// for the whole tree. the raw moments of a node are complete when
+   /// all nodes behind it have been added to their parents, they are
+   /// then shifted to the parent and made traceless.
+   ///
+   void calcMultipoles(const size_t _order)
+   {
+      mpOrder = _order;
+      oct.clear();
+      hex.clear();
+      if (mpOrder < 3)
+         return;
+
+      const idxT noNodes = size();
+      const idxT noCells = getNoCells();
+      const octNode octZero = { { 0. } };
+      const hexNode hexZero = { { 0. } };
+
+      oct.resize(noCells, octZero);
+      if (mpOrder > 3)
+         hex.resize(noCells, hexZero);
+
+      ///
+      /// the trace of the second moment, which is lost
+      /// in the traceless quadrupole
+      ///
+      std::vector<fType> trace(noCells, 0.);
+
+      for (idxT idx = noNodes - 1; idx > 0; idx--)
+      {
+         const idxT par = parent[idx];
+         if (noParts[idx] > 0)
+            shiftToParent(idx, par, trace);
+         if (not hot[idx].isParticle)
+            detrace(hot[idx].cell);
+      }
+      detrace(hot[0].cell);
+   }
+
+   ///
+   /// make this the part of <_tree> with the particles selected by
+   /// <_sel>, a functor returning true for the treeghoPtrT of the
+   /// wanted particles. the cells without any of them are dropped,
+   /// the walk order is kept and the moments are summed up again
+   /// from the selected particles alone. the root is always kept.
+   ///
+   template<typename _selT>
+   void setSubset(const BHTreeFrozen& _tree, const _selT& _sel)
+   {
+      const idxT noSrc = _tree.size();
+      assert(noSrc > 0);
+
+      std::vector<bool> keep(noSrc, false);
+      for (idxT idx = noSrc; idx > 0; idx--)
+      {
+         const idxT src = idx - 1;
+         if (_tree.hot[src].isParticle)
+            keep[src] = _sel(_tree.part[src]);
+         if (keep[src] && src > 0)
+            keep[_tree.parent[src]] = true;
+      }
+      keep[0] = true;
+
+      ///
+      /// the new index of the kept nodes and, for the skip indices,
+      /// of the first kept node at or behind every node
+      ///
+      std::vector<idxT> next(noSrc + 1);
+      idxT noNodes = 0, noCells = 0;
+      for (idxT src = 0; src < noSrc; src++)
+      {
+         if (keep[src])
+         {
+            next[src] = noNodes++;
+            if (not _tree.hot[src].isParticle)
+               noCells++;
+         }
+      }
+      next[noSrc] = noNodes;
+      for (idxT idx = noSrc; idx > 0; idx--)
+      {
+         if (not keep[idx - 1])
+            next[idx - 1] = next[idx];
+      }
+
+      resize(noNodes, noCells);
+      idxT cell = 0;
+      for (idxT src = 0; src < noSrc; src++)
+      {
+         if (not keep[src])
+            continue;
+
+         const idxT idx = next[src];
+         hot[idx]      = _tree.hot[src];
+         hot[idx].skip = next[_tree.hot[src].skip];
+         part[idx]     = _tree.part[src];
+         parent[idx]   = src > 0 ? next[_tree.parent[src]] : nil;
+         noParts[idx]  = _tree.noParts[src];
+
+         if (not hot[idx].isParticle)
+         {
+            const quadNode quadZero = { 0., 0., 0., 0., 0., 0. };
+            hot[idx].cell = cell;
+            hot[idx].m    = 0.;
+            hot[idx].com  = 0., 0., 0.;
+            noParts[idx]  = 0;
+            quad[cell]    = quadZero;
+            cen[cell]     = _tree.cen[_tree.hot[src].cell];
+            rmax[cell]    = 0.;
+            cell++;
+         }
+      }
+
+      ///
+      /// masses and centers of mass, a node is complete when all
+      /// nodes behind it have been added to their parents
+      ///
+      for (idxT idx = noNodes; idx > 0; idx--)
+      {
+         hotNode& node(hot[idx - 1]);
+         if (not node.isParticle)
+         {
+            if (node.m > 0.)
+               node.com /= node.m;
+            else
+               node.com = cen[node.cell];
+         }
+         if (idx > 1)
+         {
+            hotNode& par(hot[parent[idx - 1]]);
+            par.m   += node.m;
+            par.com += node.m * node.com;
+         }
+      }
+
+      ///
+      /// the quadrupole moments, the number of
+      /// particles and the extent of the cells
+      ///
+      for (idxT idx = noNodes - 1; idx > 0; idx--)
+      {
+         const idxT    par = parent[idx];
+         const vect3dT d   = hot[idx].com - hot[par].com;
+         const fType   m   = hot[idx].m;
+         const fType   dd  = dot(d, d);
+         quadNode&     qp(quad[hot[par].cell]);
+
+         qp.q11 += (3. * d[0] * d[0] - dd) * m;
+         qp.q22 += (3. * d[1] * d[1] - dd) * m;
+         qp.q33 += (3. * d[2] * d[2] - dd) * m;
+         qp.q12 += 3. * d[0] * d[1] * m;
+         qp.q13 += 3. * d[0] * d[2] * m;
+         qp.q23 += 3. * d[1] * d[2] * m;
+
+         if (not hot[idx].isParticle)
+         {
+            const quadNode& qn(quad[hot[idx].cell]);
+            qp.q11 += qn.q11;
+            qp.q22 += qn.q22;
+            qp.q33 += qn.q33;
+            qp.q12 += qn.q12;
+            qp.q13 += qn.q13;
+            qp.q23 += qn.q23;
+         }
+
+         addToParent(idx);
+      }
+
+      calcMultipoles(_tree.mpOrder);
+   }
+
+   ///
+   /// the highest nodes with at most <_maxParts> particles below
+   /// them, together they hold every particle once. the walks for
+   /// the particles of a tree can be split up along these nodes.
+   ///
+   std::vector<idxT> getCover(const idxT _maxParts) const
+   {
+      std::vector<idxT> cover;
+
+      const idxT noNodes = size();
+      idxT       idx     = 0;
+      while (idx < noNodes)
+      {
+         if (noParts[idx] > _maxParts)
+            idx++;
+         else
+         {
+            if (noParts[idx] > 0)
+               cover.push_back(idx);
+            idx = hot[idx].skip;
+         }
+      }
+      return(cover);
+   }
+
+   void resize(const idxT _noNodes, const idxT _noCells)
+   {
+      hot.resize(_noNodes);
+      parent.resize(_noNodes);
+      noParts.resize(_noNodes);
+      part.resize(_noNodes);
+
+      quad.resize(_noCells);
+      cen.resize(_noCells);
+      rmax.resize(_noCells);
+   }
+
+private:
+   ///
+   /// index of the symmetric component with <_nx> x- and <_ny>
+   /// y-indices among the <_n> indices
+   ///
+   static size_t countIdx(const size_t _nx, const size_t _ny,
+                          const size_t _n)
+   {
+      const size_t m = _n - _nx;
+      return(m * (m + 1) / 2 + m - _ny);
+   }
+
+   static size_t symIdx(const size_t _a, const size_t _b)
+   {
+      return(countIdx((_a == 0) + (_b == 0), (_a == 1) + (_b == 1), 2));
+   }
+
+   static size_t symIdx(const size_t _a, const size_t _b, const size_t _c)
+   {
+      return(countIdx((_a == 0) + (_b == 0) + (_c == 0),
+                      (_a == 1) + (_b == 1) + (_c == 1), 3));
+   }
+
+   static size_t symIdx(const size_t _a, const size_t _b, const size_t _c,
+                        const size_t _d)
+   {
+      return(countIdx((_a == 0) + (_b == 0) + (_c == 0) + (_d == 0),
+                      (_a == 1) + (_b == 1) + (_c == 1) + (_d == 1), 4));
+   }
+
+   ///
+   /// add the raw moments of node <_idx> around its center of mass
+   /// to those of the parent <_par> around the parent center of mass,
+   /// a particle has no moments of its own
+   ///
+   void shiftToParent(const idxT _idx, const idxT _par,
+                      std::vector<fType>& _trace)
+   {
+      static const octNode octZero = { { 0. } };
+      static const hexNode hexZero = { { 0. } };
+
+      const bool    isCell = not hot[_idx].isParticle;
+      const idxT    cell   = hot[_idx].cell;
+      const idxT    parc   = hot[_par].cell;
+      const vect3dT d      = hot[_idx].com - hot[_par].com;
+      const fType   m      = hot[_idx].m;
+      const fType   tr     = isCell ? _trace[cell] : 0.;
+
+      fType s2[6] = { 0., 0., 0., 0., 0., 0. };
+      if (isCell)
+      {
+         const quadNode& qn(quad[cell]);
+         const fType     qd[6] = { qn.q11, qn.q12, qn.q13,
+                                   qn.q22, qn.q23, qn.q33 };
+         for (size_t c = 0; c < 6; c++)
+            s2[c] = qd[c] / 3.;
+         s2[0] += tr / 3.;
+         s2[3] += tr / 3.;
+         s2[5] += tr / 3.;
+      }
+
+      _trace[parc] += tr + m * dot(d, d);
+
+      const fType* const s3 = isCell ? oct[cell].o : octZero.o;
+      fType* const       p3 = oct[parc].o;
+      for (size_t i = 0; i < 3; i++)
+         for (size_t j = i; j < 3; j++)
+            for (size_t k = j; k < 3; k++)
+               p3[symIdx(i, j, k)] += s3[symIdx(i, j, k)]
+                                      + d[i] * s2[symIdx(j, k)]
+                                      + d[j] * s2[symIdx(i, k)]
+                                      + d[k] * s2[symIdx(i, j)]
+                                      + m * d[i] * d[j] * d[k];
+
+      if (mpOrder < 4)
+         return;
+
+      const fType* const s4 = isCell ? hex[cell].h : hexZero.h;
+      fType* const       p4 = hex[parc].h;
+      for (size_t i = 0; i < 3; i++)
+         for (size_t j = i; j < 3; j++)
+            for (size_t k = j; k < 3; k++)
+               for (size_t l = k; l < 3; l++)
+                  p4[symIdx(i, j, k, l)] += s4[symIdx(i, j, k, l)]
+                                            + d[i] * s3[symIdx(j, k, l)]
+                                            + d[j] * s3[symIdx(i, k, l)]
+                                            + d[k] * s3[symIdx(i, j, l)]
+                                            + d[l] * s3[symIdx(i, j, k)]
+                                            + d[i] * d[j] * s2[symIdx(k, l)]
+                                            + d[i] * d[k] * s2[symIdx(j, l)]
+                                            + d[i] * d[l] * s2[symIdx(j, k)]
+                                            + d[j] * d[k] * s2[symIdx(i, l)]
+                                            + d[j] * d[l] * s2[symIdx(i, k)]
+                                            + d[k] * d[l] * s2[symIdx(i, j)]
+                                            + m * d[i] * d[j] * d[k] * d[l];
+   }
+
+   ///
+   /// replace the raw moments of cell <_cell> by their traceless part
+   ///
+   void detrace(const idxT _cell)
+   {
+      fType* const s3 = oct[_cell].o;
+      fType        t[3];
+      for (size_t a = 0; a < 3; a++)
+         t[a] = s3[symIdx(a, 0, 0)] + s3[symIdx(a, 1, 1)] +
+                s3[symIdx(a, 2, 2)];
+
+      for (size_t i = 0; i < 3; i++)
+         for (size_t j = i; j < 3; j++)
+            for (size_t k = j; k < 3; k++)
+               s3[symIdx(i, j, k)] -= 0.2 * ((i == j) * t[k] +
+                                             (i == k) * t[j] +
+                                             (j == k) * t[i]);
+
+      if (mpOrder < 4)
+         return;
+
+      fType* const s4 = hex[_cell].h;
+      fType        w[3][3];
+      for (size_t a = 0; a < 3; a++)
+         for (size_t b = 0; b < 3; b++)
+            w[a][b] = s4[symIdx(a, b, 0, 0)] + s4[symIdx(a, b, 1, 1)] +
+                      s4[symIdx(a, b, 2, 2)];
+      const fType tt = w[0][0] + w[1][1] + w[2][2];
+
+      for (size_t i = 0; i < 3; i++)
+         for (size_t j = i; j < 3; j++)
+            for (size_t k = j; k < 3; k++)
+               for (size_t l = k; l < 3; l++)
+                  s4[symIdx(i, j, k, l)] +=
+                     -(1. / 7.) * ((i == j) * w[k][l] + (i == k) * w[j][l] +
+                                   (i == l) * w[j][k] + (j == k) * w[i][l] +
+                                   (j == l) * w[i][k] + (k == l) * w[i][j])
+                     + (1. / 35.) * tt * ((i == j) * (k == l) +
+                                          (i == k) * (j == l) +
+                                          (i == l) * (j == k));
+   }
+
+public:
+   ///
+   /// copy the data of a tree node to its entry, a cell
+   /// gets the cell data with index <_cell>
+   ///
+   void set(const idxT _idx, const nodePtrT _node, const idxT _cell)
+   {
+      hotNode& hn(hot[_idx]);
+
+      hn.isParticle = _node->isParticle;
+      if (_node->isParticle)
+      {
+         const pnodPtrT pnod = static_cast<pnodPtrT>(_node);
+         hn.com  = pnod->pos;
+         hn.m    = pnod->m;
+         hn.clSz = 0.;
+         hn.skip = _idx + 1;
+         hn.cell = 0;
+
+         noParts[_idx] = 1;
+         part[_idx]    = static_cast<treeghoPtrT>(pnod);
+      }
+      else
+      {
+         const qcllPtrT qcll = static_cast<qcllPtrT>(_node);
+         hn.com  = qcll->com;
+         hn.m    = qcll->m;
+         hn.clSz = qcll->clSz;
+         hn.cell = _cell;
+
+         quadNode& qn(quad[_cell]);
+         qn.q11 = qcll->q11;
+         qn.q22 = qcll->q22;
+         qn.q33 = qcll->q33;
+         qn.q12 = qcll->q12;
+         qn.q13 = qcll->q13;
+         qn.q23 = qcll->q23;
+
+         cen[_cell]    = qcll->cen;
+         rmax[_cell]   = 0.;
+         noParts[_idx] = 0;
+         part[_idx]    = NULL;
+      }
+   }
+};
+};
+
+#endif
@@ -0,0 +1,746 @@
+#ifndef BHTREE_GRAV_KERNELS_CPP
+#define BHTREE_GRAV_KERNELS_CPP
+
+/*
+ *  bhtree_grav_kernels.cpp
+ *
+ *  batched gravity kernels for the interaction lists of the grouped
+ *  tree walks. the sources are kept in structure-of-arrays buffers
+ *  and the kernels are written once for a small vector class, which
+ *  maps to AVX-512 or AVX2 when compiling for these and to plain
+ *  scalars otherwise. the buffers store the sources either in double
+ *  or in single precision, the latter doubles the width of the vector
+ *  lanes. the sums over a buffer are always added up in double. the
+ *  softening of the particle sources is the gravSoftening policy
+ *  (see bhtree_grav_softening.cpp). sources at zero distance do not
+ *  contribute.
+ *
+ *  Created by Andreas Reufer on 27.01.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <cmath>
+#include <vector>
+
+#include "typedefs.h"
+#include "bhtree_grav_vectors.cpp"
+#include "bhtree_grav_softening.cpp"
+
+namespace sphlatch {
+///
+/// the sources of a buffer are stored relative to <origin>, with the
+/// lengths in units of <len> and the masses in units of <mass>. with
+/// a frame fitting the sources, the moments stay well inside the
+/// range of single precision also for physical units.
+///
+class gravFrame {
+public:
+   gravFrame()
+   {
+      vect3dT zero;
+      zero = 0., 0., 0.;
+      setFrame(zero, 1., 1.);
+   }
+
+   void setFrame(const vect3dT& _origin, const fType _len, const fType _mass)
+   {
+      origin = _origin;
+      len    = _len;
+      mass   = _mass;
+      Olen   = 1. / _len;
+      Omass  = 1. / _mass;
+   }
+
+   vect3dT toFrame(const vect3dT& _pos) const
+   {
+      return((_pos - origin) * Olen);
+   }
+
+   fType accScale() const
+   {
+      return(mass * Olen * Olen);
+   }
+
+   fType potScale() const
+   {
+      return(mass * Olen);
+   }
+
+protected:
+   vect3dT origin;
+   fType   len, mass, Olen, Omass;
+};
+
+///
+/// particle sources: position, mass, softening length and its inverse
+///
+template<typename _realT>
+class gravPartBuffer : public gravFrame {
+public:
+   typedef _realT   realT;
+
+   std::vector<_realT> x, y, z, m, s, Os;
+
+   size_t size() const
+   {
+      return(x.size());
+   }
+
+   void clear()
+   {
+      x.clear();
+      y.clear();
+      z.clear();
+      m.clear();
+      s.clear();
+      Os.clear();
+   }
+
+   void push(const vect3dT& _pos, const fType _m, const fType _s)
+   {
+      const vect3dT pos = toFrame(_pos);
+
+      x.push_back(static_cast<_realT>(pos[0]));
+      y.push_back(static_cast<_realT>(pos[1]));
+      z.push_back(static_cast<_realT>(pos[2]));
+      m.push_back(static_cast<_realT>(_m * Omass));
+      s.push_back(static_cast<_realT>(_s * Olen));
+      Os.push_back(static_cast<_realT>(invSoftening(_s * Olen)));
+   }
+};
+
+///
+/// cell sources: center of mass, mass and quadrupole moments
+///
+template<typename _realT>
+class gravCellBuffer : public gravFrame {
+public:
+   typedef _realT   realT;
+
+   std::vector<_realT> x, y, z, m;
+   std::vector<_realT> q11, q22, q33, q12, q13, q23;
+
+   size_t size() const
+   {
+      return(x.size());
+   }
+
+   void clear()
+   {
+      x.clear();
+      y.clear();
+      z.clear();
+      m.clear();
+      q11.clear();
+      q22.clear();
+      q33.clear();
+      q12.clear();
+      q13.clear();
+      q23.clear();
+   }
+
+   template<typename _qT>
+   void push(const vect3dT& _com, const fType _m, const _qT& _q)
+   {
+      const vect3dT com = toFrame(_com);
+      const fType   qs  = Omass * Olen * Olen;
+
+      x.push_back(static_cast<_realT>(com[0]));
+      y.push_back(static_cast<_realT>(com[1]));
+      z.push_back(static_cast<_realT>(com[2]));
+      m.push_back(static_cast<_realT>(_m * Omass));
+      q11.push_back(static_cast<_realT>(_q.q11 * qs));
+      q22.push_back(static_cast<_realT>(_q.q22 * qs));
+      q33.push_back(static_cast<_realT>(_q.q33 * qs));
+      q12.push_back(static_cast<_realT>(_q.q12 * qs));
+      q13.push_back(static_cast<_realT>(_q.q13 * qs));
+      q23.push_back(static_cast<_realT>(_q.q23 * qs));
+   }
+};
+
+///
+/// cell sources with moments above the quadrupoles: center of mass
+/// and the traceless octupole and, for an order of 4, hexadecapole
+/// moments with the components ordered as in the frozen tree
+///
+template<typename _realT>
+class gravMPBuffer : public gravFrame {
+public:
+   typedef _realT   realT;
+
+   std::vector<_realT> x, y, z;
+   std::vector<_realT> o[10];
+   std::vector<_realT> h[15];
+
+   gravMPBuffer() : order(3) { }
+
+   size_t size() const
+   {
+      return(x.size());
+   }
+
+   size_t getOrder() const
+   {
+      return(order);
+   }
+
+   void clear(const size_t _order)
+   {
+      order = _order;
+      x.clear();
+      y.clear();
+      z.clear();
+      for (size_t c = 0; c < 10; c++)
+         o[c].clear();
+      for (size_t c = 0; c < 15; c++)
+         h[c].clear();
+   }
+
+   void push(const vect3dT& _com, const fType* _o, const fType* _h)
+   {
+      const vect3dT com = toFrame(_com);
+      const fType   os  = Omass * Olen * Olen * Olen;
+
+      x.push_back(static_cast<_realT>(com[0]));
+      y.push_back(static_cast<_realT>(com[1]));
+      z.push_back(static_cast<_realT>(com[2]));
+      for (size_t c = 0; c < 10; c++)
+         o[c].push_back(static_cast<_realT>(_o[c] * os));
+      if (order > 3)
+         for (size_t c = 0; c < 15; c++)
+            h[c].push_back(static_cast<_realT>(_h[c] * os * Olen));
+   }
+
+private:
+   size_t order;
+};
+
+///
+/// the kernels sum up the interactions of all sources in a buffer
+/// with a particle at <_ppos>, the results are added to <_acc> and
+/// <_pot>. the widest available vector class handles the bulk of
+/// the sources, the scalar one the remainder.
+///
+class GravityKernels {
+public:
+   template<typename _realT>
+   static void accPP(const gravPartBuffer<_realT>& _b, const vect3dT& _ppos,
+                     vect3dT& _acc);
+   template<typename _realT>
+   static void potPP(const gravPartBuffer<_realT>& _b, const vect3dT& _ppos,
+                     fType& _pot);
+   template<typename _realT>
+   static void accPC(const gravCellBuffer<_realT>& _b, const vect3dT& _ppos,
+                     vect3dT& _acc);
+   template<typename _realT>
+   static void potPC(const gravCellBuffer<_realT>& _b, const vect3dT& _ppos,
+                     fType& _pot);
+   template<typename _realT>
+   static void accMP(const gravMPBuffer<_realT>& _b, const vect3dT& _ppos,
+                     vect3dT& _acc);
+   template<typename _realT>
+   static void potMP(const gravMPBuffer<_realT>& _b, const vect3dT& _ppos,
+                     fType& _pot);
+
+   ///
+   /// the octupole and hexadecapole terms of the traceless moments
+   /// <_o> and <_h> at the distance (rx,ry,rz) from the center of
+   /// mass, with Or2 = 1/r^2 and OrN = 1/r^N. with v = M r^(n-1) and
+   /// a = v r for the moment M of order n, the terms are
+   ///
+   ///   pot = - (2n-1)!!/n! a / r^(2n+1)
+   ///   acc = n (2n-1)!!/n! v / r^(2n+1) - (2n+1)!!/n! a r / r^(2n+3)
+   ///
+   template<typename _vT>
+   static void accOct(const _vT* _o, const _vT& _rx, const _vT& _ry,
+                      const _vT& _rz, const _vT& _Or2, const _vT& _Or7,
+                      _vT& _ax, _vT& _ay, _vT& _az);
+   template<typename _vT>
+   static void accHex(const _vT* _h, const _vT& _rx, const _vT& _ry,
+                      const _vT& _rz, const _vT& _Or2, const _vT& _Or9,
+                      _vT& _ax, _vT& _ay, _vT& _az);
+   template<typename _vT>
+   static _vT potOct(const _vT* _o, const _vT& _rx, const _vT& _ry,
+                     const _vT& _rz, const _vT& _Or7);
+   template<typename _vT>
+   static _vT potHex(const _vT* _h, const _vT& _rx, const _vT& _ry,
+                     const _vT& _rz, const _vT& _Or9);
+
+private:
+   template<typename _vT>
+   static _vT contractOct(const _vT* _o, const _vT& _rx, const _vT& _ry,
+                          const _vT& _rz, _vT& _vx, _vT& _vy, _vT& _vz);
+   template<typename _vT>
+   static _vT contractHex(const _vT* _h, const _vT& _rx, const _vT& _ry,
+                          const _vT& _rz, _vT& _vx, _vT& _vy, _vT& _vz);
+
+   ///
+   /// the loops work in the frame of the buffer and add
+   /// the unscaled sums to <_acc> or <_pot>
+   ///
+   template<typename _vT, typename _bT>
+   static void accMPLoop(const _bT& _b, const vect3dT& _ppos,
+                         size_t& _j, vect3dT& _acc);
+   template<typename _vT, typename _bT>
+   static void potMPLoop(const _bT& _b, const vect3dT& _ppos,
+                         size_t& _j, fType& _pot);
+   template<typename _vT, typename _bT>
+   static void accPPLoop(const _bT& _b, const vect3dT& _ppos,
+                         size_t& _j, vect3dT& _acc);
+   template<typename _vT, typename _bT>
+   static void potPPLoop(const _bT& _b, const vect3dT& _ppos,
+                         size_t& _j, fType& _pot);
+   template<typename _vT, typename _bT>
+   static void accPCLoop(const _bT& _b, const vect3dT& _ppos,
+                         size_t& _j, vect3dT& _acc);
+   template<typename _vT, typename _bT>
+   static void potPCLoop(const _bT& _b, const vect3dT& _ppos,
+                         size_t& _j, fType& _pot);
+};
+
+template<typename _realT>
+void GravityKernels::accPP(const gravPartBuffer<_realT>& _b,
+                           const vect3dT& _ppos, vect3dT& _acc)
+{
+   typedef gravVectors<_realT>   vectorsT;
+
+   const vect3dT ppos = _b.toFrame(_ppos);
+   vect3dT sum;
+   sum = 0., 0., 0.;
+
+   size_t j = 0;
+#ifdef SPHLATCH_GRAVITY_SIMD
+   accPPLoop<typename vectorsT::vectorT>(_b, ppos, j, sum);
+#endif
+   accPPLoop<typename vectorsT::scalarT>(_b, ppos, j, sum);
+
+   _acc += _b.accScale() * sum;
+}
+
+template<typename _realT>
+void GravityKernels::potPP(const gravPartBuffer<_realT>& _b,
+                           const vect3dT& _ppos, fType& _pot)
+{
+   typedef gravVectors<_realT>   vectorsT;
+
+   const vect3dT ppos = _b.toFrame(_ppos);
+   fType sum = 0.;
+
+   size_t j = 0;
+#ifdef SPHLATCH_GRAVITY_SIMD
+   potPPLoop<typename vectorsT::vectorT>(_b, ppos, j, sum);
+#endif
+   potPPLoop<typename vectorsT::scalarT>(_b, ppos, j, sum);
+
+   _pot += _b.potScale() * sum;
+}
+
+template<typename _realT>
+void GravityKernels::accPC(const gravCellBuffer<_realT>& _b,
+                           const vect3dT& _ppos, vect3dT& _acc)
+{
+   typedef gravVectors<_realT>   vectorsT;
+
+   const vect3dT ppos = _b.toFrame(_ppos);
+   vect3dT sum;
+   sum = 0., 0., 0.;
+
+   size_t j = 0;
+#ifdef SPHLATCH_GRAVITY_SIMD
+   accPCLoop<typename vectorsT::vectorT>(_b, ppos, j, sum);
+#endif
+   accPCLoop<typename vectorsT::scalarT>(_b, ppos, j, sum);
+
+   _acc += _b.accScale() * sum;
+}
+
+template<typename _realT>
+void GravityKernels::potPC(const gravCellBuffer<_realT>& _b,
+                           const vect3dT& _ppos, fType& _pot)
+{
+   typedef gravVectors<_realT>   vectorsT;
+
+   const vect3dT ppos = _b.toFrame(_ppos);
+   fType sum = 0.;
+
+   size_t j = 0;
+#ifdef SPHLATCH_GRAVITY_SIMD
+   potPCLoop<typename vectorsT::vectorT>(_b, ppos, j, sum);
+#endif
+   potPCLoop<typename vectorsT::scalarT>(_b, ppos, j, sum);
+
+   _pot += _b.potScale() * sum;
+}
+
+template<typename _realT>
+void GravityKernels::accMP(const gravMPBuffer<_realT>& _b,
+                           const vect3dT& _ppos, vect3dT& _acc)
+{
+   typedef gravVectors<_realT>   vectorsT;
+
+   const vect3dT ppos = _b.toFrame(_ppos);
+   vect3dT sum;
+   sum = 0., 0., 0.;
+
+   size_t j = 0;
+#ifdef SPHLATCH_GRAVITY_SIMD
+   accMPLoop<typename vectorsT::vectorT>(_b, ppos, j, sum);
+#endif
+   accMPLoop<typename vectorsT::scalarT>(_b, ppos, j, sum);
+
+   _acc += _b.accScale() * sum;
+}
+
+template<typename _realT>
+void GravityKernels::potMP(const gravMPBuffer<_realT>& _b,
+                           const vect3dT& _ppos, fType& _pot)
+{
+   typedef gravVectors<_realT>   vectorsT;
+
+   const vect3dT ppos = _b.toFrame(_ppos);
+   fType sum = 0.;
+
+   size_t j = 0;
+#ifdef SPHLATCH_GRAVITY_SIMD
+   potMPLoop<typename vectorsT::vectorT>(_b, ppos, j, sum);
+#endif
+   potMPLoop<typename vectorsT::scalarT>(_b, ppos, j, sum);
+
+   _pot += _b.potScale() * sum;
+}
+
+template<typename _vT, typename _bT>
+void GravityKernels::accPPLoop(const _bT&    _b,
+                             const vect3dT& _ppos,
+                             size_t&        _j,
+                             vect3dT&       _acc)
+{
+   const size_t n = _b.size();
+
+   const _vT px(_ppos[0]), py(_ppos[1]), pz(_ppos[2]);
+   const _vT zero(0.);
+   _vT       ax(0.), ay(0.), az(0.);
+
+   for (; _j + _vT::width <= n; _j += _vT::width)
+   {
+      const _vT rx = px - _vT::load(&_b.x[_j]);
+      const _vT ry = py - _vT::load(&_b.y[_j]);
+      const _vT rz = pz - _vT::load(&_b.z[_j]);
+      const _vT m  = _vT::load(&_b.m[_j]);
+      const _vT rr = rx * rx + ry * ry + rz * rz;
+      const _vT r  = _vT::sqrt(rr);
+      const _vT h  = _vT::load(&_b.s[_j]);
+      const _vT Oh = _vT::load(&_b.Os[_j]);
+
+      const _vT mOr3 = m * gravSoftening::OsmoR3(r, rr, h, Oh);
+      const _vT f    = _vT::select(_vT::gt(rr, zero), mOr3, zero);
+
+      ax = ax - f * rx;
+      ay = ay - f * ry;
+      az = az - f * rz;
+   }
+
+   _acc[0] += ax.sum();
+   _acc[1] += ay.sum();
+   _acc[2] += az.sum();
+}
+
+template<typename _vT, typename _bT>
+void GravityKernels::potPPLoop(const _bT&    _b,
+                             const vect3dT& _ppos,
+                             size_t&        _j,
+                             fType&         _pot)
+{
+   const size_t n = _b.size();
+
+   const _vT px(_ppos[0]), py(_ppos[1]), pz(_ppos[2]);
+   const _vT zero(0.);
+   _vT       pot(0.);
+
+   for (; _j + _vT::width <= n; _j += _vT::width)
+   {
+      const _vT rx = px - _vT::load(&_b.x[_j]);
+      const _vT ry = py - _vT::load(&_b.y[_j]);
+      const _vT rz = pz - _vT::load(&_b.z[_j]);
+      const _vT m  = _vT::load(&_b.m[_j]);
+      const _vT rr = rx * rx + ry * ry + rz * rz;
+      const _vT r  = _vT::sqrt(rr);
+      const _vT h  = _vT::load(&_b.s[_j]);
+      const _vT Oh = _vT::load(&_b.Os[_j]);
+
+      const _vT mOr = m * gravSoftening::OsmoR1(r, rr, h, Oh);
+      pot = pot - _vT::select(_vT::gt(rr, zero), mOr, zero);
+   }
+
+   _pot += pot.sum();
+}
+
+template<typename _vT, typename _bT>
+void GravityKernels::accPCLoop(const _bT&    _b,
+                             const vect3dT& _ppos,
+                             size_t&        _j,
+                             vect3dT&       _acc)
+{
+   const size_t n = _b.size();
+
+   const _vT px(_ppos[0]), py(_ppos[1]), pz(_ppos[2]);
+   const _vT two(2.), twoHalf(2.5);
+   _vT       ax(0.), ay(0.), az(0.);
+
+   for (; _j + _vT::width <= n; _j += _vT::width)
+   {
+      const _vT rx = px - _vT::load(&_b.x[_j]);
+      const _vT ry = py - _vT::load(&_b.y[_j]);
+      const _vT rz = pz - _vT::load(&_b.z[_j]);
+      const _vT m  = _vT::load(&_b.m[_j]);
+      const _vT rr = rx * rx + ry * ry + rz * rz;
+      const _vT r  = _vT::sqrt(rr);
+
+      const _vT Or3 = _vT(1.) / (r * rr);
+      const _vT Or5 = Or3 / rr;
+      const _vT Or7 = Or5 / rr;
+
+      const _vT q11 = _vT::load(&_b.q11[_j]);
+      const _vT q22 = _vT::load(&_b.q22[_j]);
+      const _vT q33 = _vT::load(&_b.q33[_j]);
+      const _vT q12 = _vT::load(&_b.q12[_j]);
+      const _vT q13 = _vT::load(&_b.q13[_j]);
+      const _vT q23 = _vT::load(&_b.q23[_j]);
+
+      const _vT q1jrj   = q11 * rx + q12 * ry + q13 * rz;
+      const _vT q2jrj   = q12 * rx + q22 * ry + q23 * rz;
+      const _vT q3jrj   = q13 * rx + q23 * ry + q33 * rz;
+      const _vT qijrirj = q11 * rx * rx +
+                          q22 * ry * ry +
+                          q33 * rz * rz +
+                          two * (q12 * rx * ry +
+                                 q13 * rx * rz +
+                                 q23 * ry * rz);
+
+      const _vT mOr3 = m * Or3;
+      const _vT qOr7 = Or7 * twoHalf * qijrirj;
+
+      ax = ax - mOr3 * rx + Or5 * q1jrj - qOr7 * rx;
+      ay = ay - mOr3 * ry + Or5 * q2jrj - qOr7 * ry;
+      az = az - mOr3 * rz + Or5 * q3jrj - qOr7 * rz;
+   }
+
+   _acc[0] += ax.sum();
+   _acc[1] += ay.sum();
+   _acc[2] += az.sum();
+}
+
+template<typename _vT, typename _bT>
+void GravityKernels::potPCLoop(const _bT&    _b,
+                             const vect3dT& _ppos,
+                             size_t&        _j,
+                             fType&         _pot)
+{
+   const size_t n = _b.size();
+
+   const _vT px(_ppos[0]), py(_ppos[1]), pz(_ppos[2]);
+   const _vT two(2.), half(0.5);
+   _vT       pot(0.);
+
+   for (; _j + _vT::width <= n; _j += _vT::width)
+   {
+      const _vT rx = px - _vT::load(&_b.x[_j]);
+      const _vT ry = py - _vT::load(&_b.y[_j]);
+      const _vT rz = pz - _vT::load(&_b.z[_j]);
+      const _vT m  = _vT::load(&_b.m[_j]);
+      const _vT rr = rx * rx + ry * ry + rz * rz;
+      const _vT r  = _vT::sqrt(rr);
+
+      const _vT Or5 = _vT(1.) / (r * rr * rr);
+
+      const _vT qijrirj = _vT::load(&_b.q11[_j]) * rx * rx +
+                          _vT::load(&_b.q22[_j]) * ry * ry +
+                          _vT::load(&_b.q33[_j]) * rz * rz +
+                          two * (_vT::load(&_b.q12[_j]) * rx * ry +
+                                 _vT::load(&_b.q13[_j]) * rx * rz +
+                                 _vT::load(&_b.q23[_j]) * ry * rz);
+
+      pot = pot - m / r - half * Or5 * qijrirj;
+   }
+
+   _pot += pot.sum();
+}
+
+template<typename _vT, typename _bT>
+void GravityKernels::accMPLoop(const _bT&    _b,
+                             const vect3dT& _ppos,
+                             size_t&        _j,
+                             vect3dT&       _acc)
+{
+   const size_t n       = _b.size();
+   const bool   withHex = _b.getOrder() > 3;
+
+   const _vT px(_ppos[0]), py(_ppos[1]), pz(_ppos[2]);
+   _vT       ax(0.), ay(0.), az(0.);
+   _vT       mp[15];
+
+   for (; _j + _vT::width <= n; _j += _vT::width)
+   {
+      const _vT rx  = px - _vT::load(&_b.x[_j]);
+      const _vT ry  = py - _vT::load(&_b.y[_j]);
+      const _vT rz  = pz - _vT::load(&_b.z[_j]);
+      const _vT Or2 = _vT(1.) / (rx * rx + ry * ry + rz * rz);
+      const _vT Or7 = _vT::sqrt(Or2) * Or2 * Or2 * Or2;
+
+      for (size_t c = 0; c < 10; c++)
+         mp[c] = _vT::load(&_b.o[c][_j]);
+      accOct(mp, rx, ry, rz, Or2, Or7, ax, ay, az);
+
+      if (withHex)
+      {
+         for (size_t c = 0; c < 15; c++)
+            mp[c] = _vT::load(&_b.h[c][_j]);
+         accHex(mp, rx, ry, rz, Or2, Or7 * Or2, ax, ay, az);
+      }
+   }
+
+   _acc[0] += ax.sum();
+   _acc[1] += ay.sum();
+   _acc[2] += az.sum();
+}
+
+template<typename _vT, typename _bT>
+void GravityKernels::potMPLoop(const _bT&    _b,
+                             const vect3dT& _ppos,
+                             size_t&        _j,
+                             fType&         _pot)
+{
+   const size_t n       = _b.size();
+   const bool   withHex = _b.getOrder() > 3;
+
+   const _vT px(_ppos[0]), py(_ppos[1]), pz(_ppos[2]);
+   _vT       pot(0.);
+   _vT       mp[15];
+
+   for (; _j + _vT::width <= n; _j += _vT::width)
+   {
+      const _vT rx  = px - _vT::load(&_b.x[_j]);
+      const _vT ry  = py - _vT::load(&_b.y[_j]);
+      const _vT rz  = pz - _vT::load(&_b.z[_j]);
+      const _vT Or2 = _vT(1.) / (rx * rx + ry * ry + rz * rz);
+      const _vT Or7 = _vT::sqrt(Or2) * Or2 * Or2 * Or2;
+
+      for (size_t c = 0; c < 10; c++)
+         mp[c] = _vT::load(&_b.o[c][_j]);
+      pot = pot + potOct(mp, rx, ry, rz, Or7);
+
+      if (withHex)
+      {
+         for (size_t c = 0; c < 15; c++)
+            mp[c] = _vT::load(&_b.h[c][_j]);
+         pot = pot + potHex(mp, rx, ry, rz, Or7 * Or2);
+      }
+   }
+
+   _pot += pot.sum();
+}
+
+template<typename _vT>
+void GravityKernels::accOct(const _vT* _o, const _vT& _rx, const _vT& _ry,
+                            const _vT& _rz, const _vT& _Or2,
+                            const _vT& _Or7,
+                            _vT& _ax, _vT& _ay, _vT& _az)
+{
+   _vT       vx, vy, vz;
+   const _vT a  = contractOct(_o, _rx, _ry, _rz, vx, vy, vz);
+   const _vT cv = _vT(7.5) * _Or7;
+   const _vT cr = _vT(17.5) * a * _Or7 * _Or2;
+
+   _ax = _ax + cv * vx - cr * _rx;
+   _ay = _ay + cv * vy - cr * _ry;
+   _az = _az + cv * vz - cr * _rz;
+}
+
+template<typename _vT>
+void GravityKernels::accHex(const _vT* _h, const _vT& _rx, const _vT& _ry,
+                            const _vT& _rz, const _vT& _Or2,
+                            const _vT& _Or9,
+                            _vT& _ax, _vT& _ay, _vT& _az)
+{
+   _vT       vx, vy, vz;
+   const _vT a  = contractHex(_h, _rx, _ry, _rz, vx, vy, vz);
+   const _vT cv = _vT(17.5) * _Or9;
+   const _vT cr = _vT(39.375) * a * _Or9 * _Or2;
+
+   _ax = _ax + cv * vx - cr * _rx;
+   _ay = _ay + cv * vy - cr * _ry;
+   _az = _az + cv * vz - cr * _rz;
+}
+
+template<typename _vT>
+_vT GravityKernels::potOct(const _vT* _o, const _vT& _rx, const _vT& _ry,
+                           const _vT& _rz, const _vT& _Or7)
+{
+   _vT vx, vy, vz;
+   return(_vT(-2.5) * _Or7 * contractOct(_o, _rx, _ry, _rz, vx, vy, vz));
+}
+
+template<typename _vT>
+_vT GravityKernels::potHex(const _vT* _h, const _vT& _rx, const _vT& _ry,
+                           const _vT& _rz, const _vT& _Or9)
+{
+   _vT vx, vy, vz;
+   return(_vT(-4.375) * _Or9 * contractHex(_h, _rx, _ry, _rz, vx, vy, vz));
+}
+
+///
+/// v = M r^(n-1) and the full contraction v r, the components of M
+/// are xxx, xxy, xxz, xyy, xyz, xzz, yyy, yyz, yzz, zzz and xxxx,
+/// xxxy, xxxz, xxyy, xxyz, xxzz, xyyy, xyyz, xyzz, xzzz, yyyy, yyyz,
+/// yyzz, yzzz, zzzz
+///
+template<typename _vT>
+_vT GravityKernels::contractOct(const _vT* _o, const _vT& _rx,
+                                const _vT& _ry, const _vT& _rz,
+                                _vT& _vx, _vT& _vy, _vT& _vz)
+{
+   const _vT two(2.);
+   const _vT xx = _rx * _rx, yy = _ry * _ry, zz = _rz * _rz;
+   const _vT xy = two * _rx * _ry, xz = two * _rx * _rz;
+   const _vT yz = two * _ry * _rz;
+
+   _vx = _o[0] * xx + _o[3] * yy + _o[5] * zz +
+         _o[1] * xy + _o[2] * xz + _o[4] * yz;
+   _vy = _o[1] * xx + _o[6] * yy + _o[8] * zz +
+         _o[3] * xy + _o[4] * xz + _o[7] * yz;
+   _vz = _o[2] * xx + _o[7] * yy + _o[9] * zz +
+         _o[4] * xy + _o[5] * xz + _o[8] * yz;
+
+   return(_vx * _rx + _vy * _ry + _vz * _rz);
+}
+
+template<typename _vT>
+_vT GravityKernels::contractHex(const _vT* _h, const _vT& _rx,
+                                const _vT& _ry, const _vT& _rz,
+                                _vT& _vx, _vT& _vy, _vT& _vz)
+{
+   const _vT three(3.), six(6.);
+   const _vT xx = _rx * _rx, yy = _ry * _ry, zz = _rz * _rz;
+
+   const _vT xxx = xx * _rx, yyy = yy * _ry, zzz = zz * _rz;
+   const _vT xxy = three * xx * _ry, xxz = three * xx * _rz;
+   const _vT xyy = three * _rx * yy, xzz = three * _rx * zz;
+   const _vT yyz = three * yy * _rz, yzz = three * _ry * zz;
+   const _vT xyz = six * _rx * _ry * _rz;
+
+   _vx = _h[0] * xxx + _h[1] * xxy + _h[2] * xxz + _h[3] * xyy +
+         _h[4] * xyz + _h[5] * xzz + _h[6] * yyy + _h[7] * yyz +
+         _h[8] * yzz + _h[9] * zzz;
+   _vy = _h[1] * xxx + _h[3] * xxy + _h[4] * xxz + _h[6] * xyy +
+         _h[7] * xyz + _h[8] * xzz + _h[10] * yyy + _h[11] * yyz +
+         _h[12] * yzz + _h[13] * zzz;
+   _vz = _h[2] * xxx + _h[4] * xxy + _h[5] * xxz + _h[7] * xyy +
+         _h[8] * xyz + _h[9] * xzz + _h[11] * yyy + _h[12] * yyz +
+         _h[13] * yzz + _h[14] * zzz;
+
+   return(_vx * _rx + _vy * _ry + _vz * _rz);
+}
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef BHTREE_GRAV_MULTIPOLES_CPP
+#define BHTREE_GRAV_MULTIPOLES_CPP
+
+/*
+ *  bhtree_grav_multipoles.cpp
+ *
+ *  the multipole order of the gravity walks on the frozen tree. the
+ *  monopole and quadrupole terms are always evaluated by the worker,
+ *  the order classes add the terms of the octupole and hexadecapole
+ *  moments of the frozen tree. the tree has to be frozen with at least
+ *  the order of the worker (see BHTree::setMultipoleOrder()).
+ *
+ *  Created by Andreas Reufer on 29.01.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include "typedefs.h"
+#include "bhtree_frozen.h"
+#include "bhtree_grav_kernels.cpp"
+
+namespace sphlatch {
+class quadrupoles {
+public:
+   typedef BHTreeFrozen::idxT   idxT;
+
+   static const size_t order = 2;
+
+   static void addAcc(const BHTreeFrozen&, const idxT,
+                      const vect3dT&, const fType, vect3dT&)
+   { }
+
+   static void addPot(const BHTreeFrozen&, const idxT,
+                      const vect3dT&, const fType, fType&)
+   { }
+
+   template<typename _realT>
+   static void push(gravMPBuffer<_realT>&, const BHTreeFrozen&,
+                    const idxT)
+   { }
+};
+
+class octupoles {
+public:
+   typedef BHTreeFrozen::idxT   idxT;
+
+   static const size_t order = 3;
+
+   static void addAcc(const BHTreeFrozen& _frz, const idxT _idx,
+                      const vect3dT& _r, const fType _rr, vect3dT& _acc)
+   {
+      const gravScalar rx(_r[0]), ry(_r[1]), rz(_r[2]);
+      const gravScalar Or2(1. / _rr);
+      const gravScalar Or7 = gravScalar::sqrt(Or2) * Or2 * Or2 * Or2;
+
+      gravScalar ax(0.), ay(0.), az(0.);
+      gravScalar o[10];
+      for (size_t c = 0; c < 10; c++)
+         o[c] = _frz.oct[_frz.hot[_idx].cell].o[c];
+      GravityKernels::accOct(o, rx, ry, rz, Or2, Or7, ax, ay, az);
+
+      _acc[0] += ax.v;
+      _acc[1] += ay.v;
+      _acc[2] += az.v;
+   }
+
+   static void addPot(const BHTreeFrozen& _frz, const idxT _idx,
+                      const vect3dT& _r, const fType _rr, fType& _pot)
+   {
+      const gravScalar rx(_r[0]), ry(_r[1]), rz(_r[2]);
+      const gravScalar Or2(1. / _rr);
+      const gravScalar Or7 = gravScalar::sqrt(Or2) * Or2 * Or2 * Or2;
+
+      gravScalar o[10];
+      for (size_t c = 0; c < 10; c++)
+         o[c] = _frz.oct[_frz.hot[_idx].cell].o[c];
+      _pot += GravityKernels::potOct(o, rx, ry, rz, Or7).v;
+   }
+
+   template<typename _realT>
+   static void push(gravMPBuffer<_realT>& _b, const BHTreeFrozen& _frz,
+                    const idxT _idx)
+   {
+      _b.push(_frz.hot[_idx].com, _frz.oct[_frz.hot[_idx].cell].o, NULL);
+   }
+};
+
+class hexadecapoles {
+public:
+   typedef BHTreeFrozen::idxT   idxT;
+
+   static const size_t order = 4;
+
+   static void addAcc(const BHTreeFrozen& _frz, const idxT _idx,
+                      const vect3dT& _r, const fType _rr, vect3dT& _acc)
+   {
+      const gravScalar rx(_r[0]), ry(_r[1]), rz(_r[2]);
+      const gravScalar Or2(1. / _rr);
+      const gravScalar Or7 = gravScalar::sqrt(Or2) * Or2 * Or2 * Or2;
+
+      gravScalar ax(0.), ay(0.), az(0.);
+      gravScalar mp[15];
+      for (size_t c = 0; c < 10; c++)
+         mp[c] = _frz.oct[_frz.hot[_idx].cell].o[c];
+      GravityKernels::accOct(mp, rx, ry, rz, Or2, Or7, ax, ay, az);
+      for (size_t c = 0; c < 15; c++)
+         mp[c] = _frz.hex[_frz.hot[_idx].cell].h[c];
+      GravityKernels::accHex(mp, rx, ry, rz, Or2, Or7 * Or2, ax, ay, az);
+
+      _acc[0] += ax.v;
+      _acc[1] += ay.v;
+      _acc[2] += az.v;
+   }
+
+   static void addPot(const BHTreeFrozen& _frz, const idxT _idx,
+                      const vect3dT& _r, const fType _rr, fType& _pot)
+   {
+      const gravScalar rx(_r[0]), ry(_r[1]), rz(_r[2]);
+      const gravScalar Or2(1. / _rr);
+      const gravScalar Or7 = gravScalar::sqrt(Or2) * Or2 * Or2 * Or2;
+
+      gravScalar mp[15];
+      for (size_t c = 0; c < 10; c++)
+         mp[c] = _frz.oct[_frz.hot[_idx].cell].o[c];
+      _pot += GravityKernels::potOct(mp, rx, ry, rz, Or7).v;
+      for (size_t c = 0; c < 15; c++)
+         mp[c] = _frz.hex[_frz.hot[_idx].cell].h[c];
+      _pot += GravityKernels::potHex(mp, rx, ry, rz, Or7 * Or2).v;
+   }
+
+   template<typename _realT>
+   static void push(gravMPBuffer<_realT>& _b, const BHTreeFrozen& _frz,
+                    const idxT _idx)
+   {
+      const idxT cell = _frz.hot[_idx].cell;
+      _b.push(_frz.hot[_idx].com, _frz.oct[cell].o, _frz.hex[cell].h);
+   }
+};
+};
+
+#endif
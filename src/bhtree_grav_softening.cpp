@@ -0,0 +1,230 @@
+#ifndef BHTREE_GRAV_SOFTENING_CPP
+#define BHTREE_GRAV_SOFTENING_CPP
+
+/*
+ *  bhtree_grav_softening.cpp
+ *
+ *  the softening of the particle-particle interactions. a softening
+ *  policy provides OsmoR3() and OsmoR1(), the softened 1/r^3 and 1/r
+ *  for the distance r, its square rr, the softening length h of the
+ *  source and its inverse Oh. they are written for the vector classes
+ *  of the gravity kernels, arguments a policy does not use cost
+ *  nothing. the policy of the walks is chosen by the compile flags
+ *  as gravSoftening.
+ *
+ *  Created by Andreas Reufer on 03.02.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <limits>
+
+#include "typedefs.h"
+#include "bhtree_grav_vectors.cpp"
+
+namespace sphlatch {
+///
+/// the inverse softening length, a source with
+/// a softening length of zero is not softened
+///
+inline fType invSoftening(const fType _h)
+{
+   return(_h > 0. ? 1. / _h : std::numeric_limits<fType>::infinity());
+}
+
+class noSoftening {
+public:
+   template<typename _vT>
+   static _vT OsmoR3(const _vT& _r, const _vT& _rr,
+                     const _vT&, const _vT&)
+   {
+      return(_vT(1.) / (_rr * _r));
+   }
+
+   template<typename _vT>
+   static _vT OsmoR1(const _vT& _r, const _vT&,
+                     const _vT&, const _vT&)
+   {
+      return(_vT(1.) / _r);
+   }
+};
+
+///
+/// the softening length is added to the distance
+///
+class epsSoftening {
+public:
+   template<typename _vT>
+   static _vT OsmoR3(const _vT& _r, const _vT&,
+                     const _vT& _h, const _vT&)
+   {
+      const _vT re = _r + _h;
+      return(_vT(1.) / (re * re * re));
+   }
+
+   template<typename _vT>
+   static _vT OsmoR1(const _vT& _r, const _vT&,
+                     const _vT& _h, const _vT&)
+   {
+      return(_vT(1.) / (_r + _h));
+   }
+};
+
+///
+/// the spline softening of Hernquist & Katz 1989 for the B spline
+/// kernel. all three pieces of the polynomials are evaluated and
+/// selected, so there is no branch and no division by h.
+///
+class splineSoftening {
+public:
+   template<typename _vT>
+   static _vT OsmoR3(const _vT& _r, const _vT& _rr,
+                     const _vT&, const _vT& _Oh)
+   {
+      const _vT u   = _r * _Oh;
+      const _vT u2  = u * u;
+      const _vT u3  = u2 * u;
+      const _vT Or3 = _vT(1.) / (_rr * _r);
+
+      const _vT mid   = Or3 * (_vT(-1. / 15.) +
+                               u3 * (_vT(8. / 3.) +
+                                     u * (_vT(-3.) +
+                                          u * (_vT(6. / 5.) +
+                                               u * _vT(-1. / 6.)))));
+      const _vT inner = _Oh * _Oh * _Oh *
+                        (_vT(4. / 3.) + u2 * (_vT(-6. / 5.) + u * _vT(0.5)));
+
+      return(_vT::select(_vT::ge(u, _vT(2.)), Or3,
+                         _vT::select(_vT::gt(u, _vT(1.)), mid, inner)));
+   }
+
+   template<typename _vT>
+   static _vT OsmoR1(const _vT& _r, const _vT&,
+                     const _vT&, const _vT& _Oh)
+   {
+      const _vT u  = _r * _Oh;
+      const _vT u2 = u * u;
+      const _vT Or = _vT(1.) / _r;
+
+      const _vT mid   = _vT(-1. / 15.) * Or -
+                        _Oh * (_vT(-8. / 5.) +
+                               u2 * (_vT(4. / 3.) +
+                                     u * (_vT(-1.) +
+                                          u * (_vT(0.3) +
+                                               u * _vT(-1. / 30.)))));
+      const _vT inner = _Oh * (_vT(7. / 5.) -
+                               _vT(2.) * u2 * (_vT(1. / 3.) +
+                                               u2 * (_vT(-3. / 20.) +
+                                                     u * _vT(1. / 20.))));
+
+      return(_vT::select(_vT::ge(u, _vT(2.)), Or,
+                         _vT::select(_vT::gt(u, _vT(1.)), mid, inner)));
+   }
+};
+
+///
+/// h^3 OsmoR3 and h OsmoR1 of the spline softening inside the kernel,
+/// tabulated in q = u^2 on [0,4). an entry holds the value at the
+/// start of its interval and the difference to the next one.
+///
+template<typename _realT>
+class splineTable {
+public:
+   enum { size = 1024 };
+
+   _realT a3[size], b3[size], a1[size], b1[size];
+
+   static const splineTable& instance()
+   {
+      static const splineTable table;
+      return(table);
+   }
+
+private:
+   splineTable()
+   {
+      typedef gravScalarT<double>   scalarT;
+      const scalarT one(1.);
+
+      for (size_t i = 0; i < size; i++)
+      {
+         const double q0 = (4. * i) / size;
+         const double q1 = (4. * (i + 1)) / size;
+         const double u0 = std::sqrt(q0), u1 = std::sqrt(q1);
+
+         const double g30 = splineSoftening::OsmoR3(scalarT(u0), scalarT(q0),
+                                                    one, one).v;
+         const double g31 = splineSoftening::OsmoR3(scalarT(u1), scalarT(q1),
+                                                    one, one).v;
+         const double g10 = splineSoftening::OsmoR1(scalarT(u0), scalarT(q0),
+                                                    one, one).v;
+         const double g11 = splineSoftening::OsmoR1(scalarT(u1), scalarT(q1),
+                                                    one, one).v;
+
+         a3[i] = static_cast<_realT>(g30);
+         b3[i] = static_cast<_realT>(g31 - g30);
+         a1[i] = static_cast<_realT>(g10);
+         b1[i] = static_cast<_realT>(g11 - g10);
+      }
+   }
+};
+
+///
+/// the spline softening from the table, the index in the table
+/// comes from u^2 = rr Oh^2 without a square root or a division.
+/// only the index is clamped to the table, so the last interval is
+/// still interpolated. outside of the kernel the plain 1/r^3 and
+/// 1/r are used.
+///
+class splineTableSoftening {
+public:
+   template<typename _vT>
+   static _vT OsmoR3(const _vT& _r, const _vT& _rr,
+                     const _vT&, const _vT& _Oh)
+   {
+      typedef splineTable<typename _vT::realT>   tableT;
+      const tableT& table(tableT::instance());
+
+      const _vT q = _rr * _Oh * _Oh;
+      const _vT x = q * _vT(tableT::size / 4.);
+      const _vT i = _vT::floor(_vT::min(x, _vT(tableT::size - 1.)));
+
+      const _vT inner = _Oh * _Oh * _Oh *
+                        (_vT::gather(table.a3, i) +
+                         (x - i) * _vT::gather(table.b3, i));
+
+      return(_vT::select(_vT::ge(q, _vT(4.)), _vT(1.) / (_rr * _r), inner));
+   }
+
+   template<typename _vT>
+   static _vT OsmoR1(const _vT& _r, const _vT& _rr,
+                     const _vT&, const _vT& _Oh)
+   {
+      typedef splineTable<typename _vT::realT>   tableT;
+      const tableT& table(tableT::instance());
+
+      const _vT q = _rr * _Oh * _Oh;
+      const _vT x = q * _vT(tableT::size / 4.);
+      const _vT i = _vT::floor(_vT::min(x, _vT(tableT::size - 1.)));
+
+      const _vT inner = _Oh * (_vT::gather(table.a1, i) +
+                               (x - i) * _vT::gather(table.b1, i));
+
+      return(_vT::select(_vT::ge(q, _vT(4.)), _vT(1.) / _r, inner));
+   }
+};
+
+#if defined SPHLATCH_GRAVITY_SPLINESMOOTHING
+ #ifdef SPHLATCH_GRAVITY_SPLINETABLE
+typedef splineTableSoftening   gravSoftening;
+ #else
+typedef splineSoftening        gravSoftening;
+ #endif
+#elif defined SPHLATCH_GRAVITY_EPSSMOOTHING
+typedef epsSoftening           gravSoftening;
+#else
+typedef noSoftening            gravSoftening;
+#endif
+};
+
+#endif
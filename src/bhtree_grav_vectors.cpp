@@ -0,0 +1,464 @@
+#ifndef BHTREE_GRAV_VECTORS_CPP
+#define BHTREE_GRAV_VECTORS_CPP
+
+/*
+ *  bhtree_grav_vectors.cpp
+ *
+ *  the small vector classes of the gravity kernels for double and
+ *  single precision, they map to AVX-512 or AVX2 when compiling for
+ *  these and to plain scalars otherwise.
+ *
+ *  Created by Andreas Reufer on 27.01.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <cmath>
+
+#include "typedefs.h"
+
+#if !defined(SPHLATCH_GRAVITY_NOSIMD)
+ #if defined(__AVX512F__)
+  #define SPHLATCH_GRAVITY_AVX512
+ #elif defined(__AVX2__)
+  #define SPHLATCH_GRAVITY_AVX2
+ #endif
+#endif
+
+#if defined(SPHLATCH_GRAVITY_AVX512) || defined(SPHLATCH_GRAVITY_AVX2)
+ #define SPHLATCH_GRAVITY_SIMD
+ #include <immintrin.h>
+#endif
+
+namespace sphlatch {
+///
+/// the vector classes the kernels are written for. besides the
+/// arithmetic operators, each provides load(), sqrt(), min(),
+/// floor(), the comparisons gt() and ge(), select(), gather() of
+/// the elements at the integral indices in a vector and the
+/// horizontal sum(), which is done in double. min() returns the
+/// second argument for a NaN.
+///
+template<typename _realT>
+class gravScalarT {
+public:
+   typedef _realT   realT;
+   typedef bool   maskT;
+   enum { width = 1 };
+
+   _realT v;
+
+   gravScalarT() { }
+   gravScalarT(const _realT _v) : v(_v) { }
+
+   static gravScalarT load(const _realT* _p) { return(gravScalarT(*_p)); }
+   static gravScalarT sqrt(const gravScalarT& _a)
+   {
+      return(gravScalarT(std::sqrt(_a.v)));
+   }
+
+   static maskT gt(const gravScalarT& _a, const gravScalarT& _b)
+   {
+      return(_a.v > _b.v);
+   }
+
+   static maskT ge(const gravScalarT& _a, const gravScalarT& _b)
+   {
+      return(_a.v >= _b.v);
+   }
+
+   static gravScalarT select(const maskT _m,
+                             const gravScalarT& _a, const gravScalarT& _b)
+   {
+      return(_m ? _a : _b);
+   }
+
+   static gravScalarT min(const gravScalarT& _a, const gravScalarT& _b)
+   {
+      return(_a.v < _b.v ? _a : _b);
+   }
+
+   static gravScalarT floor(const gravScalarT& _a)
+   {
+      return(gravScalarT(std::floor(_a.v)));
+   }
+
+   static gravScalarT gather(const _realT* _base, const gravScalarT& _idx)
+   {
+      return(gravScalarT(_base[static_cast<int>(_idx.v)]));
+   }
+
+   double sum() const { return(v); }
+};
+
+template<typename _realT>
+inline gravScalarT<_realT> operator+(const gravScalarT<_realT>& _a,
+                                     const gravScalarT<_realT>& _b)
+{
+   return(gravScalarT<_realT>(_a.v + _b.v));
+}
+
+template<typename _realT>
+inline gravScalarT<_realT> operator-(const gravScalarT<_realT>& _a,
+                                     const gravScalarT<_realT>& _b)
+{
+   return(gravScalarT<_realT>(_a.v - _b.v));
+}
+
+template<typename _realT>
+inline gravScalarT<_realT> operator*(const gravScalarT<_realT>& _a,
+                                     const gravScalarT<_realT>& _b)
+{
+   return(gravScalarT<_realT>(_a.v * _b.v));
+}
+
+template<typename _realT>
+inline gravScalarT<_realT> operator/(const gravScalarT<_realT>& _a,
+                                     const gravScalarT<_realT>& _b)
+{
+   return(gravScalarT<_realT>(_a.v / _b.v));
+}
+
+typedef gravScalarT<fType>   gravScalar;
+
+#ifdef SPHLATCH_GRAVITY_AVX2
+class gravAVX2 {
+public:
+   typedef double    realT;
+   typedef __m256d   maskT;
+   enum { width = 4 };
+
+   __m256d v;
+
+   gravAVX2() { }
+   gravAVX2(const __m256d _v) : v(_v) { }
+   gravAVX2(const double _v) : v(_mm256_set1_pd(_v)) { }
+
+   static gravAVX2 load(const double* _p) { return(_mm256_loadu_pd(_p)); }
+   static gravAVX2 sqrt(const gravAVX2& _a)
+   {
+      return(_mm256_sqrt_pd(_a.v));
+   }
+
+   static maskT gt(const gravAVX2& _a, const gravAVX2& _b)
+   {
+      return(_mm256_cmp_pd(_a.v, _b.v, _CMP_GT_OQ));
+   }
+
+   static maskT ge(const gravAVX2& _a, const gravAVX2& _b)
+   {
+      return(_mm256_cmp_pd(_a.v, _b.v, _CMP_GE_OQ));
+   }
+
+   static gravAVX2 select(const maskT _m,
+                          const gravAVX2& _a, const gravAVX2& _b)
+   {
+      return(_mm256_blendv_pd(_b.v, _a.v, _m));
+   }
+
+   static gravAVX2 min(const gravAVX2& _a, const gravAVX2& _b)
+   {
+      return(_mm256_min_pd(_a.v, _b.v));
+   }
+
+   static gravAVX2 floor(const gravAVX2& _a)
+   {
+      return(_mm256_floor_pd(_a.v));
+   }
+
+   static gravAVX2 gather(const double* _base, const gravAVX2& _idx)
+   {
+      return(_mm256_i32gather_pd(_base, _mm256_cvttpd_epi32(_idx.v), 8));
+   }
+
+   double sum() const
+   {
+      const __m128d lo = _mm_add_pd(_mm256_castpd256_pd128(v),
+                                    _mm256_extractf128_pd(v, 1));
+      return(_mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo))));
+   }
+};
+
+inline gravAVX2 operator+(const gravAVX2& _a, const gravAVX2& _b)
+{
+   return(_mm256_add_pd(_a.v, _b.v));
+}
+
+inline gravAVX2 operator-(const gravAVX2& _a, const gravAVX2& _b)
+{
+   return(_mm256_sub_pd(_a.v, _b.v));
+}
+
+inline gravAVX2 operator*(const gravAVX2& _a, const gravAVX2& _b)
+{
+   return(_mm256_mul_pd(_a.v, _b.v));
+}
+
+inline gravAVX2 operator/(const gravAVX2& _a, const gravAVX2& _b)
+{
+   return(_mm256_div_pd(_a.v, _b.v));
+}
+
+class gravAVX2f {
+public:
+   typedef float    realT;
+   typedef __m256   maskT;
+   enum { width = 8 };
+
+   __m256 v;
+
+   gravAVX2f() { }
+   gravAVX2f(const __m256 _v) : v(_v) { }
+   gravAVX2f(const double _v) : v(_mm256_set1_ps(static_cast<float>(_v))) { }
+
+   static gravAVX2f load(const float* _p) { return(_mm256_loadu_ps(_p)); }
+   static gravAVX2f sqrt(const gravAVX2f& _a)
+   {
+      return(_mm256_sqrt_ps(_a.v));
+   }
+
+   static maskT gt(const gravAVX2f& _a, const gravAVX2f& _b)
+   {
+      return(_mm256_cmp_ps(_a.v, _b.v, _CMP_GT_OQ));
+   }
+
+   static maskT ge(const gravAVX2f& _a, const gravAVX2f& _b)
+   {
+      return(_mm256_cmp_ps(_a.v, _b.v, _CMP_GE_OQ));
+   }
+
+   static gravAVX2f select(const maskT _m,
+                           const gravAVX2f& _a, const gravAVX2f& _b)
+   {
+      return(_mm256_blendv_ps(_b.v, _a.v, _m));
+   }
+
+   static gravAVX2f min(const gravAVX2f& _a, const gravAVX2f& _b)
+   {
+      return(_mm256_min_ps(_a.v, _b.v));
+   }
+
+   static gravAVX2f floor(const gravAVX2f& _a)
+   {
+      return(_mm256_floor_ps(_a.v));
+   }
+
+   static gravAVX2f gather(const float* _base, const gravAVX2f& _idx)
+   {
+      return(_mm256_i32gather_ps(_base, _mm256_cvttps_epi32(_idx.v), 4));
+   }
+
+   double sum() const
+   {
+      const __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(v));
+      const __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1));
+      return(gravAVX2(_mm256_add_pd(lo, hi)).sum());
+   }
+};
+
+inline gravAVX2f operator+(const gravAVX2f& _a, const gravAVX2f& _b)
+{
+   return(_mm256_add_ps(_a.v, _b.v));
+}
+
+inline gravAVX2f operator-(const gravAVX2f& _a, const gravAVX2f& _b)
+{
+   return(_mm256_sub_ps(_a.v, _b.v));
+}
+
+inline gravAVX2f operator*(const gravAVX2f& _a, const gravAVX2f& _b)
+{
+   return(_mm256_mul_ps(_a.v, _b.v));
+}
+
+inline gravAVX2f operator/(const gravAVX2f& _a, const gravAVX2f& _b)
+{
+   return(_mm256_div_ps(_a.v, _b.v));
+}
+#endif
+
+#ifdef SPHLATCH_GRAVITY_AVX512
+class gravAVX512 {
+public:
+   typedef double     realT;
+   typedef __mmask8   maskT;
+   enum { width = 8 };
+
+   __m512d v;
+
+   gravAVX512() { }
+   gravAVX512(const __m512d _v) : v(_v) { }
+   gravAVX512(const double _v) : v(_mm512_set1_pd(_v)) { }
+
+   static gravAVX512 load(const double* _p) { return(_mm512_loadu_pd(_p)); }
+   static gravAVX512 sqrt(const gravAVX512& _a)
+   {
+      return(_mm512_sqrt_pd(_a.v));
+   }
+
+   static maskT gt(const gravAVX512& _a, const gravAVX512& _b)
+   {
+      return(_mm512_cmp_pd_mask(_a.v, _b.v, _CMP_GT_OQ));
+   }
+
+   static maskT ge(const gravAVX512& _a, const gravAVX512& _b)
+   {
+      return(_mm512_cmp_pd_mask(_a.v, _b.v, _CMP_GE_OQ));
+   }
+
+   static gravAVX512 select(const maskT _m,
+                            const gravAVX512& _a, const gravAVX512& _b)
+   {
+      return(_mm512_mask_blend_pd(_m, _b.v, _a.v));
+   }
+
+   static gravAVX512 min(const gravAVX512& _a, const gravAVX512& _b)
+   {
+      return(_mm512_min_pd(_a.v, _b.v));
+   }
+
+   static gravAVX512 floor(const gravAVX512& _a)
+   {
+      return(_mm512_roundscale_pd(_a.v,
+                                  _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+   }
+
+   static gravAVX512 gather(const double* _base, const gravAVX512& _idx)
+   {
+      return(_mm512_i32gather_pd(_mm512_cvttpd_epi32(_idx.v), _base, 8));
+   }
+
+   double sum() const { return(_mm512_reduce_add_pd(v)); }
+};
+
+inline gravAVX512 operator+(const gravAVX512& _a, const gravAVX512& _b)
+{
+   return(_mm512_add_pd(_a.v, _b.v));
+}
+
+inline gravAVX512 operator-(const gravAVX512& _a, const gravAVX512& _b)
+{
+   return(_mm512_sub_pd(_a.v, _b.v));
+}
+
+inline gravAVX512 operator*(const gravAVX512& _a, const gravAVX512& _b)
+{
+   return(_mm512_mul_pd(_a.v, _b.v));
+}
+
+inline gravAVX512 operator/(const gravAVX512& _a, const gravAVX512& _b)
+{
+   return(_mm512_div_pd(_a.v, _b.v));
+}
+
+class gravAVX512f {
+public:
+   typedef float       realT;
+   typedef __mmask16   maskT;
+   enum { width = 16 };
+
+   __m512 v;
+
+   gravAVX512f() { }
+   gravAVX512f(const __m512 _v) : v(_v) { }
+   gravAVX512f(const double _v) : v(_mm512_set1_ps(static_cast<float>(_v))) { }
+
+   static gravAVX512f load(const float* _p) { return(_mm512_loadu_ps(_p)); }
+   static gravAVX512f sqrt(const gravAVX512f& _a)
+   {
+      return(_mm512_sqrt_ps(_a.v));
+   }
+
+   static maskT gt(const gravAVX512f& _a, const gravAVX512f& _b)
+   {
+      return(_mm512_cmp_ps_mask(_a.v, _b.v, _CMP_GT_OQ));
+   }
+
+   static maskT ge(const gravAVX512f& _a, const gravAVX512f& _b)
+   {
+      return(_mm512_cmp_ps_mask(_a.v, _b.v, _CMP_GE_OQ));
+   }
+
+   static gravAVX512f select(const maskT _m,
+                             const gravAVX512f& _a, const gravAVX512f& _b)
+   {
+      return(_mm512_mask_blend_ps(_m, _b.v, _a.v));
+   }
+
+   static gravAVX512f min(const gravAVX512f& _a, const gravAVX512f& _b)
+   {
+      return(_mm512_min_ps(_a.v, _b.v));
+   }
+
+   static gravAVX512f floor(const gravAVX512f& _a)
+   {
+      return(_mm512_roundscale_ps(_a.v,
+                                  _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC));
+   }
+
+   static gravAVX512f gather(const float* _base, const gravAVX512f& _idx)
+   {
+      return(_mm512_i32gather_ps(_mm512_cvttps_epi32(_idx.v), _base, 4));
+   }
+
+   double sum() const
+   {
+      const __m512d lo = _mm512_cvtps_pd(_mm512_castps512_ps256(v));
+      const __m512d hi = _mm512_cvtps_pd(_mm256_castpd_ps(
+                            _mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+      return(_mm512_reduce_add_pd(_mm512_add_pd(lo, hi)));
+   }
+};
+
+inline gravAVX512f operator+(const gravAVX512f& _a, const gravAVX512f& _b)
+{
+   return(_mm512_add_ps(_a.v, _b.v));
+}
+
+inline gravAVX512f operator-(const gravAVX512f& _a, const gravAVX512f& _b)
+{
+   return(_mm512_sub_ps(_a.v, _b.v));
+}
+
+inline gravAVX512f operator*(const gravAVX512f& _a, const gravAVX512f& _b)
+{
+   return(_mm512_mul_ps(_a.v, _b.v));
+}
+
+inline gravAVX512f operator/(const gravAVX512f& _a, const gravAVX512f& _b)
+{
+   return(_mm512_div_ps(_a.v, _b.v));
+}
+#endif
+
+///
+/// the widest vector class and the scalar class for the
+/// precision <_realT> of a buffer
+///
+template<typename _realT>
+class gravVectors { };
+
+template<>
+class gravVectors<double> {
+public:
+   typedef gravScalarT<double>   scalarT;
+#if defined(SPHLATCH_GRAVITY_AVX512)
+   typedef gravAVX512            vectorT;
+#elif defined(SPHLATCH_GRAVITY_AVX2)
+   typedef gravAVX2              vectorT;
+#endif
+};
+
+template<>
+class gravVectors<float> {
+public:
+   typedef gravScalarT<float>   scalarT;
+#if defined(SPHLATCH_GRAVITY_AVX512)
+   typedef gravAVX512f          vectorT;
+#elif defined(SPHLATCH_GRAVITY_AVX2)
+   typedef gravAVX2f            vectorT;
+#endif
+};
+};
+
+#endif
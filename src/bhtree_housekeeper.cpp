@@ -56,37 +56,68 @@ void BHTreeHousekeeper::setNextCZ()
    lastPtr->next = NULL;
 }
 
-void BHTreeHousekeeper::setSkip()
+///
+/// set the skip pointers of the CZ cells:
+///
+/// do a preorder walk by using the next pointers, but jump over
+/// the subtrees of the bottom CZ cells, and store at each depth
+/// the last cell encountered in a list
+///
+/// when going up again to depth n and encountering a cell,
+/// let the "skip"-pointer of each cell in the list with
+/// >= n point at the current cell. the cells left in the list
+/// at the end of the walk have no skip target.
+///
+void BHTreeHousekeeper::setSkipCZ()
 {
-   ///
-   /// do a preorder walk by using the next pointers
-   /// and store at each depth the last cell encountered
-   /// in a list
-   ///
-   /// when going up again to depth n and encountering a cell,
-   /// let the "skip"-pointer of each cell in the list with
-   /// >= n point at the current cell
-   ///
-
-   ///
-   /// prepare the lastSkipee list
-   ///
-   const size_t maxDepth = treePtr->maxDepth;
+   clearSkipees(0);
 
-   if (lastSkipeeAtDepth.size() != maxDepth)
-      lastSkipeeAtDepth.resize(maxDepth);
-   for (size_t i = 0; i < maxDepth; i++)
-      lastSkipeeAtDepth[i] = NULL;
-
-   ///
-   /// do the next-walk
-   ///
    goRoot();
-   goNext();
+   goNextCZ();
    while (curPtr != NULL)
    {
       const size_t depth = curPtr->depth;
 
+      size_t i = depth;
+      while (lastSkipeeAtDepth[i] != NULL)
+      {
+         lastSkipeeAtDepth[i]->skip = static_cast<gcllPtrT>(curPtr);
+         lastSkipeeAtDepth[i]       = NULL;
+         i++;
+      }
+      lastSkipeeAtDepth[depth] = static_cast<gcllPtrT>(curPtr);
+
+      goNextCZ();
+   }
+
+   for (size_t i = 0; i < lastSkipeeAtDepth.size(); i++)
+   {
+      if (lastSkipeeAtDepth[i] != NULL)
+         lastSkipeeAtDepth[i]->skip = NULL;
+   }
+}
+
+///
+/// set the skip pointers in the subtree of a bottom CZ cell, the same
+/// way as for the CZ cells. the cells left in the list at the end of
+/// the subtree skip to the same node as the CZ cell, so setSkipCZ()
+/// has to be called before. the subtrees of the CZ cells may be done
+/// concurrently.
+///
+void BHTreeHousekeeper::setSkip(const czllPtrT _czll)
+{
+   if (_czll->chldFrst == NULL)
+      return;
+
+   const size_t czllDepth = _czll->depth;
+   clearSkipees(czllDepth);
+
+   curPtr = _czll->chldFrst;
+   const nodePtrT stopChld = _czll->chldLast->next;
+   while (curPtr != stopChld)
+   {
+      const size_t depth = curPtr->depth;
+
       size_t i = depth;
       while (lastSkipeeAtDepth[i] != NULL)
       {
@@ -99,6 +130,33 @@ void BHTreeHousekeeper::setSkip()
 
       goNext();
    }
+
+   for (size_t i = czllDepth + 1; i < lastSkipeeAtDepth.size(); i++)
+   {
+      if (lastSkipeeAtDepth[i] != NULL)
+         lastSkipeeAtDepth[i]->skip = _czll->skip;
+   }
+}
+
+void BHTreeHousekeeper::clearSkipees(const size_t _depth)
+{
+   const size_t maxDepth = treePtr->maxDepth;
+
+   if (lastSkipeeAtDepth.size() != maxDepth)
+      lastSkipeeAtDepth.resize(maxDepth);
+   for (size_t i = _depth; i < maxDepth; i++)
+      lastSkipeeAtDepth[i] = NULL;
+}
+
+///
+/// go to the next CZ cell in a walk over the CZ cells only
+///
+void BHTreeHousekeeper::goNextCZ()
+{
+   if (curPtr->atBottom)
+      curPtr = static_cast<czllPtrT>(curPtr)->chldLast->next;
+   else
+      curPtr = curPtr->next;
 }
 
 void BHTreeHousekeeper::setNextRecursor()
@@ -160,7 +218,9 @@ void BHTreeHousekeeper::minTree(const czllPtrT _czll)
 
    // maybe the last node is deleted during housekeeping, so
    // we introduce a dummy cell won't be deleted
-   const nodePtrT chldLastDummy = new pnodT;
+   pnodT          chldLastDummyNode;
+   const pnodPtrT chldLastDummy = &chldLastDummyNode;
+   chldLastDummy->clear();
    _czll->chldLast->next = chldLastDummy;
 
    while (curPtr != chldLastDummy)
@@ -184,7 +244,7 @@ void BHTreeHousekeeper::minTree(const czllPtrT _czll)
          nextOk = nextChld->next;
          const size_t wasChild = getChildNo(nextChld, nextChld->parent);
          static_cast<gcllPtrT>(nextChld->parent)->child[wasChild] = NULL;
-         delete static_cast<qcllPtrT>(nextChld);
+         delCell(static_cast<qcllPtrT>(nextChld));
 
          curPtr->next = nextOk;
          break;
@@ -214,14 +274,14 @@ void BHTreeHousekeeper::minTree(const czllPtrT _czll)
          while (nextChld != chainee)
          {
             nextOk = nextChld->next;
-            delete nextChld;
+            delCell(static_cast<qcllPtrT>(nextChld));
             nextChld = nextOk;
          }
 
          // set next ptr of the current node to the next ptr of the last
          // chainee
          curPtr->next = nextChld->next;
-         delete chainee;
+         delCell(static_cast<qcllPtrT>(chainee));
 
          break;
       }
@@ -234,10 +294,11 @@ void BHTreeHousekeeper::minTree(const czllPtrT _czll)
       }
    }
 
-
-   delete chldLastDummy;
    lastOk->next    = chldLastNext;
    _czll->chldLast = lastOk;
+
+   // the first child may have been deleted as well
+   _czll->chldFrst = _czll->next;
 }
 };
 
@@ -26,7 +26,8 @@ public:
    ///
    void setNext(const czllPtrT _czll);
    void setNextCZ();
-   void setSkip();
+   void setSkipCZ();
+   void setSkip(const czllPtrT _czll);
 
    ///
    /// minimize the suuubtree of a CZ cell
@@ -38,6 +39,9 @@ private:
    void setNextRecursor();
    void setNextCZRecursor();
 
+   void clearSkipees(const size_t _depth);
+   void goNextCZ();
+
    nodePtrT lastPtr;
 
    std::vector<gcllPtrT> lastSkipeeAtDepth;
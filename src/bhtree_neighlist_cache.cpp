@@ -0,0 +1,449 @@
+#ifndef BHTREE_NEIGHLIST_CACHE_CPP
+#define BHTREE_NEIGHLIST_CACHE_CPP
+
+/*
+ *  bhtree_neighlist_cache.cpp
+ *
+ *  neighbour lists with a Verlet skin, kept over several SPH sums.
+ *  the lists are searched with a radius of 2h(1 + skin) and stored
+ *  in one array. the rows are numbered in the order of the CZ cells
+ *  and the frozen tree, so the rows and the neighbours of nearby
+ *  particles lie close in memory. the lists stay valid as long as no
+ *  particle can have moved into the smoothing sphere 2h of an other
+ *  particle from outside its list.
+ *
+ *  Created by Andreas Reufer on 08.02.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "bhtree_worker.cpp"
+#include "bhtree_worker_neighfunc.cpp"
+
+namespace sphlatch {
+template<typename _partT>
+class NeighListCache {
+public:
+   typedef uint32_t   rowT;
+   static const rowT nil = 0xffffffff;
+
+   NeighListCache() : skin(0.2), groupSize(1), valid(false), base(NULL) { }
+   ~NeighListCache() { }
+
+   ///
+   /// the skin relative to the search radius 2h
+   ///
+   void setSkin(const fType _skin)
+   {
+      skin  = _skin;
+      valid = false;
+   }
+
+   fType getSkin() const
+   {
+      return(skin);
+   }
+
+   ///
+   /// the group size of the walks for the build
+   ///
+   void setGroupSize(const size_t _groupSize)
+   {
+      groupSize = _groupSize;
+   }
+
+   void invalidate()
+   {
+      valid = false;
+   }
+
+   template<typename _partSetT>
+   bool isValid(_partSetT& _parts) const;
+
+   ///
+   /// build the neighbour lists or only the pair lists
+   /// for the symmetric sums of the particles in <_cells>
+   ///
+   template<typename _partSetT>
+   void build(BHTree& _tree, const BHTree::czllPtrVectT& _cells,
+              _partSetT& _parts);
+
+   template<typename _partSetT>
+   void buildPairs(BHTree& _tree, const BHTree::czllPtrVectT& _cells,
+                   _partSetT& _parts);
+
+   rowT getRow(const _partT* const _part) const
+   {
+      return(partRow[_part - base]);
+   }
+
+   size_t getNoRows() const
+   {
+      return(rowPart.size());
+   }
+
+   ///
+   /// the particle in row <_i> is rowPart[_i], the rows of
+   /// the particles in the CZ cell <_c> of the build are
+   /// cellRow[_c] up to cellRow[_c + 1] - 1
+   ///
+   std::vector<_partT*> rowPart;
+   std::vector<size_t>  cellRow;
+
+   ///
+   /// the neighbours of the particle in row <_i> are
+   /// neigh[rowBegin[_i]] up to neigh[rowEnd[_i] - 1]
+   ///
+   std::vector<size_t>  rowBegin, rowEnd;
+   std::vector<_partT*> neigh;
+
+   ///
+   /// the pairs for the symmetric sums from buildPairs() as rows,
+   /// every pair of particles where one is in the list of the other
+   /// appears once
+   ///
+   std::vector<size_t> pairBegin, pairEnd;
+   std::vector<rowT>   pairNeigh;
+
+private:
+   fType   skin;
+   size_t  groupSize;
+   bool    valid;
+   _partT* base;
+
+   // the row of the particle with index i in the particle set,
+   // particles not in the tree have none
+   std::vector<rowT> partRow;
+
+   // positions and smoothing lengths of the rows at the build
+   std::vector<vect3dT> pos0;
+   std::vector<fType>   h0;
+
+   template<typename _partSetT>
+   void setRows(BHTree& _tree, const BHTree::czllPtrVectT& _cells,
+                _partSetT& _parts);
+
+   template<typename _listT>
+   void search(BHTree& _tree, const BHTree::czllPtrVectT& _cells,
+               std::vector<size_t>& _begin, std::vector<size_t>& _end,
+               std::vector<_listT>& _list);
+};
+
+///
+/// collects the neighbours of one particle for the cache, either
+/// all of them as pointers or the ones of its pair list as rows
+///
+template<typename _partT>
+class NeighPtrVectFunc
+{
+public:
+   typedef typename NeighListCache<_partT>::rowT   rowT;
+
+   void operator()(_partT* const,
+                   _partT* const _j,
+                   const vect3dT&,
+                   const fType,
+                   const fType)
+   {
+      if (pairList == NULL)
+         neighList->push_back(_j);
+      else
+      {
+         const fType hj = _j->h;
+         if (hi >= hj)
+         {
+            const rowT jrow = cache->getRow(_j);
+            if (hi > hj || irow < jrow)
+               pairList->push_back(jrow);
+         }
+      }
+   }
+
+   ///
+   /// the row and the smoothing length of the particle searched next
+   ///
+   void setRow(const rowT _irow, const fType _hi)
+   {
+      irow = _irow;
+      hi   = _hi;
+   }
+
+   void setList(const NeighListCache<_partT>& _cache,
+                std::vector<_partT*>&         _list)
+   {
+      cache     = &_cache;
+      neighList = &_list;
+      pairList  = NULL;
+   }
+
+   void setList(const NeighListCache<_partT>& _cache,
+                std::vector<rowT>&            _list)
+   {
+      cache     = &_cache;
+      neighList = NULL;
+      pairList  = &_list;
+   }
+
+private:
+   const NeighListCache<_partT>* cache;
+   std::vector<_partT*>*         neighList;
+   std::vector<rowT>*            pairList;
+   rowT                          irow;
+   fType                         hi;
+};
+
+template<typename _partT>
+class NeighCacheWorker :
+   public NeighWorker<NeighPtrVectFunc<_partT> , _partT> {
+public:
+   typedef NeighWorker<NeighPtrVectFunc<_partT> , _partT>   parentT;
+   typedef typename parentT::idxT                            idxT;
+
+   NeighCacheWorker(const BHTreeWorker::treePtrT _treePtr) :
+      NeighWorker<NeighPtrVectFunc<_partT> , _partT>(_treePtr) { }
+   NeighCacheWorker(const NeighCacheWorker& _NCwork) :
+      NeighWorker<NeighPtrVectFunc<_partT> , _partT>(_NCwork) { }
+   ~NeighCacheWorker() { }
+
+   ///
+   /// search the neighbours of all particles in <_czll> with the
+   /// radius 2h <_mult> and append them to <_list>. the rows of
+   /// <_begin> and <_end> are set relative to the start of <_list>.
+   ///
+   template<typename _listT>
+   void operator()(const czllPtrT _czll, const fType _mult,
+                   const NeighListCache<_partT>& _cache,
+                   std::vector<_listT>& _list,
+                   std::vector<size_t>& _begin,
+                   std::vector<size_t>& _end)
+   {
+      parentT::Func.setList(_cache, _list);
+
+      const BHTreeFrozen& frz(BHTreeWorker::treePtr->getFrozen());
+      const idxT          last      = frz.hot[_czll->frozenIdx].skip;
+      const size_t        groupSize = parentT::groupSize;
+
+      idxT i = _czll->frozenIdx + 1;
+      while (i < last)
+      {
+         if (groupSize > 1 && not frz.hot[i].isParticle &&
+             frz.noParts[i] <= groupSize)
+         {
+            if (frz.noParts[i] > 0)
+            {
+               parentT::neighCollectGroup(i, 2. * _mult);
+
+               const size_t noMembers = parentT::grpList.size();
+               for (size_t k = 0; k < noMembers; k++)
+               {
+                  _partT* const partPtr =
+                     static_cast<_partT*>(frz.part[parentT::grpList[k]]);
+                  const size_t  row = _cache.getRow(partPtr);
+
+                  parentT::Func.setRow(row, partPtr->h);
+                  _begin[row] = _list.size();
+                  parentT::neighExecMember(k, 2. * _mult * partPtr->h);
+                  _end[row] = _list.size();
+               }
+            }
+            i = frz.hot[i].skip;
+         }
+         else
+         {
+            if (frz.hot[i].isParticle)
+            {
+               _partT* const partPtr = static_cast<_partT*>(frz.part[i]);
+               const size_t  row     = _cache.getRow(partPtr);
+
+               parentT::Func.setRow(row, partPtr->h);
+               _begin[row] = _list.size();
+               parentT::neighExecFunc(i, 2. * _mult * partPtr->h);
+               _end[row] = _list.size();
+            }
+            i++;
+         }
+      }
+   }
+};
+
+///
+/// a pair (i,j) outside of the list of i is farther apart than
+/// 2 h0_i (1 + skin) at the build. it can not have come closer
+/// than 2 h_i, as long as d_i + d_max + 2 (h_i - h0_i) stays below
+/// 2 h0_i skin, where d is the distance moved since the build.
+///
+template<typename _partT>
+template<typename _partSetT>
+bool NeighListCache<_partT>::isValid(_partSetT& _parts) const
+{
+   const size_t nop    = _parts.getNop();
+   const size_t noRows = rowPart.size();
+
+   if (not valid || nop != partRow.size() || nop == 0 ||
+       &(_parts[0]) != base)
+      return(false);
+
+   fType dmax2 = 0.;
+   for (size_t i = 0; i < noRows; i++)
+   {
+      const vect3dT dpos = rowPart[i]->pos - pos0[i];
+      const fType   dd   = dot(dpos, dpos);
+      dmax2 = dd > dmax2 ? dd : dmax2;
+   }
+   const fType dmax = sqrt(dmax2);
+
+   for (size_t i = 0; i < noRows; i++)
+   {
+      const vect3dT dpos = rowPart[i]->pos - pos0[i];
+      const fType   di   = sqrt(dot(dpos, dpos));
+
+      if (di + dmax + 2. * (rowPart[i]->h - h0[i]) >= 2. * h0[i] * skin)
+         return(false);
+   }
+   return(true);
+}
+
+///
+/// the tree has to be frozen
+///
+template<typename _partT>
+template<typename _partSetT>
+void NeighListCache<_partT>::build(BHTree&                     _tree,
+                                   const BHTree::czllPtrVectT& _cells,
+                                   _partSetT&                  _parts)
+{
+   setRows(_tree, _cells, _parts);
+   search(_tree, _cells, rowBegin, rowEnd, neigh);
+
+   pairBegin.clear();
+   pairEnd.clear();
+   pairNeigh.clear();
+
+   valid = true;
+}
+
+///
+/// the pair lists are searched like the neighbour lists: a pair
+/// (i,j) found in the search of i is kept in row i, when h0_i > h0_j
+/// or when h0_i = h0_j and i < j. the search radius of the particle
+/// with the larger smoothing length contains the one of the other,
+/// so every pair is kept exactly once and in the row of a particle
+/// whose search found it.
+///
+template<typename _partT>
+template<typename _partSetT>
+void NeighListCache<_partT>::buildPairs(BHTree&                     _tree,
+                                        const BHTree::czllPtrVectT& _cells,
+                                        _partSetT&                  _parts)
+{
+   setRows(_tree, _cells, _parts);
+   search(_tree, _cells, pairBegin, pairEnd, pairNeigh);
+
+   rowBegin.clear();
+   rowEnd.clear();
+   neigh.clear();
+
+   valid = true;
+}
+
+///
+/// number the rows in the order of the cells and the frozen tree
+/// and store the positions and smoothing lengths of the build
+///
+template<typename _partT>
+template<typename _partSetT>
+void NeighListCache<_partT>::setRows(BHTree&                     _tree,
+                                     const BHTree::czllPtrVectT& _cells,
+                                     _partSetT&                  _parts)
+{
+   assert(_tree.isFrozen());
+
+   const BHTreeFrozen& frz(_tree.getFrozen());
+   const size_t        nop     = _parts.getNop();
+   const int           noCells = _cells.size();
+
+   cellRow.resize(noCells + 1);
+   cellRow[0] = 0;
+   for (int i = 0; i < noCells; i++)
+      cellRow[i + 1] = cellRow[i] + frz.noParts[_cells[i]->frozenIdx];
+   const size_t noRows = cellRow[noCells];
+
+   base = nop > 0 ? &(_parts[0]) : NULL;
+   partRow.assign(nop, static_cast<rowT>(nil));
+   rowPart.resize(noRows);
+   pos0.resize(noRows);
+   h0.resize(noRows);
+
+#pragma omp parallel for schedule(dynamic)
+   for (int i = 0; i < noCells; i++)
+   {
+      const BHTreeFrozen::idxT last = frz.hot[_cells[i]->frozenIdx].skip;
+      rowT                     row  = cellRow[i];
+      for (BHTreeFrozen::idxT j = _cells[i]->frozenIdx + 1; j < last; j++)
+      {
+         if (frz.hot[j].isParticle)
+         {
+            _partT* const partPtr = static_cast<_partT*>(frz.part[j]);
+            partRow[partPtr - base] = row;
+            rowPart[row]            = partPtr;
+            pos0[row]               = partPtr->pos;
+            h0[row]                 = partPtr->h;
+            row++;
+         }
+      }
+   }
+}
+
+///
+/// the cells are searched in parallel into lists
+/// per cell, which are then copied into <_list>
+///
+template<typename _partT>
+template<typename _listT>
+void NeighListCache<_partT>::search(BHTree&                     _tree,
+                                    const BHTree::czllPtrVectT& _cells,
+                                    std::vector<size_t>&        _begin,
+                                    std::vector<size_t>&        _end,
+                                    std::vector<_listT>&        _list)
+{
+   const int noCells = _cells.size();
+
+   _begin.resize(rowPart.size());
+   _end.resize(rowPart.size());
+
+   std::vector<std::vector<_listT> > cellLists(noCells);
+
+   NeighCacheWorker<_partT> cacheWorker(&_tree);
+   const fType              mult = 1. + skin;
+   cacheWorker.setGroupSize(groupSize);
+#pragma omp parallel for firstprivate(cacheWorker) schedule(dynamic)
+   for (int i = 0; i < noCells; i++)
+      cacheWorker(_cells[i], mult, *this, cellLists[i], _begin, _end);
+
+   std::vector<size_t> cellOffset(noCells + 1);
+   cellOffset[0] = 0;
+   for (int i = 0; i < noCells; i++)
+      cellOffset[i + 1] = cellOffset[i] + cellLists[i].size();
+   _list.resize(cellOffset[noCells]);
+
+#pragma omp parallel for schedule(dynamic)
+   for (int i = 0; i < noCells; i++)
+   {
+      std::copy(cellLists[i].begin(), cellLists[i].end(),
+                _list.begin() + cellOffset[i]);
+      std::vector<_listT>().swap(cellLists[i]);
+
+      for (size_t j = cellRow[i]; j < cellRow[i + 1]; j++)
+      {
+         _begin[j] += cellOffset[i];
+         _end[j]   += cellOffset[i];
+      }
+   }
+}
+};
+
+#endif
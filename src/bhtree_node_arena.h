@@ -0,0 +1,107 @@
+#ifndef BHTREE_NODE_ARENA_H
+#define BHTREE_NODE_ARENA_H
+
+/*
+ *  bhtree_node_arena.h
+ *
+ *  typed node arena for the dynamic tree. nodes are handed out
+ *  contiguously from slabs of <slabSize> nodes, freed nodes are
+ *  put on a free list and reused. clear() releases all nodes at
+ *  once, the slabs are kept for the next tree. release() also
+ *  frees the slabs.
+ *
+ *  Created by Andreas Reufer on 15.01.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <vector>
+
+namespace sphlatch {
+template<class T, size_t slabSize>
+class BHTreeNodeArena {
+public:
+   typedef T*   Tptr;
+
+private:
+   std::vector<Tptr> slabs;
+   std::vector<Tptr> freeList;
+
+   size_t curSlab, curElem;
+
+public:
+   BHTreeNodeArena() : curSlab(0), curElem(0)
+   { }
+
+   ~BHTreeNodeArena()
+   {
+      const size_t noSlabs = slabs.size();
+      for (size_t i = 0; i < noSlabs; i++)
+         delete[] slabs[i];
+   }
+
+   Tptr pop()
+   {
+      if (not freeList.empty())
+      {
+         const Tptr ptr = freeList.back();
+         freeList.pop_back();
+         return(ptr);
+      }
+
+      if (curElem == slabSize)
+      {
+         curSlab++;
+         curElem = 0;
+      }
+
+      if (curSlab == slabs.size())
+         slabs.push_back(new T[slabSize]);
+
+      return(&slabs[curSlab][curElem++]);
+   }
+
+   void push(Tptr _ptr)
+   {
+      freeList.push_back(_ptr);
+   }
+
+   void clear()
+   {
+      curSlab = 0;
+      curElem = 0;
+      freeList.clear();
+   }
+
+   ///
+   /// release all nodes and free the slabs
+   ///
+   void release()
+   {
+      const size_t noSlabs = slabs.size();
+      for (size_t i = 0; i < noSlabs; i++)
+         delete[] slabs[i];
+      slabs.clear();
+      clear();
+   }
+
+   ///
+   /// number of nodes in use and allocated
+   ///
+   size_t getNoUsed()
+   {
+      return(curSlab * slabSize + curElem - freeList.size());
+   }
+
+   size_t getNoAllocated()
+   {
+      return(slabs.size() * slabSize);
+   }
+
+private:
+   BHTreeNodeArena(const BHTreeNodeArena&);
+   BHTreeNodeArena& operator=(const BHTreeNodeArena&);
+};
+};
+
+#endif
@@ -42,6 +42,7 @@ void genericNode::clear()
 
    isSettled   = false;
    needsUpdate = true;
+   isBucket    = false;
 }
 
 void genericCellNode::clear()
@@ -92,12 +93,9 @@ void costzoneCellNode::clear()
 {
    quadrupoleCellNode::clear();
 
-   for (size_t i = 0; i < 27; i++)
-   {
-      neighbour[i] = NULL;
-   }
+   assert(data != NULL);
+   data->clear();
 
-   domain  = 0;
    relCost = 0.;
    compTime = 0.;
 
@@ -116,10 +114,6 @@ void particleNode::clear()
    genericNode::clear();
 
    isParticle = true;
-
-   partPtr = NULL;
-   pos     = 0., 0., 0.;
-   m       = 0.;
 }
 
 ///
@@ -212,6 +206,12 @@ void quadrupoleCellNode::calcMultipole()
       com = 0, 0, 0;
 
    // calculate the quadrupole contributions
+   q11 = 0.;
+   q22 = 0.;
+   q33 = 0.;
+   q12 = 0.;
+   q13 = 0.;
+   q23 = 0.;
    for (size_t i = 0; i < 8; i++)
    {
       if (child[i] != NULL)
@@ -277,17 +277,23 @@ void costzoneCellNode::initFromCell(qcllT& _cell)
          child[i]->parent = this;
    }
 
-   for (size_t i = 0; i < 27; i++)
-   {
-      neighbour[i] = NULL;
-   }
+   data->clear();
 
-   domain   = 0;
    atBottom = false;
    neighSet = false;
 
    relCost = 0.;
    compTime = 0.;
+}
+
+void costzoneCellData::clear()
+{
+   for (size_t i = 0; i < 27; i++)
+   {
+      neighbour[i] = NULL;
+   }
+
+   domain = 0;
 
    for (size_t i = 0; i < 6; i++)
      relCostOld[i] = 0.;
@@ -354,7 +360,7 @@ void costzoneCellNode::pushdownNeighbours()
                                        (iy - jy + 1) * 3 +
                                        (iz - jz + 1) * 9;
 
-                        static_cast<czllPtrT>(child[jc])->neighbour[js] =
+                        static_cast<czllPtrT>(child[jc])->data->neighbour[js] =
                            child[ic];
                      }
                   }
@@ -374,7 +380,7 @@ void costzoneCellNode::pushdownNeighbours()
                const int ps = pix + piy * 3 + piz * 9;
 
                neighPtr = NULL;
-               if (neighbour[ps] != NULL)
+               if (data->neighbour[ps] != NULL)
                {
                   ///
                   /// if the neighbour cell has the same size as the
@@ -382,8 +388,8 @@ void costzoneCellNode::pushdownNeighbours()
                   /// neighbour. only try to use the child, when its parent
                   /// is not already at the costzone bottom.
                   ///
-                  if ((static_cast<gcllPtrT>(neighbour[ps])->clSz == clSz) &&
-                      not static_cast<czllPtrT>(neighbour[ps])->atBottom)
+                  if ((static_cast<gcllPtrT>(data->neighbour[ps])->clSz == clSz) &&
+                      not static_cast<czllPtrT>(data->neighbour[ps])->atBottom)
                   {
                      ///
                      /// determine the neighbours child index
@@ -392,15 +398,15 @@ void costzoneCellNode::pushdownNeighbours()
                                     ((iy + 2) % 2) * 2 +
                                     ((iz + 2) % 2) * 4;
 
-                     if (static_cast<gcllPtrT>(neighbour[ps])->child[jc]
+                     if (static_cast<gcllPtrT>(data->neighbour[ps])->child[jc]
                          != NULL)
                         neighPtr =
-                           static_cast<gcllPtrT>(neighbour[ps])->child[jc];
+                           static_cast<gcllPtrT>(data->neighbour[ps])->child[jc];
                      else
-                        neighPtr = neighbour[ps];
+                        neighPtr = data->neighbour[ps];
                   }
                   else
-                     neighPtr = neighbour[ps];
+                     neighPtr = data->neighbour[ps];
                }
 
                ///
@@ -429,7 +435,7 @@ void costzoneCellNode::pushdownNeighbours()
                                        (iy - jy + 1) * 3 +
                                        (iz - jz + 1) * 9;
 
-                        static_cast<czllPtrT>(child[jc])->neighbour[js] =
+                        static_cast<czllPtrT>(child[jc])->data->neighbour[js] =
                            neighPtr;
                      }
                   }
@@ -459,37 +465,5 @@ void costzoneCellNode::adopt(pnodPtrT _pnod)
    _pnod->isSettled = false;
    orphLast         = _pnod;
 }
-
-///
-/// update a particles position
-///
-void particleNode::update()
-{
-   pos = partPtr->pos;
-   m   = partPtr->m;
-}
-
-///
-/// deletes a CZ cells subtree
-/// (the childs walk has to be set!)
-///
-void costzoneCellNode::delSubtree()
-{
-   nodePtrT curChld = chldFrst, nxtChld = NULL;
-
-   chldLast->next = NULL;
-
-   while (curChld != NULL)
-   {
-      nxtChld = curChld->next;
-      if (curChld->isParticle)
-         delete static_cast<pnodPtrT>(curChld);
-      else if (curChld->isCZ)
-         delete static_cast<czllPtrT>(curChld);
-      else
-         delete static_cast<qcllPtrT>(curChld);
-      curChld = nxtChld;
-   }
-}
 };
 #endif
@@ -10,6 +10,8 @@
  *
  */
 
+#include <stdint.h>
+
 #include "typedefs.h"
 
 namespace sphlatch {
@@ -19,6 +21,7 @@ class genericCellNode;
 class monopoleCellNode;
 class quadrupoleCellNode;
 class costzoneCellNode;
+class costzoneCellData;
 class particleNode;
 
 typedef treeGhost             treeghoT;
@@ -33,6 +36,8 @@ typedef quadrupoleCellNode    qcllT;
 typedef quadrupoleCellNode*   qcllPtrT;
 typedef costzoneCellNode      czllT;
 typedef costzoneCellNode*     czllPtrT;
+typedef costzoneCellData      czdtT;
+typedef costzoneCellData*     czdtPtrT;
 typedef particleNode          pnodT;
 typedef particleNode*         pnodPtrT;
 
@@ -68,6 +73,13 @@ public:
    bool isSettled    : 1;
    bool needsUpdate  : 1;
 
+   ///
+   /// indicates whether a cell is a leaf bucket, which keeps
+   /// its particles in the first free child slots regardless
+   /// of their octant
+   ///
+   bool isBucket     : 1;
+
    genericNode() { }
    ~genericNode() { }
 
@@ -112,10 +124,6 @@ public:
    ~monopoleCellNode() { }
 
    void clear();
-
-#ifdef SPHLATCH_PADD64
-   char pad[0];
-#endif
 };
 
 ///
@@ -139,8 +147,6 @@ public:
       };
    };
 
-   countsType noParts;
-
    quadrupoleCellNode() { }
    ~quadrupoleCellNode() { }
 
@@ -148,11 +154,6 @@ public:
    void initFromCZll(czllT& _czll);
 
    void calcMultipole();
-
-private:
-#ifdef SPHLATCH_PADD64
-   char pad[38];
-#endif
 };
 
 ///
@@ -167,20 +168,26 @@ public:
    ///
    nodePtrT chldFrst, chldLast;
 
-   nodePtrT neighbour[27];
-   idType   domain;
+   ///
+   /// index of the cell in the frozen tree
+   ///
+   uint32_t frozenIdx;
+
+   countsType noParts;
 
    fType relCost;
    fType compTime;
 
-   typedef blitz::TinyVector<fType, 6>   costHistT;
-   costHistT relCostOld;
-
    ///
    /// adopted orphans
    ///
    pnodPtrT orphFrst, orphLast;
 
+   ///
+   /// the rarely used data in the side table
+   ///
+   czdtPtrT data;
+
    costzoneCellNode() { }
    ~costzoneCellNode() { }
 
@@ -188,33 +195,40 @@ public:
    void initFromCell(qcllT& _qcll);
    void adopt(pnodPtrT _pnod);
    void pushdownNeighbours();
-   void delSubtree();
+};
 
-private:
-#ifdef SPHLATCH_PADD64
-   char pad[0];
-#endif
+///
+/// rarely used data of a CZ cell, kept in a side table
+/// to keep the CZ cells small
+///
+class costzoneCellData {
+public:
+   nodePtrT neighbour[27];
+   idType   domain;
+
+   typedef blitz::TinyVector<fType, 6>   costHistT;
+   costHistT relCostOld;
+
+   costzoneCellData() { }
+   ~costzoneCellData() { }
+
+   void clear();
 };
 
 ///
-/// a particle node
+/// a particle node, the base of the tree particles. the particles
+/// themselves are the leaves of the tree, so there is no separate
+/// node to allocate and no position and mass to copy into it.
 ///
 class particleNode : public genericNode {
 public:
-   treeghoPtrT partPtr;
-   vect3dT     pos;
-   fType       m;
+   vect3dT pos;
+   fType   m;
 
    particleNode() { isParticle = true; }
    ~particleNode() { }
 
    void clear();
-   void update();
-
-#ifdef SPHLATCH_PADD64
-private:
-   char pad[0];
-#endif
 };
 };
 #endif
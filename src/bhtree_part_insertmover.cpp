@@ -9,6 +9,8 @@
  *
  */
 
+#include <algorithm>
+
 #include "bhtree_part_insertmover.h"
 #include "bhtree_worker.cpp"
 
@@ -21,44 +23,111 @@ namespace sphlatch {
 void BHTreePartsInsertMover::insert(partT& _part)
 {
    ///
-   /// allocate particle node, wire it to its proxy and
-   /// set nodes parameters
+   /// the particle is its own node, so just
+   /// set the nodes parameters
    ///
-   const pnodPtrT newPartPtr = new pnodT;
+   const pnodPtrT newPartPtr = &_part;
 
    newPartPtr->clear();
 
-   newPartPtr->partPtr = &_part;
-   _part.treeNode      = newPartPtr;
-
    newPartPtr->ident     = _part.id;
    newPartPtr->depth     = 0;
    newPartPtr->isSettled = false;
 
+   const vect3dT pos      = newPartPtr->pos;
+   const fType   partCost = _part.cost;
+
+   if (not pointInsideCell(pos, rootPtr))
+      growRoot(pos);
+
    ///
-   /// wire the root cell as particles parent (in case the tree
-   /// is not cleaned before use, this particle is not found in
-   /// a tree walk, as it is not yet wired as a child of a cell)
+   /// go down the CZ tree to the bottom CZ cell containing the
+   /// particle and let it adopt the particle. the particle is
+   /// pushed down further with the other orphans in the next
+   /// update. this way the particle is not found in a tree walk
+   /// until then, also when the tree was kept from the last update.
    ///
-   newPartPtr->parent = treePtr->rootPtr;
+   goRoot();
+   static_cast<czllPtrT>(curPtr)->noParts++;
+   static_cast<czllPtrT>(curPtr)->relCost += partCost;
 
-   static_cast<czllPtrT>(rootPtr)->noParts++;
-   static_cast<czllPtrT>(rootPtr)->relCost += _part.cost;
+   while (not curPtr->atBottom)
+   {
+      goChild(getOctant(pos));
+      static_cast<czllPtrT>(curPtr)->noParts++;
+      static_cast<czllPtrT>(curPtr)->relCost += partCost;
+   }
 
-   pushUpAndToCZSingle(newPartPtr);
+   static_cast<czllPtrT>(curPtr)->adopt(newPartPtr);
+   newPartPtr->parent = curPtr;
 }
 
-void BHTreePartsInsertMover::move(const czllPtrT _czll)
+///
+/// insert a particle directly below a bottom CZ cell without touching
+/// the CZ cell costs, used to build the subtrees of several CZ cells
+/// concurrently. returns false if the particle does not lie inside
+/// the CZ cell.
+///
+bool BHTreePartsInsertMover::insertBelow(const czllPtrT _czll, partT& _part)
 {
-   nodePtrT curPart = _czll->chldFrst;
+   if (not pointInsideCell(_part.pos, _czll))
+      return(false);
 
-   if (_czll->chldLast != NULL)
-      _czll->chldLast->next = NULL;
+   const pnodPtrT newPartPtr = &_part;
 
+   newPartPtr->clear();
+
+   newPartPtr->ident     = _part.id;
+   newPartPtr->depth     = 0;
+   newPartPtr->isSettled = false;
+
+   newPartPtr->parent = _czll;
+
+   pushDownSingle(newPartPtr);
+   return(true);
+}
+
+void BHTreePartsInsertMover::move(const czllPtrT _czll)
+{
    ///
    /// if there is a last child, set its next pointer to NULL,
    /// so that the next walk for moving terminates
    ///
+   if (_czll->chldLast != NULL)
+      _czll->chldLast->next = NULL;
+
+   ///
+   /// the particle costs may have changed since the last update,
+   /// so recount the cost of the CZ cell from its particles and
+   /// orphans before moving them. particles leaving the cell are
+   /// substracted again in pushUpAndToCZSingle()
+   ///
+   fType      relCost = 0.;
+   countsType noParts = 0;
+
+   nodePtrT curPart = _czll->chldFrst;
+   while (curPart != NULL)
+   {
+      if (curPart->isParticle)
+      {
+         relCost += static_cast<treeghoPtrT>(curPart)->cost;
+         noParts++;
+      }
+      curPart = curPart->next;
+   }
+
+   curPart = _czll->orphFrst;
+   while (curPart != NULL)
+   {
+      relCost += static_cast<treeghoPtrT>(curPart)->cost;
+      noParts++;
+      curPart = curPart->next;
+   }
+
+   _czll->relCost = relCost;
+   _czll->noParts = noParts;
+
+   curPart = _czll->chldFrst;
    while (curPart != NULL)
    {
       const nodePtrT nextPart = curPart->next;
@@ -74,6 +143,8 @@ void BHTreePartsInsertMover::pushDownOrphans(const czllPtrT _czll)
 
    while (curPart != NULL)
    {
+      // orphans may have been handed over from other CZ cells
+      curPart->parent = _czll;
       pushDownSingle(static_cast<pnodPtrT>(curPart));
       curPart = curPart->next;
    }
@@ -83,7 +154,7 @@ void BHTreePartsInsertMover::pushDownOrphans(const czllPtrT _czll)
 }
 
 ///
-/// update particle position and move it to the current CZ bottom
+/// move a particle to the CZ bottom cell containing its new position
 ///
 void BHTreePartsInsertMover::pushUpAndToCZSingle(const pnodPtrT _pnodPtr)
 {
@@ -95,31 +166,31 @@ void BHTreePartsInsertMover::pushUpAndToCZSingle(const pnodPtrT _pnodPtr)
    curPtr = _pnodPtr->parent;
    const size_t oldOct = getChildNo(_pnodPtr);
 
-   ///
-   /// update particle position and mass
-   ///
-   _pnodPtr->update();
    const vect3dT pos = _pnodPtr->pos;
 
    ///
    /// a short-cut for those particles which
-   /// will stay in the same cell octant
+   /// will stay in the same cell octant or bucket
    ///
    if (pointInsideCell(pos) &&
-       (getOctant(pos) == oldOct))
+       (curPtr->isBucket || getOctant(pos) == oldOct))
       return;
 
    ///
-   /// if the particle was a child of the parent cell
+   /// if the particle left the root cell, grow the root cell
+   /// until it contains the particle again
    ///
-   if (oldOct != 8)
-      static_cast<gcllPtrT>(curPtr)->child[oldOct] = NULL;
+   if (not pointInsideCell(pos, rootPtr))
+   {
+      growRoot(pos);
+      curPtr = _pnodPtr->parent;
+   }
 
    ///
-   /// check whether the particle lies inside the root cell
+   /// if the particle was a child of the parent cell
    ///
-   if (not pointInsideCell(pos, rootPtr))
-   { }
+   if (oldOct != 8)
+      static_cast<gcllPtrT>(curPtr)->child[oldOct] = NULL;
 
    ///
    /// go up until the particle lies in the current cell. as
@@ -127,7 +198,7 @@ void BHTreePartsInsertMover::pushUpAndToCZSingle(const pnodPtrT _pnodPtr)
    /// each CZ cell we encounter
    ///
    bool        CZencounter = false;
-   const fType partCost    = static_cast<pnodPtrT>(_pnodPtr)->partPtr->cost;
+   const fType partCost    = static_cast<treeghoPtrT>(_pnodPtr)->cost;
 
    while (not pointInsideCell(pos))
    {
@@ -156,15 +227,120 @@ void BHTreePartsInsertMover::pushUpAndToCZSingle(const pnodPtrT _pnodPtr)
       static_cast<czllPtrT>(curPtr)->adopt(_pnodPtr);
    }
    else
+   {
+      _pnodPtr->parent = curPtr;
       pushDownSingle(_pnodPtr);
+   }
 
    _pnodPtr->parent = curPtr;
 }
 
+///
+/// grow the root cell by parent levels until it contains the position.
+/// the root cell node itself is kept: its content is moved into a new
+/// CZ cell, which becomes a child of the enlarged root cell. the other
+/// children are new empty bottom CZ cells. the depth of all nodes is
+/// increased by one for each new level.
+///
+void BHTreePartsInsertMover::growRoot(const vect3dT& _pos)
+{
+   const czllPtrT rootCZll = static_cast<czllPtrT>(rootPtr);
+   BHTree::czllPtrVectT& CZbottom(treePtr->CZbottom);
+
+   while (not pointInsideCell(_pos, rootPtr))
+   {
+      ///
+      /// the old root cell lies in the octant opposite to the position
+      ///
+      const fType oldClSz = rootCZll->clSz;
+      vect3dT     newCen  = rootCZll->cen;
+      for (size_t i = 0; i < 3; i++)
+         newCen[i] += _pos[i] < newCen[i] ? -0.5 * oldClSz : 0.5 * oldClSz;
+
+      const czllPtrT oldRoot     = newCZll();
+      const czdtPtrT oldRootData = oldRoot->data;
+      *oldRoot      = *rootCZll;
+      *oldRootData  = *rootCZll->data;
+      oldRoot->data = oldRootData;
+
+      rootCZll->data->clear();
+      rootCZll->neighSet = false;
+      for (size_t i = 0; i < 8; i++)
+      {
+         if (oldRoot->child[i] != NULL)
+            oldRoot->child[i]->parent = oldRoot;
+      }
+
+      if (rootCZll->atBottom)
+         std::replace(CZbottom.begin(), CZbottom.end(), rootCZll, oldRoot);
+
+      ///
+      /// set up the enlarged root cell, keeping its costs
+      ///
+      rootCZll->cen      = newCen;
+      rootCZll->clSz     = 2. * oldClSz;
+      rootCZll->atBottom = false;
+      rootCZll->next     = NULL;
+      rootCZll->skip     = NULL;
+      rootCZll->chldFrst = NULL;
+      rootCZll->chldLast = NULL;
+      rootCZll->orphFrst = NULL;
+      rootCZll->orphLast = NULL;
+
+      const size_t oldOct = rootCZll->getOctant(oldRoot->cen);
+      for (size_t i = 0; i < 8; i++)
+      {
+         if (i == oldOct)
+         {
+            rootCZll->child[i] = oldRoot;
+            oldRoot->parent    = rootCZll;
+         }
+         else
+         {
+            const czllPtrT newCZllPtr = newCZll();
+            newCZllPtr->clear();
+            newCZllPtr->parent = rootCZll;
+            rootCZll->child[i] = newCZllPtr;
+            newCZllPtr->inheritCellPos(i);
+            newCZllPtr->atBottom = true;
+            CZbottom.push_back(newCZllPtr);
+         }
+      }
+
+      ///
+      /// increase the depth of the old tree
+      ///
+      curPtr = oldRoot;
+      incDepthRecursor();
+      curPtr = rootPtr;
+
+      treePtr->noCells += 8;
+   }
+}
+
+void BHTreePartsInsertMover::incDepthRecursor()
+{
+   curPtr->depth++;
+
+   if (not curPtr->isParticle)
+   {
+      for (size_t i = 0; i < 8; i++)
+      {
+         if (static_cast<gcllPtrT>(curPtr)->child[i] != NULL)
+         {
+            goChild(i);
+            incDepthRecursor();
+            goUp();
+         }
+      }
+   }
+}
+
 void BHTreePartsInsertMover::pushDownSingle(const pnodPtrT _pnodPtr)
 {
    curPtr = _pnodPtr->parent;
-   const vect3dT pos = _pnodPtr->pos;
+   const vect3dT pos        = _pnodPtr->pos;
+   const size_t  bucketSize = treePtr->bucketSize;
 
    assert(pointInsideCell(pos));
    assert(not curPtr->isParticle);
@@ -172,6 +348,33 @@ void BHTreePartsInsertMover::pushDownSingle(const pnodPtrT _pnodPtr)
    bool isSettled = false;
    while (not isSettled)
    {
+      ///
+      /// a bucket takes the particle into a free slot, a full
+      /// bucket is turned into an ordinary cell first
+      ///
+      if (curPtr->isBucket)
+      {
+         const gcllPtrT bucketPtr = static_cast<gcllPtrT>(curPtr);
+
+         if (bucketPtr->getNoChld() < bucketSize)
+         {
+            size_t slot = 0;
+            while (bucketPtr->child[slot] != NULL)
+               slot++;
+
+            bucketPtr->child[slot] = _pnodPtr;
+
+            _pnodPtr->parent    = curPtr;
+            _pnodPtr->depth     = curPtr->depth + 1;
+            _pnodPtr->isSettled = true;
+
+            isSettled = true;
+         }
+         else
+            bucketToCell(curPtr);
+         continue;
+      }
+
       const size_t curOct = getOctant(pos);
       ///
       /// child is empty, particle can be inserted directly
@@ -201,8 +404,12 @@ void BHTreePartsInsertMover::pushDownSingle(const pnodPtrT _pnodPtr)
             exit(-1);
          }*/
          if (static_cast<gcllPtrT>(curPtr)->child[curOct]->isParticle)
-            static_cast<gcllPtrT>(curPtr)->child[curOct] =
+         {
+            if (bucketSize > 1)
+               partToBucket(curPtr, curOct);
+            else
                partToCell(curPtr, curOct);
+         }
          goChild(curOct);
       }
    }
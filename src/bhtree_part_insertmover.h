@@ -26,6 +26,7 @@ public:
 
 public:
    void insert(partT& _part);
+   bool insertBelow(const czllPtrT _czll, partT& _part);
    void move(const czllPtrT _czll);
    void pushDownOrphans(const czllPtrT _czll);
 
@@ -33,6 +34,9 @@ private:
    void pushUpAndToCZSingle(const pnodPtrT _pnodPtr);
 
    void pushDownSingle(const pnodPtrT _pnodPtr);
+
+   void growRoot(const vect3dT& _pos);
+   void incDepthRecursor();
 };
 };
 
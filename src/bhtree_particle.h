@@ -14,27 +14,19 @@
 #include "typedefs.h"
 
 namespace sphlatch {
-class particleNode;
 ///
-/// basic tree particle class
+/// basic tree particle class, the particle is its own node in
+/// the tree and inherits position and mass from particleNode
 ///
-class treeGhost {
+class treeGhost : public particleNode {
 public:
-   typedef particleNode*   partNodePtrT;
-   vect3dT      pos;
-   fType        m, eps;
-   partNodePtrT treeNode;
+   fType eps;
 
    idType id;
    fType  cost;
 #ifdef SPHLATCH_GRAVITY_POTENTIAL
    fType pot;
 #endif
-
-#ifdef SPHLATCH_PADD64
-private:
-   char pad[8];
-#endif
 };
 
 ///
@@ -56,6 +48,9 @@ public:
 class movingPart : public movingGhost {
 public:
    vect3dT acc;
+#ifdef SPHLATCH_GRAVITY_RELATIVEMAC
+   fType aold;
+#endif
 };
 };
 #endif
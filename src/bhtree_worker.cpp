@@ -85,7 +85,7 @@ void BHTreeWorker::goChild(const size_t _n)
 void BHTreeWorker::goNeighbour(const size_t _n)
 {
    assert(curPtr != NULL);
-   curPtr = static_cast<czllPtrT>(curPtr)->neighbour[_n];
+   curPtr = static_cast<czllPtrT>(curPtr)->data->neighbour[_n];
 }
 
 bool BHTreeWorker::pointInsideCell(const vect3dT& _pos)
@@ -214,15 +214,46 @@ size_t BHTreeWorker::getChildNo(nodePtrT _nodePtr, nodePtrT _parPtr)
    return(8);
 }
 
+///
+/// get cells from and return them to the node arenas of the
+/// current thread, particles are their own nodes. the cells
+/// are not initialized, except for the side table entry of
+/// the CZ cells.
+///
+qcllPtrT BHTreeWorker::newCell()
+{
+   assert(myThread < treePtr->qcllArenas.size());
+   return(treePtr->qcllArenas[myThread]->pop());
+}
+
+czllPtrT BHTreeWorker::newCZll()
+{
+   assert(myThread < treePtr->czllArenas.size());
+   const czllPtrT czllPtr = treePtr->czllArenas[myThread]->pop();
+   czllPtr->data = treePtr->czdtArenas[myThread]->pop();
+   return(czllPtr);
+}
+
+void BHTreeWorker::delCell(const qcllPtrT _qcllPtr)
+{
+   treePtr->qcllArenas[myThread]->push(_qcllPtr);
+}
+
+void BHTreeWorker::delCZll(const czllPtrT _czllPtr)
+{
+   treePtr->czdtArenas[myThread]->push(_czllPtr->data);
+   treePtr->czllArenas[myThread]->push(_czllPtr);
+}
+
 ///
 /// transforms a CZ cell into a quadrupole
 ///
 qcllPtrT BHTreeWorker::czllToCell(nodePtrT _nodePtr)
 {
-   const qcllPtrT newCellPtr = new qcllT;
+   const qcllPtrT newCellPtr = newCell();
 
    newCellPtr->initFromCZll(static_cast<czllT&>(*_nodePtr));
-   delete static_cast<czllPtrT>(_nodePtr);
+   delCZll(static_cast<czllPtrT>(_nodePtr));
    return(newCellPtr);
 }
 
@@ -231,10 +262,10 @@ qcllPtrT BHTreeWorker::czllToCell(nodePtrT _nodePtr)
 ///
 czllPtrT BHTreeWorker::cellToCZll(nodePtrT _nodePtr)
 {
-   const czllPtrT newCZllPtr = new czllT;
+   const czllPtrT newCZllPtr = newCZll();
 
    newCZllPtr->initFromCell(static_cast<qcllT&>(*_nodePtr));
-   delete static_cast<qcllPtrT>(_nodePtr);
+   delCell(static_cast<qcllPtrT>(_nodePtr));
    return(newCZllPtr);
 }
 
@@ -245,10 +276,12 @@ qcllPtrT BHTreeWorker::partToCell(nodePtrT _cellPtr, const size_t _oct)
    const pnodPtrT resPartPtr =
       static_cast<pnodPtrT>(static_cast<gcllPtrT>(_cellPtr)->child[_oct]);
 
-   const qcllPtrT newCellPtr = new qcllT;
+   const qcllPtrT newCellPtr = newCell();
 
    newCellPtr->clear();
-   newCellPtr->ident = treePtr->noCells;
+
+   // cells may be created by several threads at once
+#pragma omp atomic
    treePtr->noCells++;
 
    // wire new cell and its parent
@@ -267,5 +300,68 @@ qcllPtrT BHTreeWorker::partToCell(nodePtrT _cellPtr, const size_t _oct)
 
    return(newCellPtr);
 }
+
+///
+/// same as partToCell(), but the new cell is a bucket
+///
+qcllPtrT BHTreeWorker::partToBucket(nodePtrT _cellPtr, const size_t _oct)
+{
+   const qcllPtrT newCellPtr = partToCell(_cellPtr, _oct);
+
+   newCellPtr->isBucket = true;
+   return(newCellPtr);
+}
+
+///
+/// turns a bucket into an ordinary cell by sorting its particles
+/// into the octants. particles sharing an octant are put into a
+/// new bucket below.
+///
+void BHTreeWorker::bucketToCell(nodePtrT _cellPtr)
+{
+   const gcllPtrT cellPtr = static_cast<gcllPtrT>(_cellPtr);
+
+   assert(cellPtr->isBucket);
+
+   nodePtrT parts[8];
+   for (size_t i = 0; i < 8; i++)
+   {
+      parts[i]          = cellPtr->child[i];
+      cellPtr->child[i] = NULL;
+   }
+   cellPtr->isBucket = false;
+
+   for (size_t i = 0; i < 8; i++)
+   {
+      if (parts[i] == NULL)
+         continue;
+
+      const pnodPtrT pnodPtr = static_cast<pnodPtrT>(parts[i]);
+      const size_t   oct     = getOctant(pnodPtr->pos, cellPtr);
+
+      if (cellPtr->child[oct] == NULL)
+      {
+         cellPtr->child[oct] = pnodPtr;
+         pnodPtr->parent     = cellPtr;
+         pnodPtr->depth      = cellPtr->depth + 1;
+      }
+      else
+      {
+         if (cellPtr->child[oct]->isParticle)
+            partToBucket(cellPtr, oct);
+
+         const gcllPtrT bucketPtr =
+            static_cast<gcllPtrT>(cellPtr->child[oct]);
+
+         size_t slot = 0;
+         while (bucketPtr->child[slot] != NULL)
+            slot++;
+
+         bucketPtr->child[slot] = pnodPtr;
+         pnodPtr->parent        = bucketPtr;
+         pnodPtr->depth         = bucketPtr->depth + 1;
+      }
+   }
+}
 };
 #endif
@@ -48,9 +48,17 @@ protected:
    size_t getChildNo(nodePtrT _nodePtr);
    size_t getChildNo(nodePtrT _nodePtr, nodePtrT _parPtr);
 
+   qcllPtrT newCell();
+   czllPtrT newCZll();
+
+   void delCell(const qcllPtrT _qcllPtr);
+   void delCZll(const czllPtrT _czllPtr);
+
    qcllPtrT czllToCell(nodePtrT _nodePtr);
    czllPtrT cellToCZll(nodePtrT _nodePtr);
    qcllPtrT partToCell(nodePtrT _nodePtr, const size_t _oct);
+   qcllPtrT partToBucket(nodePtrT _nodePtr, const size_t _oct);
+   void     bucketToCell(nodePtrT _nodePtr);
 
    const size_t   noThreads, myThread;
    const treePtrT treePtr;
@@ -28,12 +28,30 @@ private:
 template<typename _partT>
 void CostWorker<_partT>::operator()(const czllPtrT _czll)
 {
-   nodePtrT       curPart  = _czll->chldFrst;
-   const nodePtrT stopChld = _czll->chldLast->next;
-
    const fType totTime = _czll->compTime;
    const fType absTime = totTime / static_cast<fType>(_czll->noParts);
 
+   ///
+   /// the cells below the CZ cell may be
+   /// released, when the tree is frozen
+   ///
+   if (treePtr->isFrozen())
+   {
+      typedef BHTreeFrozen::idxT   idxT;
+      const BHTreeFrozen& frz(treePtr->getFrozen());
+      const idxT          last = frz.hot[_czll->frozenIdx].skip;
+
+      for (idxT i = _czll->frozenIdx + 1; i < last; i++)
+      {
+         if (frz.hot[i].isParticle)
+            frz.part[i]->cost = absTime;
+      }
+      return;
+   }
+
+   nodePtrT       curPart  = _czll->chldFrst;
+   const nodePtrT stopChld = _czll->chldLast->next;
+
    // an empty CZ cell may have an chldFrst pointing to NULL
    if (curPart == NULL)
       return;
@@ -41,7 +59,7 @@ void CostWorker<_partT>::operator()(const czllPtrT _czll)
    while (curPart != stopChld)
    {
       if (curPart->isParticle)
-        static_cast<pnodPtrT>(curPart)->partPtr->cost = absTime;
+        static_cast<treeghoPtrT>(curPart)->cost = absTime;
       curPart = curPart->next;
    }
 }
@@ -0,0 +1,923 @@
+#ifndef BHTREE_WORKER_FMM_CPP
+#define BHTREE_WORKER_FMM_CPP
+
+/*
+ *  bhtree_worker_fmm.cpp
+ *
+ *  fast multipole gravity on the frozen tree. one dual tree traversal
+ *  of the whole tree against itself finds the interactions, starting
+ *  with the self interaction of the root. well separated pairs of
+ *  nodes interact cell-cell and both add the field of the other one
+ *  to their local expansion, pairs of small nodes which are too close
+ *  are summed up directly for both, otherwise the larger node is
+ *  opened. every pair is met once, so the number of interactions and
+ *  the cost grow with N. the local expansions are passed down the
+ *  tree to the particles afterwards.
+ *
+ *  the local expansions hold the potential, the field and its first
+ *  and second derivatives, the sources are the monopole and quadrupole
+ *  moments of the tree. the second derivatives are taken from the
+ *  monopole only, the quadrupole part would be of higher order.
+ *
+ *  the traversal is split into tasks at the top of the tree, which
+ *  the threads walk in parallel. the nodes are split into one range
+ *  per thread with the same number of particles and a thread owns the
+ *  expansions of its range. a pair of nodes of the same owner is
+ *  evaluated once for both, a pair across two owners is evaluated by
+ *  each of them for its own node.
+ *
+ *  Created by Andreas Reufer on 28.01.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#ifdef SPHLATCH_OPENMP
+ #include <omp.h>
+#endif
+
+#include "bhtree_worker.cpp"
+#include "bhtree.h"
+#include "bhtree_grav_softening.cpp"
+#include "timer.cpp"
+
+namespace sphlatch {
+template<typename _partT>
+class FMMWorker : public BHTreeWorker {
+public:
+   FMMWorker(const treePtrT _treePtr,
+             const fType    _G) : BHTreeWorker(_treePtr), G(_G),
+      theta(0.5), groupSize(16) { }
+   FMMWorker(const FMMWorker& _fw) : BHTreeWorker(_fw), G(_fw.G),
+      theta(_fw.theta), groupSize(_fw.groupSize) { }
+   ~FMMWorker() { }
+
+   ///
+   /// the acceleration of the particles below the frozen <_cells>
+   /// due to the whole tree, with <_withPot> the potential of the
+   /// same traversal is stored as well. the time of the traversal
+   /// is split up over the cells by their number of interactions.
+   /// not to be called from inside a parallel region.
+   ///
+   void calcAcc(const BHTree::czllPtrVectT& _cells,
+                const bool                  _withPot = false);
+   void calcPot(const BHTree::czllPtrVectT& _cells);
+
+   ///
+   /// the potential of all particles of the frozen tree <_frz> due
+   /// to the particles of <_frz> alone, for subset trees (see
+   /// BHTreeFrozen::setSubset())
+   ///
+   void calcPot(const BHTreeFrozen& _frz);
+
+   ///
+   /// two nodes interact cell-cell, if the sum of their radii is
+   /// smaller than <theta> times their distance. nodes with at most
+   /// <groupSize> particles interact particle-particle otherwise.
+   ///
+   void setTheta(const fType _theta);
+   void setGroupSize(const size_t _groupSize);
+
+   typedef BHTreeFrozen::idxT   idxT;
+   typedef sphlatch::Timer      timerT;
+
+   ///
+   /// local expansion around the center of mass of a node, the
+   /// symmetric field derivatives are stored as
+   ///  dadx:   xx, yy, zz, xy, xz, yz
+   ///  d2adx:  xxx, yyy, zzz, xxy, xxz, xyy, yyz, xzz, yzz, xyz
+   ///
+   class localExp {
+public:
+      fType   phi;
+      vect3dT acc;
+      fType   dadx[6];
+      fType   d2adx[10];
+
+      void clear()
+      {
+         phi = 0.;
+         acc = 0., 0., 0.;
+         for (size_t i = 0; i < 6; i++)
+            dadx[i] = 0.;
+         for (size_t i = 0; i < 10; i++)
+            d2adx[i] = 0.;
+      }
+   };
+
+private:
+   ///
+   /// an interaction of the node <a> with the node <b>,
+   /// for <both> it is evaluated for both nodes
+   ///
+   class interT {
+public:
+      interT(const idxT _a, const idxT _b, const bool _both) :
+         a(_a), b(_b), both(_both) { }
+
+      idxT a, b;
+      bool both;
+   };
+
+   typedef std::vector<interT>     interVectT;
+   typedef std::pair<idxT, idxT>   idxPairT;
+   typedef std::vector<idxPairT>   idxPairVectT;
+
+   ///
+   /// where a traversal puts its interactions, one list per owner.
+   /// when <tasks> is set, pairs with at most <taskSize> particles
+   /// are left there for later.
+   ///
+   class walkT {
+public:
+      interVectT*   cc;
+      interVectT*   pp;
+      idxPairVectT* tasks;
+      size_t        taskSize;
+   };
+
+   void dualWalk(const BHTreeFrozen& _frz);
+
+   void interactSelf(const idxT _a, walkT& _w) const;
+   void interact(const idxT _a, const idxT _b, walkT& _w) const;
+   void addInter(interVectT* _lists, const idxT _a, const idxT _b) const;
+
+   void cellCell(const idxT _a, const idxT _b, const bool _both);
+   void addField(const idxT _sink, const fType _rx, const fType _ry,
+                 const fType _rz, const fType _Or, const fType _m,
+                 const BHTreeFrozen::quadNode& _q);
+   void partPart(const idxT _a, const idxT _b, const bool _both);
+   void partPair(const idxT _i, const idxT _j, const bool _both);
+
+   void ancestors(const int _own);
+   void passDown(const int _own);
+   void shift(const localExp& _P, const vect3dT& _s,
+              fType& _phi, vect3dT& _acc, localExp* _L);
+
+   int owner(const idxT _i) const;
+   fType radius(const idxT _i) const;
+   fType softening(const idxT _i) const;
+
+   const BHTreeFrozen::quadNode& quad(const idxT _i) const;
+
+   ///
+   /// the expansions of the cells, the potential and field of the
+   /// particles and the interactions per particle of each node
+   ///
+   const BHTreeFrozen*   frzPtr;
+   std::vector<localExp> loc;
+   std::vector<fType>    partPhi;
+   std::vector<vect3dT>  partAcc;
+   std::vector<fType>    cost;
+   fType                 totalCost;
+
+   ///
+   /// the first node of each owner, the ancestors of the first node
+   /// and their final expansions and interactions per particle
+   ///
+   int                                 noOwners;
+   std::vector<idxT>                   bound;
+   std::vector<std::vector<idxT> >     ancIdx;
+   std::vector<std::vector<localExp> > ancLoc;
+   std::vector<std::vector<fType> >    ancCost;
+
+   timerT Timer;
+
+protected:
+   const fType G;
+   fType       theta;
+   size_t      groupSize;
+};
+
+template<typename _partT>
+void FMMWorker<_partT>::setTheta(const fType _theta)
+{
+   theta = _theta;
+}
+
+template<typename _partT>
+void FMMWorker<_partT>::setGroupSize(const size_t _groupSize)
+{
+   groupSize = _groupSize > 0 ? _groupSize : 1;
+}
+
+template<typename _partT>
+void FMMWorker<_partT>::calcAcc(const BHTree::czllPtrVectT& _cells,
+                                const bool                  _withPot)
+{
+   assert(treePtr->isFrozen());
+
+   Timer.start();
+   dualWalk(treePtr->getFrozen());
+   const fType walkTime = static_cast<fType>(Timer.getRoundTime()) *
+                          noOwners;
+
+   const BHTreeFrozen& frz(*frzPtr);
+   const int           noCells = _cells.size();
+#pragma omp parallel for schedule(dynamic)
+   for (int c = 0; c < noCells; c++)
+   {
+      const idxT frst = _cells[c]->frozenIdx;
+      const idxT last = frz.hot[frst].skip;
+
+      fType cellCost = 0.;
+      for (idxT i = frst; i < last; i++)
+      {
+         if (frz.hot[i].isParticle)
+         {
+            _partT* const part = static_cast<_partT*>(frz.part[i]);
+            part->acc += G * partAcc[i];
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+            if (_withPot)
+               part->pot = G * partPhi[i];
+#endif
+            cellCost += cost[i];
+         }
+      }
+      if (totalCost > 0.)
+         _cells[c]->compTime += walkTime * cellCost / totalCost;
+   }
+}
+
+template<typename _partT>
+void FMMWorker<_partT>::calcPot(const BHTree::czllPtrVectT& _cells)
+{
+   assert(treePtr->isFrozen());
+
+   Timer.start();
+   dualWalk(treePtr->getFrozen());
+   const fType walkTime = static_cast<fType>(Timer.getRoundTime()) *
+                          noOwners;
+
+   const BHTreeFrozen& frz(*frzPtr);
+   const int           noCells = _cells.size();
+#pragma omp parallel for schedule(dynamic)
+   for (int c = 0; c < noCells; c++)
+   {
+      const idxT frst = _cells[c]->frozenIdx;
+      const idxT last = frz.hot[frst].skip;
+
+      fType cellCost = 0.;
+      for (idxT i = frst; i < last; i++)
+      {
+         if (frz.hot[i].isParticle)
+         {
+            static_cast<_partT*>(frz.part[i])->pot = G * partPhi[i];
+            cellCost += cost[i];
+         }
+      }
+      if (totalCost > 0.)
+         _cells[c]->compTime += walkTime * cellCost / totalCost;
+   }
+}
+
+template<typename _partT>
+void FMMWorker<_partT>::calcPot(const BHTreeFrozen& _frz)
+{
+   dualWalk(_frz);
+
+   const int noNodes = _frz.size();
+#pragma omp parallel for
+   for (int i = 0; i < noNodes; i++)
+   {
+      if (_frz.hot[i].isParticle)
+         static_cast<_partT*>(_frz.part[i])->pot = G * partPhi[i];
+   }
+}
+
+///
+/// the interactions of the whole tree <_frz> with itself, afterwards
+/// the particle nodes hold their potential and field in partPhi and
+/// partAcc and their share of the interactions in cost
+///
+template<typename _partT>
+void FMMWorker<_partT>::dualWalk(const BHTreeFrozen& _frz)
+{
+   frzPtr = &_frz;
+
+#ifdef SPHLATCH_OPENMP
+   noOwners = omp_get_max_threads();
+#else
+   noOwners = 1;
+#endif
+
+   const idxT noNodes = _frz.size();
+   loc.resize(_frz.getNoCells());
+   partPhi.resize(noNodes);
+   partAcc.resize(noNodes);
+   cost.resize(noNodes);
+   totalCost = 0.;
+
+   ///
+   /// the owner ranges hold the same number of particles. a small
+   /// node writes to its particles in the direct sums, so a range
+   /// never starts inside of one.
+   ///
+   const size_t nop = noNodes > 0 ? _frz.noParts[0] : 0;
+   bound.assign(noOwners + 1, noNodes);
+   bound[0] = 0;
+
+   size_t seen = 0;
+   int    own  = 1;
+   idxT   i    = 0;
+   while (i < noNodes && own < noOwners)
+   {
+      while (own < noOwners && seen >= (nop * own) / noOwners)
+         bound[own++] = i;
+      if (_frz.noParts[i] <= groupSize)
+      {
+         seen += _frz.noParts[i];
+         i     = _frz.hot[i].skip;
+      }
+      else
+         i++;
+   }
+
+   ///
+   /// the top of the traversal is walked here, the pairs below
+   /// are left as tasks. ccLists[t * noOwners + o] holds the
+   /// interactions thread t found for owner o.
+   ///
+   std::vector<interVectT> ccLists(noOwners * noOwners);
+   std::vector<interVectT> ppLists(noOwners * noOwners);
+   idxPairVectT            tasks;
+
+   walkT top;
+   top.cc       = &ccLists[0];
+   top.pp       = &ppLists[0];
+   top.tasks    = &tasks;
+   top.taskSize = nop / (16 * noOwners);
+   if (noNodes > 0)
+      interactSelf(0, top);
+
+   ancIdx.resize(noOwners);
+   ancLoc.resize(noOwners);
+   ancCost.resize(noOwners);
+
+   const int noTasks = tasks.size();
+#pragma omp parallel num_threads(noOwners)
+   {
+#ifdef SPHLATCH_OPENMP
+      const int tid = omp_get_thread_num();
+      const int nth = omp_get_num_threads();
+#else
+      const int tid = 0;
+      const int nth = 1;
+#endif
+
+      for (int o = tid; o < noOwners; o += nth)
+      {
+         for (idxT i = bound[o]; i < bound[o + 1]; i++)
+         {
+            if (_frz.hot[i].isParticle)
+            {
+               partPhi[i] = 0.;
+               partAcc[i] = 0., 0., 0.;
+            }
+            else
+               loc[_frz.hot[i].cell].clear();
+            cost[i] = 0.;
+         }
+      }
+
+      walkT w;
+      w.cc       = &ccLists[tid * noOwners];
+      w.pp       = &ppLists[tid * noOwners];
+      w.tasks    = NULL;
+      w.taskSize = 0;
+#pragma omp for schedule(dynamic)
+      for (int k = 0; k < noTasks; k++)
+      {
+         if (tasks[k].first == tasks[k].second)
+            interactSelf(tasks[k].first, w);
+         else
+            interact(tasks[k].first, tasks[k].second, w);
+      }
+
+      ///
+      /// each owner evaluates the interactions of its nodes
+      ///
+      fType ownCost = 0.;
+      for (int o = tid; o < noOwners; o += nth)
+      {
+         for (int t = 0; t < noOwners; t++)
+         {
+            const interVectT& cc(ccLists[t * noOwners + o]);
+            const size_t      noCC = cc.size();
+            for (size_t k = 0; k < noCC; k++)
+               cellCell(cc[k].a, cc[k].b, cc[k].both);
+
+            const interVectT& pp(ppLists[t * noOwners + o]);
+            const size_t      noPP = pp.size();
+            for (size_t k = 0; k < noPP; k++)
+               partPart(pp[k].a, pp[k].b, pp[k].both);
+         }
+         for (idxT i = bound[o]; i < bound[o + 1]; i++)
+            ownCost += cost[i];
+      }
+#pragma omp atomic
+      totalCost += ownCost;
+#pragma omp barrier
+
+      ///
+      /// the ancestors of the first node of a range belong to
+      /// earlier ranges, their final expansions are taken before
+      /// their owners pass the expansions down in place
+      ///
+      for (int o = tid; o < noOwners; o += nth)
+         ancestors(o);
+#pragma omp barrier
+
+      for (int o = tid; o < noOwners; o += nth)
+         passDown(o);
+   }
+}
+
+///
+/// the self interaction of the node <_a>, a small node
+/// sums up its particles directly
+///
+template<typename _partT>
+void FMMWorker<_partT>::interactSelf(const idxT _a, walkT& _w) const
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   if (frz.noParts[_a] < 2)
+      return;
+
+   if (_w.tasks != NULL && frz.noParts[_a] <= _w.taskSize)
+   {
+      _w.tasks->push_back(std::make_pair(_a, _a));
+      return;
+   }
+
+   if (frz.noParts[_a] <= groupSize)
+   {
+      addInter(_w.pp, _a, _a);
+      return;
+   }
+
+   const idxT last = frz.hot[_a].skip;
+   for (idxT c = _a + 1; c < last; c = frz.hot[c].skip)
+   {
+      interactSelf(c, _w);
+      for (idxT d = frz.hot[c].skip; d < last; d = frz.hot[d].skip)
+         interact(c, d, _w);
+   }
+}
+
+///
+/// the mutual interaction of the disjoint nodes <_a> and <_b>. two
+/// particles are always summed up directly, so they are softened.
+///
+template<typename _partT>
+void FMMWorker<_partT>::interact(const idxT _a, const idxT _b,
+                                 walkT& _w) const
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   if (frz.noParts[_a] == 0 || frz.noParts[_b] == 0)
+      return;
+
+   if (_w.tasks != NULL &&
+       frz.noParts[_a] + frz.noParts[_b] <= _w.taskSize)
+   {
+      _w.tasks->push_back(std::make_pair(_a, _b));
+      return;
+   }
+
+   const BHTreeFrozen::hotNode& nodeA(frz.hot[_a]);
+   const BHTreeFrozen::hotNode& nodeB(frz.hot[_b]);
+
+   const fType   radA = radius(_a);
+   const fType   radB = radius(_b);
+   const vect3dT rvec = nodeA.com - nodeB.com;
+   const fType   rr   = dot(rvec, rvec);
+
+   if ((radA + radB) * (radA + radB) < theta * theta * rr &&
+       not (nodeA.isParticle && nodeB.isParticle))
+   {
+      addInter(_w.cc, _a, _b);
+      return;
+   }
+
+   const bool bigA = frz.noParts[_a] > groupSize;
+   const bool bigB = frz.noParts[_b] > groupSize;
+   if (not bigA && not bigB)
+   {
+      addInter(_w.pp, _a, _b);
+      return;
+   }
+
+   if (bigA && (not bigB || radA >= radB))
+   {
+      for (idxT c = _a + 1; c < nodeA.skip; c = frz.hot[c].skip)
+         interact(c, _b, _w);
+   }
+   else
+   {
+      for (idxT c = _b + 1; c < nodeB.skip; c = frz.hot[c].skip)
+         interact(_a, c, _w);
+   }
+}
+
+///
+/// put the interaction into the lists of the owners of the nodes
+///
+template<typename _partT>
+void FMMWorker<_partT>::addInter(interVectT* _lists, const idxT _a,
+                                 const idxT _b) const
+{
+   const int ownA = owner(_a);
+   const int ownB = owner(_b);
+
+   if (ownA == ownB)
+      _lists[ownA].push_back(interT(_a, _b, true));
+   else
+   {
+      _lists[ownA].push_back(interT(_a, _b, false));
+      _lists[ownB].push_back(interT(_b, _a, false));
+   }
+}
+
+///
+/// the monopole and quadrupole field of <_b> at <_a>
+/// and for <_both> the one of <_a> at <_b>
+///
+template<typename _partT>
+void FMMWorker<_partT>::cellCell(const idxT _a, const idxT _b,
+                                 const bool _both)
+{
+   ///
+   /// a cell-cell interaction costs about as much
+   /// as five particle-particle interactions
+   ///
+   const fType ccCost = 5.;
+
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const vect3dT rvec = frz.hot[_a].com - frz.hot[_b].com;
+   const fType   Or   = 1. / sqrt(dot(rvec, rvec));
+
+   addField(_a, rvec[0], rvec[1], rvec[2], Or, frz.hot[_b].m, quad(_b));
+   cost[_a] += ccCost;
+
+   if (_both)
+   {
+      addField(_b, -rvec[0], -rvec[1], -rvec[2], Or, frz.hot[_a].m,
+               quad(_a));
+      cost[_b] += ccCost;
+   }
+}
+
+///
+/// add the field of the mass <_m> and the quadrupole <_q> at the
+/// distance r = sink - source to the expansion of <_sink>, a particle
+/// only takes the potential and the field
+///
+template<typename _partT>
+void FMMWorker<_partT>::addField(const idxT _sink, const fType _rx,
+                                 const fType _ry, const fType _rz,
+                                 const fType _Or, const fType _m,
+                                 const BHTreeFrozen::quadNode& _q)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const fType rx = _rx, ry = _ry, rz = _rz, m = _m;
+   const fType Or  = _Or;
+   const fType Or2 = Or * Or;
+   const fType Or3 = Or * Or2;
+   const fType Or5 = Or3 * Or2;
+   const fType Or7 = Or5 * Or2;
+   const fType Or9 = Or7 * Or2;
+
+   const fType q1jrj   = _q.q11 * rx + _q.q12 * ry + _q.q13 * rz;
+   const fType q2jrj   = _q.q12 * rx + _q.q22 * ry + _q.q23 * rz;
+   const fType q3jrj   = _q.q13 * rx + _q.q23 * ry + _q.q33 * rz;
+   const fType qijrirj = q1jrj * rx + q2jrj * ry + q3jrj * rz;
+
+   const fType phi = -m * Or - 0.5 * qijrirj * Or5;
+   const fType cr  = -m * Or3 - 2.5 * qijrirj * Or7;
+
+   vect3dT acc;
+   acc = cr * rx + q1jrj * Or5,
+         cr * ry + q2jrj * Or5,
+         cr * rz + q3jrj * Or5;
+
+   if (frz.hot[_sink].isParticle)
+   {
+      partPhi[_sink] += phi;
+      partAcc[_sink] += acc;
+      return;
+   }
+
+   localExp& L(loc[frz.hot[_sink].cell]);
+   L.phi += phi;
+   L.acc += acc;
+
+   ///
+   /// d(acc_i)/d(r_j), the diagonal terms get cr, all terms get
+   /// crr * r_i * r_j and the quadrupole terms
+   ///
+   const fType crr = 3. * m * Or5 + 17.5 * qijrirj * Or9;
+   const fType cq  = -5. * Or7;
+
+   L.dadx[0] += cr + crr * rx * rx + _q.q11 * Or5 + cq * 2. * q1jrj * rx;
+   L.dadx[1] += cr + crr * ry * ry + _q.q22 * Or5 + cq * 2. * q2jrj * ry;
+   L.dadx[2] += cr + crr * rz * rz + _q.q33 * Or5 + cq * 2. * q3jrj * rz;
+   L.dadx[3] += crr * rx * ry + _q.q12 * Or5 + cq * (q1jrj * ry + q2jrj * rx);
+   L.dadx[4] += crr * rx * rz + _q.q13 * Or5 + cq * (q1jrj * rz + q3jrj * rx);
+   L.dadx[5] += crr * ry * rz + _q.q23 * Or5 + cq * (q2jrj * rz + q3jrj * ry);
+
+   ///
+   /// d2(acc_i)/d(r_j)d(r_k) of the monopole
+   ///
+   const fType c3  = 3. * m * Or5;
+   const fType c15 = -15. * m * Or7;
+
+   L.d2adx[0] += 3. * c3 * rx + c15 * rx * rx * rx;
+   L.d2adx[1] += 3. * c3 * ry + c15 * ry * ry * ry;
+   L.d2adx[2] += 3. * c3 * rz + c15 * rz * rz * rz;
+   L.d2adx[3] += c3 * ry + c15 * rx * rx * ry;
+   L.d2adx[4] += c3 * rz + c15 * rx * rx * rz;
+   L.d2adx[5] += c3 * rx + c15 * rx * ry * ry;
+   L.d2adx[6] += c3 * rz + c15 * ry * ry * rz;
+   L.d2adx[7] += c3 * rx + c15 * rx * rz * rz;
+   L.d2adx[8] += c3 * ry + c15 * ry * rz * rz;
+   L.d2adx[9] += c15 * rx * ry * rz;
+}
+
+///
+/// the direct sum between the particles of <_a> and <_b>,
+/// for <_a> equal to <_b> between the particles of <_a>
+///
+template<typename _partT>
+void FMMWorker<_partT>::partPart(const idxT _a, const idxT _b,
+                                 const bool _both)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const idxT lastA = frz.hot[_a].skip;
+   const idxT lastB = frz.hot[_b].skip;
+
+   if (_a == _b)
+   {
+      for (idxT i = _a; i < lastA; i++)
+      {
+         if (frz.hot[i].isParticle)
+            for (idxT j = i + 1; j < lastA; j++)
+               if (frz.hot[j].isParticle)
+                  partPair(i, j, true);
+      }
+      cost[_a] += static_cast<fType>(frz.noParts[_a]) *
+                  (frz.noParts[_a] - 1);
+      return;
+   }
+
+   for (idxT i = _a; i < lastA; i++)
+   {
+      if (frz.hot[i].isParticle)
+         for (idxT j = _b; j < lastB; j++)
+            if (frz.hot[j].isParticle)
+               partPair(i, j, _both);
+   }
+
+   const fType noPairs = static_cast<fType>(frz.noParts[_a]) *
+                         frz.noParts[_b];
+   cost[_a] += noPairs;
+   if (_both)
+      cost[_b] += noPairs;
+}
+
+///
+/// the softened interaction of the particle nodes <_i> and <_j>,
+/// each one is softened by the softening length of the source
+///
+template<typename _partT>
+void FMMWorker<_partT>::partPair(const idxT _i, const idxT _j,
+                                 const bool _both)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const vect3dT rvec = frz.hot[_i].com - frz.hot[_j].com;
+   const fType   rr   = dot(rvec, rvec);
+   if (rr == 0.)
+      return;
+   const fType r  = sqrt(rr);
+   const fType hj = softening(_j);
+
+   partAcc[_i] -= (frz.hot[_j].m *
+                   gravSoftening::OsmoR3(gravScalar(r), gravScalar(rr),
+                                         gravScalar(hj),
+                                         gravScalar(invSoftening(hj))).v) *
+                  rvec;
+   partPhi[_i] -= frz.hot[_j].m *
+                  gravSoftening::OsmoR1(gravScalar(r), gravScalar(rr),
+                                        gravScalar(hj),
+                                        gravScalar(invSoftening(hj))).v;
+
+   if (_both)
+   {
+      const fType hi = softening(_i);
+      partAcc[_j] += (frz.hot[_i].m *
+                      gravSoftening::OsmoR3(gravScalar(r), gravScalar(rr),
+                                            gravScalar(hi),
+                                            gravScalar(invSoftening(hi))).v) *
+                     rvec;
+      partPhi[_j] -= frz.hot[_i].m *
+                     gravSoftening::OsmoR1(gravScalar(r), gravScalar(rr),
+                                           gravScalar(hi),
+                                           gravScalar(invSoftening(hi))).v;
+   }
+}
+
+///
+/// the final expansions of the ancestors of the first node of the
+/// range of <_own>, from the root downwards. the cost of a node is
+/// spread over its particles.
+///
+template<typename _partT>
+void FMMWorker<_partT>::ancestors(const int _own)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   std::vector<idxT>&     idx(ancIdx[_own]);
+   std::vector<localExp>& L(ancLoc[_own]);
+   std::vector<fType>&    c(ancCost[_own]);
+
+   idx.clear();
+   if (bound[_own] < bound[_own + 1])
+      for (idxT p = frz.parent[bound[_own]]; p != BHTreeFrozen::nil;
+           p = frz.parent[p])
+         idx.push_back(p);
+   std::reverse(idx.begin(), idx.end());
+
+   const size_t noAnc = idx.size();
+   L.resize(noAnc);
+   c.resize(noAnc);
+   for (size_t k = 0; k < noAnc; k++)
+   {
+      const idxT i = idx[k];
+      if (frz.noParts[i] == 0)
+      {
+         idx.resize(k);
+         break;
+      }
+      L[k] = loc[frz.hot[i].cell];
+      c[k] = cost[i] / frz.noParts[i];
+      if (k > 0)
+      {
+         shift(L[k - 1], frz.hot[i].com - frz.hot[idx[k - 1]].com,
+               L[k].phi, L[k].acc, &L[k]);
+         c[k] += c[k - 1];
+      }
+   }
+}
+
+///
+/// shift the local expansions of the range of <_own> down to the
+/// particles, the parent of a node always comes before the node
+///
+template<typename _partT>
+void FMMWorker<_partT>::passDown(const int _own)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const std::vector<idxT>& idx(ancIdx[_own]);
+   const idxT               frst = bound[_own];
+   const idxT               last = bound[_own + 1];
+
+   for (idxT i = frst; i < last; i++)
+   {
+      if (frz.noParts[i] == 0)
+         continue;
+
+      const idxT par = frz.parent[i];
+      cost[i] /= frz.noParts[i];
+      if (par == BHTreeFrozen::nil)
+         continue;
+
+      const localExp* P;
+      if (par >= frst)
+      {
+         P        = &loc[frz.hot[par].cell];
+         cost[i] += cost[par];
+      }
+      else
+      {
+         const size_t k = std::find(idx.begin(), idx.end(), par) -
+                          idx.begin();
+         P        = &ancLoc[_own][k];
+         cost[i] += ancCost[_own][k];
+      }
+
+      const vect3dT s = frz.hot[i].com - frz.hot[par].com;
+      if (frz.hot[i].isParticle)
+         shift(*P, s, partPhi[i], partAcc[i], NULL);
+      else
+      {
+         localExp& L(loc[frz.hot[i].cell]);
+         shift(*P, s, L.phi, L.acc, &L);
+      }
+   }
+}
+
+///
+/// add the expansion <_P> shifted by <_s> to the potential <_phi> and
+/// the field <_acc>, and to the derivatives of <_L> if there is one
+///
+template<typename _partT>
+void FMMWorker<_partT>::shift(const localExp& _P, const vect3dT& _s,
+                              fType& _phi, vect3dT& _acc, localExp* _L)
+{
+   const vect3dT& s(_s);
+   const fType*   D = _P.dadx;
+   const fType*   T = _P.d2adx;
+
+   fType Ts[6];
+   Ts[0] = T[0] * s[0] + T[3] * s[1] + T[4] * s[2];
+   Ts[1] = T[5] * s[0] + T[1] * s[1] + T[6] * s[2];
+   Ts[2] = T[7] * s[0] + T[8] * s[1] + T[2] * s[2];
+   Ts[3] = T[3] * s[0] + T[5] * s[1] + T[9] * s[2];
+   Ts[4] = T[4] * s[0] + T[9] * s[1] + T[7] * s[2];
+   Ts[5] = T[9] * s[0] + T[6] * s[1] + T[8] * s[2];
+
+   vect3dT Ds, Tss;
+   Ds = D[0] * s[0] + D[3] * s[1] + D[4] * s[2],
+        D[3] * s[0] + D[1] * s[1] + D[5] * s[2],
+        D[4] * s[0] + D[5] * s[1] + D[2] * s[2];
+   Tss = Ts[0] * s[0] + Ts[3] * s[1] + Ts[4] * s[2],
+         Ts[3] * s[0] + Ts[1] * s[1] + Ts[5] * s[2],
+         Ts[4] * s[0] + Ts[5] * s[1] + Ts[2] * s[2];
+
+   _phi += _P.phi - dot(_P.acc, s) - 0.5 * dot(s, Ds) - dot(s, Tss) / 6.;
+   _acc += _P.acc + Ds + 0.5 * Tss;
+
+   if (_L != NULL)
+   {
+      for (size_t k = 0; k < 6; k++)
+         _L->dadx[k] += D[k] + Ts[k];
+      for (size_t k = 0; k < 10; k++)
+         _L->d2adx[k] += T[k];
+   }
+}
+
+///
+/// the owner of the node <_i>
+///
+template<typename _partT>
+int FMMWorker<_partT>::owner(const idxT _i) const
+{
+   return(std::upper_bound(bound.begin(), bound.begin() + noOwners, _i) -
+          bound.begin() - 1);
+}
+
+///
+/// the sphere around the center of mass containing
+/// the particles of the node
+///
+template<typename _partT>
+fType FMMWorker<_partT>::radius(const idxT _i) const
+{
+   const BHTreeFrozen& frz(*frzPtr);
+   return(frz.hot[_i].isParticle ? 0. : frz.rmax[frz.hot[_i].cell]);
+}
+
+#ifdef SPHLATCH_GRAVITY_SPLINESMOOTHING
+template<typename _partT>
+fType FMMWorker<_partT>::softening(const idxT _i) const
+{
+   return(static_cast<_partT*>(frzPtr->part[_i])->h);
+}
+#elif defined SPHLATCH_GRAVITY_EPSSMOOTHING
+template<typename _partT>
+fType FMMWorker<_partT>::softening(const idxT _i) const
+{
+   return(static_cast<_partT*>(frzPtr->part[_i])->eps);
+}
+#else
+template<typename _partT>
+fType FMMWorker<_partT>::softening(const idxT) const
+{
+   return(0.);
+}
+#endif
+
+///
+/// the quadrupole of a node, particles have none
+///
+template<typename _partT>
+const BHTreeFrozen::quadNode& FMMWorker<_partT>::quad(const idxT _i) const
+{
+   static const BHTreeFrozen::quadNode quadZero = { 0., 0., 0., 0., 0., 0. };
+
+   const BHTreeFrozen& frz(*frzPtr);
+   return(frz.hot[_i].isParticle ? quadZero : frz.quad[frz.hot[_i].cell]);
+}
+};
+
+#endif
@@ -9,55 +9,182 @@
  *
  */
 
+#include <cmath>
+#include <limits>
+
 #include "bhtree_worker.cpp"
 #include "bhtree.h"
+#include "bhtree_grav_kernels.cpp"
+#include "bhtree_grav_multipoles.cpp"
 #include "timer.cpp"
 
 namespace sphlatch {
-template<typename _macT, typename _partT>
+///
+/// the interaction lists of the grouped walks are stored in the
+/// precision <_realT>. with float the kernels run on twice as many
+/// vector lanes, the sums are still added up in double. the frozen
+/// tree walked to fill the lists stays in double.
+///
+template<typename _macT, typename _partT, typename _mpT = quadrupoles,
+         typename _realT = fType>
 class GravityWorker : public BHTreeWorker {
 public:
    GravityWorker(const treePtrT _treePtr,
-                 const fType    _G) : BHTreeWorker(_treePtr), G(_G) { }
-   GravityWorker(const GravityWorker& _gw) : BHTreeWorker(_gw), G(_gw.G) { }
+                 const fType    _G) : BHTreeWorker(_treePtr), frzPtr(NULL),
+      G(_G), groupSize(1) { }
+   GravityWorker(const treePtrT _treePtr,
+                 const fType    _G,
+                 const _macT&   _MAC) : BHTreeWorker(_treePtr), MAC(_MAC),
+      frzPtr(NULL), G(_G), groupSize(1) { }
+   GravityWorker(const GravityWorker& _gw) : BHTreeWorker(_gw),
+      MAC(_gw.MAC), frzPtr(_gw.frzPtr), G(_gw.G), groupSize(_gw.groupSize) { }
    ~GravityWorker() { }
 
-   void calcAcc(const czllPtrT _czll);
+   ///
+   /// on the frozen tree, particles in cells with at most <groupSize>
+   /// particles share one walk and its interaction lists. a group size
+   /// of 1 walks the tree once for every particle. the groups evaluate
+   /// more interactions per particle, so they only gain with the SIMD
+   /// kernels (see tests/dynamic_tree/frozenWalk).
+   ///
+   void setGroupSize(const size_t _groupSize);
+   size_t getGroupSize() const;
+
+   ///
+   /// with <_withPot> the potential is summed up in the same walk
+   /// as the acceleration (needs SPHLATCH_GRAVITY_POTENTIAL), calcPot()
+   /// walks for the potential only
+   ///
+   void calcAcc(const czllPtrT _czll, const bool _withPot = false);
    void calcPot(const czllPtrT _czll);
+
+   ///
+   /// the potential of the particles below node <_idx> of the frozen
+   /// tree <_frz> due to the particles of <_frz> alone. with a subset
+   /// tree (see BHTreeFrozen::setSubset()) only the members walk and
+   /// only their masses contribute, the walks can be split up over
+   /// the nodes of BHTreeFrozen::getCover().
+   ///
+   void calcPot(const BHTreeFrozen& _frz, const BHTreeFrozen::idxT _idx);
    
-   void calcAccPart(const pnodPtrT _part);
+   void calcAccPart(const pnodPtrT _part, const bool _withPot = false);
    void calcPotPart(const pnodPtrT _part);
    void calcAccPartRec(const pnodPtrT _part);
+
+   typedef BHTreeFrozen::idxT   idxT;
+
+   void calcAccFrozen(const idxT _i, const bool _withPot = false);
+   void calcPotFrozen(const idxT _i);
+   void calcAccGroup(const idxT _g, const bool _withPot = false);
+   void calcPotGroup(const idxT _g);
    
    typedef sphlatch::Timer   timerT;
-   
-   fType splineOSmoR1(const fType _r, const fType _h);
-   fType splineOSmoR3(const fType _r, const fType _h);
 
 private:
    _macT  MAC;
    timerT Timer;
 
-   void calcAccRec();
+   ///
+   /// the frozen tree of the current walks
+   ///
+   const BHTreeFrozen* frzPtr;
 
-   void accPC();
-   void accPP();
+   void calcAccRec();
+   void calcPotRange(const idxT _frst, const idxT _last);
+   void buildGroupLists(const idxT _g);
+   fType softening(const treeghoPtrT _part);
+
+   template<typename _qT>
+   void accPC(const fType _m, const _qT& _q);
+   template<typename _qT>
+   void accPC(const vect3dT& _r, const fType _rr,
+              const fType _m, const _qT& _q);
+   void accPP(const vect3dT& _pos, const fType _m, const treeghoPtrT _part);
    
-   void potPC();
-   void potPP();
+   template<typename _qT>
+   void potPC(const fType _m, const _qT& _q);
+   template<typename _qT>
+   void potPC(const vect3dT& _r, const fType _rr,
+              const fType _m, const _qT& _q);
+   void potPP(const vect3dT& _pos, const fType _m, const treeghoPtrT _part);
 
    vect3dT  acc, ppos;
    fType pot;
    nodePtrT recCurPartPtr;
 
+   ///
+   /// the members of the current group, the cells and
+   /// the particles interacting with the group
+   ///
+   typedef std::vector<idxT>   idxVectT;
+   idxVectT               grpList;
+   gravCellBuffer<_realT> pcList;
+   gravPartBuffer<_realT> ppList;
+
+   gravMPBuffer<_realT>   mpList;
+
 protected:
    const fType G;
+   size_t      groupSize;
 };
 
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::setGroupSize(const size_t _groupSize)
+{
+   groupSize = _groupSize > 0 ? _groupSize : 1;
+}
+
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+size_t GravityWorker<_macT, _partT, _mpT, _realT>::getGroupSize() const
+{
+   return(groupSize);
+}
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::calcAcc(const czllPtrT _czll)
+
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcAcc(const czllPtrT _czll,
+                                                         const bool     _withPot)
 {
+   if (treePtr->isFrozen())
+   {
+      frzPtr = &(treePtr->getFrozen());
+
+      const BHTreeFrozen& frz(*frzPtr);
+      const idxT          frst = _czll->frozenIdx + 1;
+      const idxT          last = frz.hot[_czll->frozenIdx].skip;
+      assert(frz.mpOrder >= _mpT::order);
+
+      Timer.start();
+      if (groupSize > 1)
+      {
+         idxT i = frst;
+         while (i < last)
+         {
+            if (frz.noParts[i] > groupSize)
+               i++;
+            else
+            {
+               if (frz.hot[i].isParticle)
+                  calcAccFrozen(i, _withPot);
+               else if (frz.noParts[i] > 0)
+                  calcAccGroup(i, _withPot);
+               i = frz.hot[i].skip;
+            }
+         }
+      }
+      else
+      {
+         for (idxT i = frst; i < last; i++)
+         {
+            if (frz.hot[i].isParticle)
+               calcAccFrozen(i, _withPot);
+         }
+      }
+      const double compTime = Timer.getRoundTime();
+      _czll->compTime += static_cast<fType>(compTime);
+      return;
+   }
+
    nodePtrT       curPart  = _czll->chldFrst;
    const nodePtrT stopChld = _czll->chldLast->next;
 
@@ -69,7 +196,7 @@ void GravityWorker<_macT, _partT>::calcAcc(const czllPtrT _czll)
    while (curPart != stopChld)
    {
       if (curPart->isParticle)
-         calcAccPart(static_cast<pnodPtrT>(curPart));
+         calcAccPart(static_cast<pnodPtrT>(curPart), _withPot);
       curPart = curPart->next;
    }
    const double compTime = Timer.getRoundTime();
@@ -77,9 +204,20 @@ void GravityWorker<_macT, _partT>::calcAcc(const czllPtrT _czll)
 }
 
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::calcPot(const czllPtrT _czll)
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcPot(const czllPtrT _czll)
 {
+   if (treePtr->isFrozen())
+   {
+      frzPtr = &(treePtr->getFrozen());
+
+      Timer.start();
+      calcPotRange(_czll->frozenIdx + 1, frzPtr->hot[_czll->frozenIdx].skip);
+      const double compTime = Timer.getRoundTime();
+      _czll->compTime += static_cast<fType>(compTime);
+      return;
+   }
+
    nodePtrT       curPart  = _czll->chldFrst;
    const nodePtrT stopChld = _czll->chldLast->next;
 
@@ -99,13 +237,65 @@ void GravityWorker<_macT, _partT>::calcPot(const czllPtrT _czll)
 }
 
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::calcAccPart(const pnodPtrT _part)
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcPot(const BHTreeFrozen& _frz,
+                                                         const idxT          _idx)
+{
+   frzPtr = &_frz;
+   calcPotRange(_idx, _frz.hot[_idx].skip);
+}
+
+///
+/// the potential walks for the particles in the nodes [_frst,_last)
+/// of the current frozen tree
+///
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcPotRange(const idxT _frst,
+                                                              const idxT _last)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+   assert(frz.mpOrder >= _mpT::order);
+
+   if (groupSize > 1)
+   {
+      idxT i = _frst;
+      while (i < _last)
+      {
+         if (frz.noParts[i] > groupSize)
+            i++;
+         else
+         {
+            if (frz.hot[i].isParticle)
+               calcPotFrozen(i);
+            else if (frz.noParts[i] > 0)
+               calcPotGroup(i);
+            i = frz.hot[i].skip;
+         }
+      }
+   }
+   else
+   {
+      for (idxT i = _frst; i < _last; i++)
+      {
+         if (frz.hot[i].isParticle)
+            calcPotFrozen(i);
+      }
+   }
+}
+
+
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcAccPart(const pnodPtrT _part,
+                                                             const bool     _withPot)
 {
    nodePtrT const curPartPtr = _part;
 
    ppos = _part->pos;
    acc  = 0., 0., 0.;
+   pot  = 0.;
+
+   MAC.clearSink();
+   MAC.addSink(*static_cast<_partT*>(_part));
 
    ///
    /// the complete tree walk
@@ -118,7 +308,11 @@ void GravityWorker<_macT, _partT>::calcAccPart(const pnodPtrT _part)
          if (MAC(static_cast<qcllPtrT>(curPtr),
                  static_cast<pnodPtrT>(curPartPtr)))
          {
-            accPC();
+            accPC(static_cast<qcllPtrT>(curPtr)->m,
+                  *static_cast<qcllPtrT>(curPtr));
+            if (_withPot)
+               potPC(static_cast<qcllPtrT>(curPtr)->m,
+                     *static_cast<qcllPtrT>(curPtr));
             goSkip();
          }
          else
@@ -130,24 +324,37 @@ void GravityWorker<_macT, _partT>::calcAccPart(const pnodPtrT _part)
       {
          if (curPtr != curPartPtr)
          {
-            accPP();
+            accPP(static_cast<pnodPtrT>(curPtr)->pos,
+                  static_cast<pnodPtrT>(curPtr)->m,
+                  static_cast<treeghoPtrT>(curPtr));
+            if (_withPot)
+               potPP(static_cast<pnodPtrT>(curPtr)->pos,
+                     static_cast<pnodPtrT>(curPtr)->m,
+                     static_cast<treeghoPtrT>(curPtr));
          }
          goNext();
       }
    } while (curPtr != NULL);
 
-   static_cast<_partT*>(_part->partPtr)->acc += G * acc;
+   static_cast<_partT*>(_part)->acc += G * acc;
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+   if (_withPot)
+      static_cast<_partT*>(_part)->pot = G * pot;
+#endif
 }
 
   
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::calcPotPart(const pnodPtrT _part)
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcPotPart(const pnodPtrT _part)
 {
    nodePtrT const curPartPtr = _part;
 
    ppos = _part->pos;
    pot  = 0.;
 
+   MAC.clearSink();
+   MAC.addSink(*static_cast<_partT*>(_part));
+
    ///
    /// the complete tree walk
    ///
@@ -159,7 +366,8 @@ void GravityWorker<_macT, _partT>::calcPotPart(const pnodPtrT _part)
          if (MAC(static_cast<qcllPtrT>(curPtr),
                  static_cast<pnodPtrT>(curPartPtr)))
          {
-            potPC();
+            potPC(static_cast<qcllPtrT>(curPtr)->m,
+                  *static_cast<qcllPtrT>(curPtr));
             goSkip();
          }
          else
@@ -171,46 +379,355 @@ void GravityWorker<_macT, _partT>::calcPotPart(const pnodPtrT _part)
       {
          if (curPtr != curPartPtr)
          {
-            potPP();
+            potPP(static_cast<pnodPtrT>(curPtr)->pos,
+                  static_cast<pnodPtrT>(curPtr)->m,
+                  static_cast<treeghoPtrT>(curPtr));
          }
          goNext();
       }
    } while (curPtr != NULL);
 
-   static_cast<_partT*>(_part->partPtr)->pot = G * pot;
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+   static_cast<_partT*>(_part)->pot = G * pot;
+#endif
+}
+
+
+///
+/// the walks on the frozen tree, the next node
+/// is always the following array element
+///
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcAccFrozen(const idxT _i,
+                                                               const bool _withPot)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const BHTreeFrozen::hotNode* const  hot  = &frz.hot[0];
+   const BHTreeFrozen::quadNode* const quad = &frz.quad[0];
+   const idxT noNodes = frz.size();
+
+   ppos = hot[_i].com;
+   acc  = 0., 0., 0.;
+   pot  = 0.;
+
+   MAC.clearSink();
+   MAC.addSink(*static_cast<_partT*>(frz.part[_i]));
+
+   idxT cur = 0;
+   while (cur < noNodes)
+   {
+      const BHTreeFrozen::hotNode& node(hot[cur]);
+      if (not node.isParticle)
+      {
+         if (MAC(frz, cur, ppos))
+         {
+            accPC(node.m, quad[node.cell]);
+            if (_withPot)
+               potPC(node.m, quad[node.cell]);
+            if (_mpT::order > 2)
+            {
+               vect3dT r;
+               r = MAC.rx, MAC.ry, MAC.rz;
+               _mpT::addAcc(frz, cur, r, MAC.rr, acc);
+               if (_withPot)
+                  _mpT::addPot(frz, cur, r, MAC.rr, pot);
+            }
+            cur = node.skip;
+         }
+         else
+            cur++;
+      }
+      else
+      {
+         if (cur != _i)
+         {
+            accPP(node.com, node.m, frz.part[cur]);
+            if (_withPot)
+               potPP(node.com, node.m, frz.part[cur]);
+         }
+         cur++;
+      }
+   }
+
+   static_cast<_partT*>(frz.part[_i])->acc += G * acc;
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+   if (_withPot)
+      static_cast<_partT*>(frz.part[_i])->pot = G * pot;
+#endif
 }
 
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcPotFrozen(const idxT _i)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const BHTreeFrozen::hotNode* const  hot  = &frz.hot[0];
+   const BHTreeFrozen::quadNode* const quad = &frz.quad[0];
+   const idxT noNodes = frz.size();
+
+   ppos = hot[_i].com;
+   pot  = 0.;
+
+   MAC.clearSink();
+   MAC.addSink(*static_cast<_partT*>(frz.part[_i]));
+
+   idxT cur = 0;
+   while (cur < noNodes)
+   {
+      const BHTreeFrozen::hotNode& node(hot[cur]);
+      if (not node.isParticle)
+      {
+         if (MAC(frz, cur, ppos))
+         {
+            potPC(node.m, quad[node.cell]);
+            if (_mpT::order > 2)
+            {
+               vect3dT r;
+               r = MAC.rx, MAC.ry, MAC.rz;
+               _mpT::addPot(frz, cur, r, MAC.rr, pot);
+            }
+            cur = node.skip;
+         }
+         else
+            cur++;
+      }
+      else
+      {
+         if (cur != _i)
+            potPP(node.com, node.m, frz.part[cur]);
+         cur++;
+      }
+   }
+
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+   static_cast<_partT*>(frz.part[_i])->pot = G * pot;
+#endif
+}
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::calcAccPartRec(const pnodPtrT _part)
+///
+/// the grouped walks: the tree is walked once for all particles below
+/// the cell <_g>, using the MAC for the bounding sphere of the group.
+/// the accepted cells and the particles of the opened cells, including
+/// those of the group itself, are then summed up for every member.
+///
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::buildGroupLists(const idxT _g)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   const BHTreeFrozen::hotNode* const hot = &frz.hot[0];
+   const idxT noNodes = frz.size();
+   const idxT gFrst   = _g;
+   const idxT gLast   = hot[_g].skip;
+
+   ///
+   /// collect the members and their bounding sphere
+   ///
+   grpList.clear();
+   MAC.clearSink();
+   vect3dT gmin = hot[_g].com, gmax = hot[_g].com;
+   for (idxT i = gFrst; i < gLast; i++)
+   {
+      if (hot[i].isParticle)
+      {
+         grpList.push_back(i);
+         MAC.addSink(*static_cast<_partT*>(frz.part[i]));
+         const vect3dT& pos(hot[i].com);
+         for (size_t j = 0; j < 3; j++)
+         {
+            gmin[j] = pos[j] < gmin[j] ? pos[j] : gmin[j];
+            gmax[j] = pos[j] > gmax[j] ? pos[j] : gmax[j];
+         }
+      }
+   }
+   const vect3dT gcen = 0.5 * (gmin + gmax);
+   const vect3dT gext = gmax - gcen;
+   const fType   grad = sqrt(dot(gext, gext));
+
+   ///
+   /// walk the tree for the group, the cells containing
+   /// the group are always opened
+   ///
+   pcList.clear();
+   ppList.clear();
+   mpList.clear(_mpT::order);
+
+   ///
+   /// the lists are stored relative to the group center, the lengths
+   /// in units of the geometric mean of the group and the root cell
+   /// sizes. this centers the range of the distances of the near and
+   /// the far sources around 1.
+   ///
+   const fType len  = sqrt(hot[_g].clSz * hot[0].clSz);
+   const fType mass = hot[0].m > 0. ? hot[0].m : 1.;
+   pcList.setFrame(gcen, len, mass);
+   ppList.setFrame(gcen, len, mass);
+   mpList.setFrame(gcen, len, mass);
+
+   const BHTreeFrozen::quadNode* const quad = &frz.quad[0];
+
+   idxT cur = 0;
+   while (cur < noNodes)
+   {
+      const BHTreeFrozen::hotNode& node(hot[cur]);
+      if (cur == gFrst)
+      {
+         const size_t noMembers = grpList.size();
+         for (size_t k = 0; k < noMembers; k++)
+         {
+            const idxT i = grpList[k];
+            ppList.push(hot[i].com, hot[i].m, softening(frz.part[i]));
+         }
+         cur = gLast;
+      }
+      else if (not node.isParticle)
+      {
+         if (not (cur < gFrst && node.skip >= gLast) &&
+             MAC(frz, cur, gcen, grad))
+         {
+            pcList.push(node.com, node.m, quad[node.cell]);
+            _mpT::push(mpList, frz, cur);
+            cur = node.skip;
+         }
+         else
+            cur++;
+      }
+      else
+      {
+         ppList.push(node.com, node.m, softening(frz.part[cur]));
+         cur++;
+      }
+   }
+}
+
+///
+/// the sources of a group are summed up with the batched kernels,
+/// the zero distance of a member to itself is left out by them
+///
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcAccGroup(const idxT _g,
+                                                              const bool _withPot)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   buildGroupLists(_g);
+
+   const size_t noMembers = grpList.size();
+   for (size_t k = 0; k < noMembers; k++)
+   {
+      const idxT i = grpList[k];
+
+      ppos = frz.hot[i].com;
+      acc  = 0., 0., 0.;
+
+      GravityKernels::accPC(pcList, ppos, acc);
+      if (_mpT::order > 2)
+         GravityKernels::accMP(mpList, ppos, acc);
+      GravityKernels::accPP(ppList, ppos, acc);
+
+      static_cast<_partT*>(frz.part[i])->acc += G * acc;
+
+      if (_withPot)
+      {
+         pot = 0.;
+         GravityKernels::potPC(pcList, ppos, pot);
+         if (_mpT::order > 2)
+            GravityKernels::potMP(mpList, ppos, pot);
+         GravityKernels::potPP(ppList, ppos, pot);
+
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+         static_cast<_partT*>(frz.part[i])->pot = G * pot;
+#endif
+      }
+   }
+}
+
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcPotGroup(const idxT _g)
+{
+   const BHTreeFrozen& frz(*frzPtr);
+
+   buildGroupLists(_g);
+
+   const size_t noMembers = grpList.size();
+   for (size_t k = 0; k < noMembers; k++)
+   {
+      const idxT i = grpList[k];
+
+      ppos = frz.hot[i].com;
+      pot  = 0.;
+
+      GravityKernels::potPC(pcList, ppos, pot);
+      if (_mpT::order > 2)
+         GravityKernels::potMP(mpList, ppos, pot);
+      GravityKernels::potPP(ppList, ppos, pot);
+
+#ifdef SPHLATCH_GRAVITY_POTENTIAL
+      static_cast<_partT*>(frz.part[i])->pot = G * pot;
+#endif
+   }
+}
+
+///
+/// the softening length of a source particle
+///
+#ifdef SPHLATCH_GRAVITY_SPLINESMOOTHING
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+fType GravityWorker<_macT, _partT, _mpT, _realT>::softening(const treeghoPtrT _part)
+{
+   return(static_cast<_partT*>(_part)->h);
+}
+#elif defined SPHLATCH_GRAVITY_EPSSMOOTHING
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+fType GravityWorker<_macT, _partT, _mpT, _realT>::softening(const treeghoPtrT _part)
+{
+   return(static_cast<_partT*>(_part)->eps);
+}
+#else
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+fType GravityWorker<_macT, _partT, _mpT, _realT>::softening(const treeghoPtrT)
+{
+   return(0.);
+}
+#endif
+
+
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcAccPartRec(const pnodPtrT _part)
 {
    ppos          = _part->pos;
    acc           = 0, 0, 0;
    recCurPartPtr = _part;
+   MAC.clearSink();
+   MAC.addSink(*static_cast<_partT*>(_part));
    ///
    /// the complete tree walk
    ///
    goRoot();
    calcAccRec();
 
-   static_cast<_partT*>(_part->partPtr)->acc += G * acc;
+   static_cast<_partT*>(_part)->acc += G * acc;
 }
 
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::calcAccRec()
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::calcAccRec()
 {
    if (curPtr->isParticle)
    {
       if (curPtr != recCurPartPtr)
-         accPP();
+         accPP(static_cast<pnodPtrT>(curPtr)->pos,
+               static_cast<pnodPtrT>(curPtr)->m,
+               static_cast<treeghoPtrT>(curPtr));
    }
    else
    {
       if (MAC(static_cast<qcllPtrT>(curPtr),
               static_cast<pnodPtrT>(recCurPartPtr)))
       {
-         accPC();
+         accPC(static_cast<qcllPtrT>(curPtr)->m,
+               *static_cast<qcllPtrT>(curPtr));
       }
       else
       {
@@ -227,79 +744,74 @@ void GravityWorker<_macT, _partT>::calcAccRec()
    }
 }
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::accPP()
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::accPP(const vect3dT&    _pos,
+                                                 const fType       _m,
+                                                 const treeghoPtrT _part)
 {
    //FIXME: try using blitz++ functions
-   const fType rx = ppos[0] - static_cast<pnodPtrT>(curPtr)->pos[0];
-   const fType ry = ppos[1] - static_cast<pnodPtrT>(curPtr)->pos[1];
-   const fType rz = ppos[2] - static_cast<pnodPtrT>(curPtr)->pos[2];
-   const fType m  = static_cast<pnodPtrT>(curPtr)->m;
+   const fType rx = ppos[0] - _pos[0];
+   const fType ry = ppos[1] - _pos[1];
+   const fType rz = ppos[2] - _pos[2];
+   const fType m  = _m;
    const fType rr = rx * rx + ry * ry + rz * rz;
    const fType r  = sqrt(rr);
+   const fType h  = softening(_part);
 
-#ifdef SPHLATCH_GRAVITY_SPLINESMOOTHING
-   const fType h =
-      static_cast<_partT*>(static_cast<pnodPtrT>(curPtr)->partPtr)->h;
-   const fType mOr3 = m * splineOSmoR3(r, h);
-#elif SPHLATCH_GRAVITY_EPSSMOOTHING
-   const fType eps =
-      static_cast<_partT*>(static_cast<pnodPtrT>(curPtr)->partPtr)->eps;
-   const fType re   = r + eps;
-   const fType mOr3 = m / (re * re * re);
-#else
-   const fType mOr3 = m / (rr * r);
-#endif
+   const fType mOr3 = m * gravSoftening::OsmoR3(gravScalar(r), gravScalar(rr),
+                                                gravScalar(h),
+                                                gravScalar(invSoftening(h))).v;
 
    acc[0] -= mOr3 * rx;
    acc[1] -= mOr3 * ry;
    acc[2] -= mOr3 * rz;
 }
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::potPP()
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::potPP(const vect3dT&    _pos,
+                                                 const fType       _m,
+                                                 const treeghoPtrT _part)
 {
    //FIXME: try using blitz++ functions
-   const fType rx = ppos[0] - static_cast<pnodPtrT>(curPtr)->pos[0];
-   const fType ry = ppos[1] - static_cast<pnodPtrT>(curPtr)->pos[1];
-   const fType rz = ppos[2] - static_cast<pnodPtrT>(curPtr)->pos[2];
+   const fType rx = ppos[0] - _pos[0];
+   const fType ry = ppos[1] - _pos[1];
+   const fType rz = ppos[2] - _pos[2];
    
-   const fType m  = static_cast<pnodPtrT>(curPtr)->m;
+   const fType m  = _m;
    const fType rr = rx * rx + ry * ry + rz * rz;
    const fType r  = sqrt(rr);
+   const fType h  = softening(_part);
 
-#ifdef SPHLATCH_GRAVITY_SPLINESMOOTHING
-   const fType h =
-      static_cast<_partT*>(static_cast<pnodPtrT>(curPtr)->partPtr)->h;
-#elif SPHLATCH_GRAVITY_EPSSMOOTHING
-   const fType eps =
-      static_cast<_partT*>(static_cast<pnodPtrT>(curPtr)->partPtr)->eps;
-   const fType re   = r + eps;
-#endif
-
- #ifdef SPHLATCH_GRAVITY_SPLINESMOOTHING
-   pot -= m * splineOSmoR1(r, h);
- #elif SPHLATCH_GRAVITY_EPSSMOOTHING
-   pot -= m / re;
- #else
-   pot -= m / r;
- #endif
+   pot -= m * gravSoftening::OsmoR1(gravScalar(r), gravScalar(rr),
+                                    gravScalar(h),
+                                    gravScalar(invSoftening(h))).v;
 }
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::accPC()
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+template<typename _qT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::accPC(const fType _m, const _qT& _q)
 {
    //FIXME: check if fetching those values again is less costly
-   const fType rx = MAC.rx;
-   const fType ry = MAC.ry;
-   const fType rz = MAC.rz;
+   vect3dT r;
+   r = MAC.rx, MAC.ry, MAC.rz;
+   accPC(r, MAC.rr, _m, _q);
+}
 
-   const fType rr = MAC.rr;
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+template<typename _qT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::accPC(const vect3dT& _r, const fType _rr,
+                                                 const fType _m, const _qT& _q)
+{
+   const fType rx = _r[0];
+   const fType ry = _r[1];
+   const fType rz = _r[2];
+
+   const fType rr = _rr;
    const fType r  = sqrt(rr);
 
    const fType Or3 = 1. / (r * rr);
 
-   const fType m = static_cast<qcllPtrT>(curPtr)->m;
+   const fType m = _m;
 
    acc[0] -= m * Or3 * rx;
    acc[1] -= m * Or3 * ry;
@@ -308,12 +820,12 @@ void GravityWorker<_macT, _partT>::accPC()
    const fType Or5 = Or3 / rr;
    const fType Or7 = Or5 / rr;
 
-   const fType q11 = static_cast<qcllPtrT>(curPtr)->q11;
-   const fType q22 = static_cast<qcllPtrT>(curPtr)->q22;
-   const fType q33 = static_cast<qcllPtrT>(curPtr)->q33;
-   const fType q12 = static_cast<qcllPtrT>(curPtr)->q12;
-   const fType q13 = static_cast<qcllPtrT>(curPtr)->q13;
-   const fType q23 = static_cast<qcllPtrT>(curPtr)->q23;
+   const fType q11 = _q.q11;
+   const fType q22 = _q.q22;
+   const fType q33 = _q.q33;
+   const fType q12 = _q.q12;
+   const fType q13 = _q.q13;
+   const fType q23 = _q.q23;
 
    const fType q1jrj   = q11 * rx + q12 * ry + q13 * rz;
    const fType q2jrj   = q12 * rx + q22 * ry + q23 * rz;
@@ -331,28 +843,39 @@ void GravityWorker<_macT, _partT>::accPC()
 }
 
 
-template<typename _macT, typename _partT>
-void GravityWorker<_macT, _partT>::potPC()
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+template<typename _qT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::potPC(const fType _m, const _qT& _q)
+{
+   vect3dT r;
+   r = MAC.rx, MAC.ry, MAC.rz;
+   potPC(r, MAC.rr, _m, _q);
+}
+
+template<typename _macT, typename _partT, typename _mpT, typename _realT>
+template<typename _qT>
+void GravityWorker<_macT, _partT, _mpT, _realT>::potPC(const vect3dT& _r, const fType _rr,
+                                                 const fType _m, const _qT& _q)
 {
-   const fType rx = MAC.rx;
-   const fType ry = MAC.ry;
-   const fType rz = MAC.rz;
+   const fType rx = _r[0];
+   const fType ry = _r[1];
+   const fType rz = _r[2];
 
-   const fType rr = MAC.rr;
+   const fType rr = _rr;
    const fType r  = sqrt(rr);
 
    const fType Or5 = 1. / (r * rr * rr);
 
-   const fType m = static_cast<qcllPtrT>(curPtr)->m;
+   const fType m = _m;
 
    pot -= m / r;
 
-   const fType q11 = static_cast<qcllPtrT>(curPtr)->q11;
-   const fType q22 = static_cast<qcllPtrT>(curPtr)->q22;
-   const fType q33 = static_cast<qcllPtrT>(curPtr)->q33;
-   const fType q12 = static_cast<qcllPtrT>(curPtr)->q12;
-   const fType q13 = static_cast<qcllPtrT>(curPtr)->q13;
-   const fType q23 = static_cast<qcllPtrT>(curPtr)->q23;
+   const fType q11 = _q.q11;
+   const fType q22 = _q.q22;
+   const fType q33 = _q.q33;
+   const fType q12 = _q.q12;
+   const fType q13 = _q.q13;
+   const fType q23 = _q.q23;
 
    const fType qijrirj = q11 * rx * rx +
                          q22 * ry * ry +
@@ -366,90 +889,218 @@ void GravityWorker<_macT, _partT>::potPC()
 
 
 ///
-/// gravitational spline softening for B Spline kernel from
-/// Hernquist & Katz 1989
+/// the multipole acceptance criteria (MAC) for the walks. a MAC sets
+/// the distance vector (rx,ry,rz) and its square rr from the cell to
+/// the particle, which are used by the interaction functions when the
+/// cell is accepted. before every walk the worker hands the particle
+/// or the members of the group to addSink(), the geometric criteria
+/// ignore them.
 ///
-template<typename _macT, typename _partT>
-fType GravityWorker<_macT, _partT>::splineOSmoR3(const fType _r, const fType _h)
-{
-   const fType u = _r / _h;
+class MACbase {
+public:
+   fType rx, ry, rz, rr;
+
+   void clearSink() { }
+
+   template<typename _partT>
+   void addSink(const _partT&) { }
+};
+
+///
+/// the cell size over distance criterion with a runtime opening angle
+///
+class thetaMAC : public MACbase {
+protected:
+   typedef quadrupoleCellNode*   qcllPtrT;
+   typedef particleNode*         pnodPtrT;
+   typedef BHTreeFrozen::idxT    idxT;
 
-   if (u >= 2.)
+public:
+   thetaMAC(const fType _theta = 0.70) : theta2(_theta * _theta) { }
+
+   void setTheta(const fType _theta)
    {
-      const fType r3 = _r * _r * _r;
-      return(1. / r3);
+      theta2 = _theta * _theta;
    }
-   else
-   if (u > 1.)
-   {
-      const fType r3 = _r * _r * _r;
-      return((1. / r3) * (
-                -(1. / 15.)
-                + (8. / 3.) * u * u * u
-                - 3. * u * u * u * u
-                + (6. / 5.) * u * u * u * u * u
-                - (1. / 6.) * u * u * u * u * u * u
-                ));
+
+   fType getTheta() const
+   {
+      return(sqrt(theta2));
    }
-   else
+
+   bool operator()(const qcllPtrT _cell, const pnodPtrT _part)
    {
-      const fType h3 = _h * _h * _h;
-      return((1. / h3) * (
-                +(4. / 3.)
-                - (6. / 5.) * u * u
-                + (1. / 2.) * u * u * u
-                ));
+      const fType clsz = _cell->clSz;
+
+      setDist(_part->pos, _cell->com);
+      return((clsz * clsz) < theta2 * rr);
    }
-}
 
-template<typename _macT, typename _partT>
-fType GravityWorker<_macT, _partT>::splineOSmoR1(const fType _r, const fType _h)
-{
-   const fType u = _r / _h;
+   bool operator()(const BHTreeFrozen& _frz, const idxT _cell,
+                   const vect3dT& _ppos)
+   {
+      const BHTreeFrozen::hotNode& cell(_frz.hot[_cell]);
+      const fType clsz = cell.clSz;
 
-   if (u >= 2.)
+      setDist(_ppos, cell.com);
+      return((clsz * clsz) < theta2 * rr);
+   }
+
+   ///
+   /// MAC for a group of particles inside the sphere
+   /// with center <_gcen> and radius <_grad>
+   ///
+   bool operator()(const BHTreeFrozen& _frz, const idxT _cell,
+                   const vect3dT& _gcen, const fType _grad)
    {
-      return(1. / _r);
+      const BHTreeFrozen::hotNode& cell(_frz.hot[_cell]);
+      const fType clsz = cell.clSz;
+
+      setDist(_gcen, cell.com);
+      const fType rmin = sqrt(rr) - _grad;
+      return(rmin > 0. && (clsz * clsz) < theta2 * rmin * rmin);
    }
-   else
-   if (u > 1.)
-   {
-      return((-1. / (15. * _r))
-             - (1. / _h) * (-(8. / 5.)
-                            + (4. / 3.) * u * u
-                            - u * u * u
-                            + 0.3 * u * u * u * u
-                            - (1. / 30.) * u * u * u * u * u)
-             );
+
+protected:
+   fType theta2;
+
+   void setDist(const vect3dT& _ppos, const vect3dT& _com)
+   {
+      rx = _ppos[0] - _com[0];
+      ry = _ppos[1] - _com[1];
+      rz = _ppos[2] - _com[2];
+      rr = rx * rx + ry * ry + rz * rz;
    }
-   else
+};
+
+///
+/// the classic criterion with the opening angle fixed to 0.70
+///
+class fixThetaMAC : public thetaMAC {
+public:
+   fixThetaMAC() : thetaMAC(0.70) { }
+};
+
+///
+/// the criterion of Salmon & Warren: a cell is accepted when the
+/// distance to its center of mass exceeds bmax / theta, where bmax
+/// is the distance from the center of mass to the farthest particle
+/// of the cell. the frozen tree stores bmax, on the dynamic tree the
+/// distance to the farthest corner of the cell is used.
+///
+class bmaxMAC : public thetaMAC {
+public:
+   bmaxMAC(const fType _theta = 0.70) : thetaMAC(_theta) { }
+
+   bool operator()(const qcllPtrT _cell, const pnodPtrT _part)
    {
-      return(-(2. / _h) * ((1. / 3.) * u * u
-                           - (3. / 20.) * u * u * u * u
-                           + (1. / 20.) * u * u * u * u * u)
-             + (7. / (5. * _h))
-             );
+      const vect3dT off  = _cell->com - _cell->cen;
+      const fType   bmax = sqrt(dot(off, off)) +
+                           0.8660254037844386 * _cell->clSz;
+
+      setDist(_part->pos, _cell->com);
+      return((bmax * bmax) < theta2 * rr);
    }
-}
 
-class fixThetaMAC {
-   typedef monopoleCellNode*     mcllPtrT;
-   typedef quadrupoleCellNode*   qcllPtrT;
-   typedef particleNode*         pnodPtrT;
+   bool operator()(const BHTreeFrozen& _frz, const idxT _cell,
+                   const vect3dT& _ppos)
+   {
+      const fType bmax = _frz.rmax[_frz.hot[_cell].cell];
+
+      setDist(_ppos, _frz.hot[_cell].com);
+      return((bmax * bmax) < theta2 * rr);
+   }
+
+   bool operator()(const BHTreeFrozen& _frz, const idxT _cell,
+                   const vect3dT& _gcen, const fType _grad)
+   {
+      const fType bmax = _frz.rmax[_frz.hot[_cell].cell];
+
+      setDist(_gcen, _frz.hot[_cell].com);
+      const fType rmin = sqrt(rr) - _grad;
+      return(rmin > 0. && (bmax * bmax) < theta2 * rmin * rmin);
+   }
+};
+
+///
+/// the relative criterion: a cell of mass M and size l at distance r
+/// is accepted when the estimated error G M l^2 / r^4 of its field is
+/// below alpha times the acceleration |a_old| of the particle in the
+/// previous step. cells closer than 0.6 l to their center in every
+/// direction are always opened. the particle type has to provide the
+/// magnitude of the previous acceleration as aold, particles with an
+/// aold of zero (e.g. in the first step) fall back to the geometric
+/// criterion with the opening angle theta. for groups the smallest
+/// aold of the members is used.
+///
+class relativeMAC : public thetaMAC {
 public:
-   fType rx, ry, rz, rr;
+   relativeMAC(const fType _theta = 0.70,
+               const fType _alpha = 0.005,
+               const fType _G = 1.) : thetaMAC(_theta),
+      alphaOG(_alpha / _G), aold(0.) { }
+
+   void setAlpha(const fType _alpha, const fType _G)
+   {
+      alphaOG = _alpha / _G;
+   }
+
+   void clearSink()
+   {
+      aold = std::numeric_limits<fType>::max();
+   }
+
+   template<typename _partT>
+   void addSink(const _partT& _part)
+   {
+      aold = _part.aold < aold ? _part.aold : aold;
+   }
+
    bool operator()(const qcllPtrT _cell, const pnodPtrT _part)
    {
-      const fType theta  = 0.70;
-      const fType clsz   = _cell->clSz;
-      const fType theta2 = theta * theta;
+      setDist(_part->pos, _cell->com);
+      return(accept(_cell->m, _cell->clSz, _cell->cen, _part->pos, rr, 0.));
+   }
 
-      rx = _part->pos[0] - _cell->com[0];
-      ry = _part->pos[1] - _cell->com[1];
-      rz = _part->pos[2] - _cell->com[2];
-      rr = rx * rx + ry * ry + rz * rz;
+   bool operator()(const BHTreeFrozen& _frz, const idxT _cell,
+                   const vect3dT& _ppos)
+   {
+      const BHTreeFrozen::hotNode& cell(_frz.hot[_cell]);
+
+      setDist(_ppos, cell.com);
+      return(accept(cell.m, cell.clSz, _frz.cen[cell.cell], _ppos, rr, 0.));
+   }
 
-      return((clsz * clsz / rr) < theta2);
+   bool operator()(const BHTreeFrozen& _frz, const idxT _cell,
+                   const vect3dT& _gcen, const fType _grad)
+   {
+      const BHTreeFrozen::hotNode& cell(_frz.hot[_cell]);
+
+      setDist(_gcen, cell.com);
+      const fType rmin = sqrt(rr) - _grad;
+      if (not (rmin > 0.))
+         return(false);
+      return(accept(cell.m, cell.clSz, _frz.cen[cell.cell], _gcen,
+                    rmin * rmin, _grad));
+   }
+
+private:
+   fType alphaOG, aold;
+
+   bool accept(const fType _m, const fType _clsz, const vect3dT& _cen,
+               const vect3dT& _ppos, const fType _rr, const fType _grad)
+   {
+      const fType lim = 0.6 * _clsz + _grad;
+
+      if (std::abs(_ppos[0] - _cen[0]) < lim &&
+          std::abs(_ppos[1] - _cen[1]) < lim &&
+          std::abs(_ppos[2] - _cen[2]) < lim)
+         return(false);
+
+      if (aold > 0. && aold < std::numeric_limits<fType>::max())
+         return(_m * _clsz * _clsz < alphaOG * aold * _rr * _rr);
+      else
+         return((_clsz * _clsz) < theta2 * _rr);
    }
 };
 };
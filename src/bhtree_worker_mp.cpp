@@ -20,12 +20,10 @@ public:
    ~BHTreeMPWorker() { }
 
    void calcMultipoles(const czllPtrT _czllPtr);
-   void calcMultipolesCZ();
 
 private:
 
    void MPRec();
-   void MPRecCZ();
 };
 
 void BHTreeMPWorker::calcMultipoles(const czllPtrT _czllPtr)
@@ -53,34 +51,6 @@ void BHTreeMPWorker::MPRec()
       static_cast<qcllPtrT>(curPtr)->calcMultipole();
    }
 }
-
-void BHTreeMPWorker::calcMultipolesCZ()
-{
-   goRoot();
-   MPRecCZ();
-}
-
-void BHTreeMPWorker::MPRecCZ()
-{
-   if (not curPtr->isParticle)
-   {
-      for (size_t i = 0; i < 8; i++)
-      {
-         if (static_cast<gcllPtrT>(curPtr)->child[i] != NULL)
-         {
-         // omit the particle check, as there should be no particles
-         // in the CZ part of the tree
-            if (not static_cast<gcllPtrT>(curPtr)->child[i]->atBottom)
-            {
-               goChild(i);
-               MPRecCZ();
-               goUp();
-            }
-         }
-      }
-      static_cast<qcllPtrT>(curPtr)->calcMultipole();
-   }
-}
 };
 
 #endif
@@ -12,21 +12,53 @@
 #include "bhtree_worker.cpp"
 #include "bhtree_particle.h"
 #include "timer.cpp"
-#include <list>
+#include <algorithm>
+#include <vector>
 
 namespace sphlatch {
 template<typename _funcT, typename _partT>
 class NeighWorker : public BHTreeWorker {
 public:
-   NeighWorker(const treePtrT _treePtr) : BHTreeWorker(_treePtr) { }
-   NeighWorker(const NeighWorker& _Nworker) : BHTreeWorker(_Nworker) { }
+   NeighWorker(const treePtrT _treePtr) : BHTreeWorker(_treePtr),
+      groupSize(1) { }
+   NeighWorker(const NeighWorker& _Nworker) : BHTreeWorker(_Nworker),
+      groupSize(_Nworker.groupSize) { }
    ~NeighWorker() { }
 
    void neighExecFunc(const pnodPtrT _part, const fType _srad);
    void neighExecFunc(const czllPtrT _czll, const fType _srad);
 
+   typedef BHTreeFrozen::idxT   idxT;
+   void neighExecFunc(const idxT _i, const fType _srad);
+
+   ///
+   /// on the frozen tree, particles in cells with at most <groupSize>
+   /// particles share one walk for their neighbour candidates. a
+   /// group size of 1 walks the tree for every particle.
+   ///
+   void setGroupSize(const size_t _groupSize)
+   {
+      groupSize = _groupSize > 0 ? _groupSize : 1;
+   }
+
+   size_t getGroupSize() const
+   {
+      return(groupSize);
+   }
+
 protected:
+   void neighCollectGroup(const idxT _g, const fType _hMult);
+   void neighExecMember(const size_t _k, const fType _srad);
+
    _funcT Func;
+   size_t groupSize;
+
+   ///
+   /// the members of the current group and the candidates of
+   /// the group walk, their positions stored as arrays
+   ///
+   std::vector<idxT>  grpList, candList;
+   std::vector<fType> candX, candY, candZ, candRR;
 };
 
 template<typename _funcT, typename _partT>
@@ -35,7 +67,7 @@ void NeighWorker<_funcT, _partT>::neighExecFunc(const pnodPtrT _pnod,
 {
    // go to the particle and load its data
    curPtr = _pnod;
-   _partT* const ipartPtr = static_cast<_partT*>(_pnod->partPtr);
+   _partT* const ipartPtr = static_cast<_partT*>(_pnod);
    const vect3dT ppos     = _pnod->pos;
    const fType   srad2    = _srad * _srad;
 
@@ -57,9 +89,7 @@ void NeighWorker<_funcT, _partT>::neighExecFunc(const pnodPtrT _pnod,
 
          if (rr < srad2)
          {
-            Func(ipartPtr,
-                 static_cast<_partT*>(static_cast<pnodPtrT>(curPtr)->partPtr),
-                 rvec, rr, _srad);
+            Func(ipartPtr, static_cast<_partT*>(curPtr), rvec, rr, _srad);
          }
 
          goNext();
@@ -80,10 +110,219 @@ void NeighWorker<_funcT, _partT>::neighExecFunc(const pnodPtrT _pnod,
    }
 }
 
+///
+/// the same search on the frozen tree, _i is the index
+/// of the particle node
+///
+template<typename _funcT, typename _partT>
+void NeighWorker<_funcT, _partT>::neighExecFunc(const idxT  _i,
+                                                const fType _srad)
+{
+   const BHTreeFrozen& frz(treePtr->getFrozen());
+
+   const BHTreeFrozen::hotNode* const hot = &frz.hot[0];
+   const vect3dT* const               cen = &frz.cen[0];
+   const idxT* const                  par = &frz.parent[0];
+
+   _partT* const ipartPtr = static_cast<_partT*>(frz.part[_i]);
+   const vect3dT ppos     = hot[_i].com;
+   const fType   srad2    = _srad * _srad;
+
+   // go up, until the search sphere is completely in the current cell
+   idxT cell = par[_i];
+   while (par[cell] != BHTreeFrozen::nil)
+   {
+      const fType RCellMRSph = 0.5 * hot[cell].clSz - _srad;
+      if (all(cen[hot[cell].cell] - ppos < RCellMRSph) &&
+          all(cen[hot[cell].cell] - ppos > -RCellMRSph))
+         break;
+      cell = par[cell];
+   }
+
+   // now start to search the subtree for potential neighbours
+   const idxT lastNode = hot[cell].skip;
+   idxT       cur      = cell;
+   while (cur < lastNode)
+   {
+      if (hot[cur].isParticle)
+      {
+         const vect3dT rvec = ppos - hot[cur].com;
+         const fType   rr   = dot(rvec, rvec);
+
+         if (rr < srad2)
+         {
+            Func(ipartPtr, static_cast<_partT*>(frz.part[cur]),
+                 rvec, rr, _srad);
+         }
+         cur++;
+      }
+      else
+      {
+         // if search sphere completely outside of the current cell, skip it
+         const fType RCellPRSph = 0.5 * hot[cur].clSz + _srad;
+         if (any(cen[hot[cur].cell] - ppos > RCellPRSph) ||
+             any(cen[hot[cur].cell] - ppos < -RCellPRSph))
+            cur = hot[cur].skip;
+         else
+            cur++;
+      }
+   }
+}
+
+///
+/// the group walk: the bounding box of the members of the cell <_g>,
+/// grown by the largest search radius <_hMult> h of the members, is
+/// searched once for all of them. the candidates in the box are kept
+/// in the order of the tree, as the walk for a single particle
+/// finds them.
+///
+template<typename _funcT, typename _partT>
+void NeighWorker<_funcT, _partT>::neighCollectGroup(const idxT  _g,
+                                                    const fType _hMult)
+{
+   const BHTreeFrozen& frz(treePtr->getFrozen());
+
+   const BHTreeFrozen::hotNode* const hot = &frz.hot[0];
+   const vect3dT* const               cen = &frz.cen[0];
+   const idxT* const                  par = &frz.parent[0];
+
+   ///
+   /// collect the members, their bounding box and the search radius
+   ///
+   grpList.clear();
+   vect3dT gmin = hot[_g].com, gmax = hot[_g].com;
+   fType   hmax = 0.;
+   const idxT gLast = hot[_g].skip;
+   for (idxT i = _g; i < gLast; i++)
+   {
+      if (hot[i].isParticle)
+      {
+         grpList.push_back(i);
+         const vect3dT& pos(hot[i].com);
+         for (size_t j = 0; j < 3; j++)
+         {
+            gmin[j] = pos[j] < gmin[j] ? pos[j] : gmin[j];
+            gmax[j] = pos[j] > gmax[j] ? pos[j] : gmax[j];
+         }
+         const fType hi = static_cast<_partT*>(frz.part[i])->h;
+         hmax = hi > hmax ? hi : hmax;
+      }
+   }
+   const fType   srad = _hMult * hmax;
+   const vect3dT bmin = gmin - srad;
+   const vect3dT bmax = gmax + srad;
+
+   // go up, until the box is completely in the current cell
+   idxT cell = _g;
+   while (par[cell] != BHTreeFrozen::nil)
+   {
+      const fType hcSize = 0.5 * hot[cell].clSz;
+      const vect3dT& ccen(cen[hot[cell].cell]);
+      if (all(bmin > ccen - hcSize) && all(bmax < ccen + hcSize))
+         break;
+      cell = par[cell];
+   }
+
+   // now search the subtree for the candidates in the box
+   candList.clear();
+   candX.clear();
+   candY.clear();
+   candZ.clear();
+
+   const idxT lastNode = hot[cell].skip;
+   idxT       cur      = cell;
+   while (cur < lastNode)
+   {
+      if (hot[cur].isParticle)
+      {
+         const vect3dT& pos(hot[cur].com);
+         if (all(pos > bmin) && all(pos < bmax))
+         {
+            candList.push_back(cur);
+            candX.push_back(pos[0]);
+            candY.push_back(pos[1]);
+            candZ.push_back(pos[2]);
+         }
+         cur++;
+      }
+      else
+      {
+         // if the box is completely outside of the current cell, skip it
+         const fType    hcSize = 0.5 * hot[cur].clSz;
+         const vect3dT& ccen(cen[hot[cur].cell]);
+         if (any(bmin > ccen + hcSize) || any(bmax < ccen - hcSize))
+            cur = hot[cur].skip;
+         else
+            cur++;
+      }
+   }
+   candRR.resize(candList.size());
+}
+
+///
+/// the distances of member <_k> to all candidates are calculated
+/// in one loop over the candidate arrays, which the compiler can
+/// vectorize. the function is then applied to the candidates
+/// inside the search radius.
+///
+template<typename _funcT, typename _partT>
+void NeighWorker<_funcT, _partT>::neighExecMember(const size_t _k,
+                                                  const fType  _srad)
+{
+   const BHTreeFrozen& frz(treePtr->getFrozen());
+   const idxT          i = grpList[_k];
+
+   _partT* const ipartPtr = static_cast<_partT*>(frz.part[i]);
+   const vect3dT ppos     = frz.hot[i].com;
+   const fType   srad2    = _srad * _srad;
+
+   const size_t noCand = candList.size();
+   if (noCand == 0)
+      return;
+
+   const fType* const cx = &candX[0];
+   const fType* const cy = &candY[0];
+   const fType* const cz = &candZ[0];
+   fType* const       rr = &candRR[0];
+
+   const fType px = ppos[0], py = ppos[1], pz = ppos[2];
+   for (size_t j = 0; j < noCand; j++)
+   {
+      const fType dx = px - cx[j];
+      const fType dy = py - cy[j];
+      const fType dz = pz - cz[j];
+      rr[j] = dx * dx + dy * dy + dz * dz;
+   }
+
+   for (size_t j = 0; j < noCand; j++)
+   {
+      if (rr[j] < srad2)
+      {
+         const idxT cur  = candList[j];
+         const vect3dT rvec = ppos - frz.hot[cur].com;
+         Func(ipartPtr, static_cast<_partT*>(frz.part[cur]),
+              rvec, rr[j], _srad);
+      }
+   }
+}
+
 template<typename _funcT, typename _partT>
 void NeighWorker<_funcT, _partT>::neighExecFunc(const czllPtrT _czll,
                                                 const fType    _srad)
 {
+   if (treePtr->isFrozen())
+   {
+      const BHTreeFrozen& frz(treePtr->getFrozen());
+      const idxT          last = frz.hot[_czll->frozenIdx].skip;
+
+      for (idxT i = _czll->frozenIdx + 1; i < last; i++)
+      {
+         if (frz.hot[i].isParticle)
+            neighExecFunc(i, _srad);
+      }
+      return;
+   }
+
    nodePtrT       curPart  = _czll->chldFrst;
    const nodePtrT stopChld = _czll->chldLast->next;
 
@@ -100,6 +339,11 @@ void NeighWorker<_funcT, _partT>::neighExecFunc(const czllPtrT _czll,
    }
 }
 
+//
+// the neighbour lists below are vectors kept in the worker, clearing
+// them keeps their capacity. so a worker per thread allocates only
+// until its lists have grown to the largest neighbour count.
+//
 template<typename _partT>
 class NeighListFunc
 {
@@ -113,11 +357,14 @@ public:
       neighList.push_back(_j);
    }
 
-   std::list<_partT*> neighList;
+   std::vector<_partT*> neighList;
 };
 
 
-
+///
+/// the returned list belongs to the worker and
+/// is only valid until its next search
+///
 template<typename _partT>
 class NeighFindWorker : public NeighWorker<NeighListFunc<_partT> , _partT> {
 public:
@@ -129,14 +376,16 @@ public:
       NeighWorker<NeighListFunc<_partT> , _partT>(_NFwork) { }
    ~NeighFindWorker() { }
 
-   std::list<_partT*> operator()(const _partT* _part, const fType _srad)
+   typedef std::vector<_partT*>                           partPtrVT;
+
+   const partPtrVT& operator()(const _partT* _part, const fType _srad)
    {
       parentT::Func.neighList.clear();
-      parentT::neighExecFunc(_part->treeNode, _srad);
+      parentT::neighExecFunc(const_cast<_partT*>(_part), _srad);
       return(parentT::Func.neighList);
    }
 
-   std::list<_partT*> operator()(const pnodPtrT _pnod, const fType _srad)
+   const partPtrVT& operator()(const pnodPtrT _pnod, const fType _srad)
    {
       parentT::Func.neighList.clear();
       parentT::neighExecFunc(_pnod, _srad);
@@ -158,33 +407,161 @@ public:
 public:
       PPtrD(_partT* _ptr, const fType _rr) : ptr(_ptr), rr(_rr) { }
       ~PPtrD() { }
-      _partT      * ptr;
-      const fType rr;
+      _partT* ptr;
+      fType   rr;
    };
 
    // small helper class to sort a list of neighbours according to distance
    class PPtrDsorter
    {
 public:
-      bool operator()(PPtrD& _ppd1, PPtrD& _ppd2)
+      bool operator()(const PPtrD& _ppd1, const PPtrD& _ppd2) const
       {
          return(_ppd1.rr < _ppd2.rr);
       }
    };
 
-   void operator()(_partT* const _i,
+   void operator()(_partT* const,
                    _partT* const _j,
-                   const vect3dT& _rvec,
+                   const vect3dT&,
                    const fType _rr,
-                   const fType _srad)
+                   const fType)
    {
       neighList.push_back(PPtrD(_j, _rr));
    }
 
-   std::list<PPtrD> neighList;
+   std::vector<PPtrD> neighList;
 };
 
 
+///
+/// the k nearest neighbours of a particle on the frozen tree. the
+/// particle itself counts as its nearest neighbour. the candidates
+/// are kept in a max heap of size k, once it is full the search
+/// radius shrinks to the distance of the farthest candidate and
+/// cells farther away are skipped. the search starts in the parent
+/// cell of the particle and goes up, until the search sphere lies
+/// completely in the searched cell.
+///
+template<typename _partT>
+class KNNWorker : public BHTreeWorker {
+public:
+   typedef BHTreeFrozen::idxT                                idxT;
+   typedef typename NeighDistListFunc<_partT>::PPtrD         pptrDT;
+   typedef typename NeighDistListFunc<_partT>::PPtrDsorter   pptrDsortT;
+   typedef typename std::vector<pptrDT>                      pptrDLT;
+
+   KNNWorker(const treePtrT _treePtr) : BHTreeWorker(_treePtr) { }
+   KNNWorker(const KNNWorker& _KNNwork) : BHTreeWorker(_KNNwork) { }
+   ~KNNWorker() { }
+
+   ///
+   /// returns the distance to the <_k>th nearest neighbour of the
+   /// particle node <_i> or, if the tree holds less than <_k>
+   /// particles, the distance to the farthest one
+   ///
+   fType operator()(const idxT _i, const size_t _k);
+
+   ///
+   /// the neighbours of the last search sorted by distance, the
+   /// list is only valid until the next search
+   ///
+   const pptrDLT& getNeighbours()
+   {
+      std::sort_heap(heap.begin(), heap.end(), pptrDsortT());
+      return(heap);
+   }
+
+private:
+   pptrDLT heap;
+};
+
+template<typename _partT>
+fType KNNWorker<_partT>::operator()(const idxT _i, const size_t _k)
+{
+   const BHTreeFrozen& frz(treePtr->getFrozen());
+
+   const BHTreeFrozen::hotNode* const hot = &frz.hot[0];
+   const vect3dT* const               cen = &frz.cen[0];
+   const idxT* const                  par = &frz.parent[0];
+
+   const pptrDsortT sorter;
+   const vect3dT    ppos = hot[_i].com;
+   fType            rr2  = fTypeInf;
+
+   heap.clear();
+   heap.push_back(pptrDT(static_cast<_partT*>(frz.part[_i]), 0.));
+   if (heap.size() == _k)
+      rr2 = 0.;
+
+   idxT done = _i;
+   idxT cell = par[_i];
+   while (cell != BHTreeFrozen::nil)
+   {
+      // search the cell, except the already searched child
+      const idxT last = hot[cell].skip;
+      idxT       cur  = cell + 1;
+      while (cur < last)
+      {
+         if (cur == done)
+         {
+            cur = hot[done].skip;
+            continue;
+         }
+
+         if (hot[cur].isParticle)
+         {
+            const vect3dT rvec = ppos - hot[cur].com;
+            const fType   rr   = dot(rvec, rvec);
+
+            if (heap.size() < _k)
+            {
+               heap.push_back(pptrDT(static_cast<_partT*>(frz.part[cur]), rr));
+               std::push_heap(heap.begin(), heap.end(), sorter);
+               if (heap.size() == _k)
+                  rr2 = heap.front().rr;
+            }
+            else if (rr < rr2)
+            {
+               std::pop_heap(heap.begin(), heap.end(), sorter);
+               heap.back() = pptrDT(static_cast<_partT*>(frz.part[cur]), rr);
+               std::push_heap(heap.begin(), heap.end(), sorter);
+               rr2 = heap.front().rr;
+            }
+            cur++;
+         }
+         else
+         {
+            // skip cells farther away than the current search radius
+            const fType hcSize = 0.5 * hot[cur].clSz;
+            fType       dd     = 0.;
+            for (size_t k = 0; k < 3; k++)
+            {
+               const fType dk = fabs(cen[hot[cur].cell][k] - ppos[k]) - hcSize;
+               dd += dk > 0. ? dk * dk : 0.;
+            }
+            cur = dd < rr2 ? cur + 1 : hot[cur].skip;
+         }
+      }
+
+      // stop, when the search sphere lies in the searched cell
+      const fType RCellMRSph = 0.5 * hot[cell].clSz - sqrt(rr2);
+      if (all(cen[hot[cell].cell] - ppos < RCellMRSph) &&
+          all(cen[hot[cell].cell] - ppos > -RCellMRSph))
+         break;
+
+      done = cell;
+      cell = par[cell];
+   }
+
+   return(sqrt(heap.front().rr));
+}
+
+///
+/// sets the smoothing length of the particles in a CZ cell to the
+/// distance to their noneigh-th nearest neighbour divided by <mult>.
+/// on the frozen tree the neighbours are found by the KNNWorker.
+///
 template<typename _partT>
 class SmoLenFindWorker :
    public NeighWorker<NeighDistListFunc<_partT> , _partT> {
@@ -192,17 +569,40 @@ public:
    typedef NeighWorker<NeighDistListFunc<_partT> , _partT>   parentT;
    typedef typename NeighDistListFunc<_partT>::PPtrD         pptrDT;
    typedef typename NeighDistListFunc<_partT>::PPtrDsorter   pptrDsortT;
-   typedef typename std::list<pptrDT>                        pptrDLT;
+   typedef typename std::vector<pptrDT>                      pptrDLT;
+   typedef typename parentT::idxT                            idxT;
 
    SmoLenFindWorker(const BHTreeWorker::treePtrT _treePtr, const fType _mult) :
-      NeighWorker<NeighDistListFunc<_partT> , _partT>(_treePtr), mult(_mult) { }
+      NeighWorker<NeighDistListFunc<_partT> , _partT>(_treePtr),
+      knnWorker(_treePtr), mult(_mult) { }
    SmoLenFindWorker(const SmoLenFindWorker& _SLFwork) :
-      NeighWorker<NeighDistListFunc<_partT> , _partT>(_SLFwork)
-      , mult(_SLFwork.mult) { }
+      NeighWorker<NeighDistListFunc<_partT> , _partT>(_SLFwork),
+      knnWorker(_SLFwork.knnWorker), mult(_SLFwork.mult) { }
    ~SmoLenFindWorker() { }
 
    void operator()(const czllPtrT _czll)
    {
+      if (BHTreeWorker::treePtr->isFrozen())
+      {
+         const BHTreeFrozen& frz(BHTreeWorker::treePtr->getFrozen());
+         const idxT          last = frz.hot[_czll->frozenIdx].skip;
+
+         for (idxT i = _czll->frozenIdx + 1; i < last; i++)
+         {
+            if (frz.hot[i].isParticle)
+            {
+               _partT* const partPtr = static_cast<_partT*>(frz.part[i]);
+               const size_t  noneigh = partPtr->noneigh;
+
+               assert(noneigh > 0);
+
+               // the particle itself is the nearest neighbour
+               partPtr->h = knnWorker(i, noneigh + 1) / mult;
+            }
+         }
+         return;
+      }
+
       nodePtrT       curPart  = _czll->chldFrst;
       const nodePtrT stopChld = _czll->chldLast->next;
 
@@ -214,7 +614,7 @@ public:
          if (curPart->isParticle)
          {
             const pnodPtrT pnod    = static_cast<pnodPtrT>(curPart);
-            _partT* const  partPtr = static_cast<_partT*>(pnod->partPtr);
+            _partT* const  partPtr = static_cast<_partT*>(pnod);
 
             const size_t noneigh = partPtr->noneigh;
             const fType  smass   = static_cast<fType>(noneigh);
@@ -227,27 +627,22 @@ public:
             parentT::neighExecFunc(pnod, srad);
 
             // sort the list according to the distance
-            pptrDLT&   neighList(parentT::Func.neighList);
-            pptrDsortT neighSorter;
-            neighList.sort(neighSorter);
+            pptrDLT& neighList(parentT::Func.neighList);
+            std::sort(neighList.begin(), neighList.end(), pptrDsortT());
 
+            // with too few neighbours, take the farthest one
             if (neighList.size() <= noneigh)
-               partPtr->h = sqrt((*(neighList.end())).rr) / mult;
+               partPtr->h = sqrt(neighList.back().rr) / mult;
             else
-            {
-               typename pptrDLT::const_iterator nitr = neighList.begin();
-               for (size_t i = 0; i < noneigh; i++)
-                  nitr++;
-
-               partPtr->h = sqrt((*nitr).rr) / mult;
-            }
+               partPtr->h = sqrt(neighList[noneigh].rr) / mult;
          }
          curPart = curPart->next;
       }
    }
 
 protected:
-   const fType mult;
+   KNNWorker<_partT> knnWorker;
+   const fType       mult;
 };
 
 
@@ -258,7 +653,7 @@ public:
    typedef NeighWorker<NeighDistListFunc<_partT> , _partT>   parentT;
    typedef typename NeighDistListFunc<_partT>::PPtrD         pptrDT;
    typedef typename NeighDistListFunc<_partT>::PPtrDsorter   pptrDsortT;
-   typedef typename std::list<pptrDT>                        pptrDLT;
+   typedef typename std::vector<pptrDT>                      pptrDLT;
 
    NeighFindSortedWorker(const BHTreeWorker::treePtrT _treePtr) :
       NeighWorker<NeighDistListFunc<_partT> , _partT>(_treePtr) { }
@@ -266,18 +661,20 @@ public:
       NeighWorker<NeighDistListFunc<_partT> , _partT>(_SLFwork) { }
    ~NeighFindSortedWorker() { }
 
-   pptrDLT operator()(const _partT* _part, const fType _srad)
+   ///
+   /// the returned list belongs to the worker and
+   /// is only valid until its next search
+   ///
+   const pptrDLT& operator()(const _partT* _part, const fType _srad)
    {
       parentT::Func.neighList.clear();
-      parentT::neighExecFunc(_part->treeNode, _srad);
-
+      parentT::neighExecFunc(const_cast<_partT*>(_part), _srad);
 
       // sort the list according to the distance
-      pptrDLT&   neighList(parentT::Func.neighList);
-      pptrDsortT neighSorter;
-      neighList.sort(neighSorter);
+      pptrDLT& neighList(parentT::Func.neighList);
+      std::sort(neighList.begin(), neighList.end(), pptrDsortT());
 
-      return(parentT::Func.neighList);
+      return(neighList);
    }
 };
 };
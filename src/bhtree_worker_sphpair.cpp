@@ -0,0 +1,187 @@
+#ifndef BHTREE_WORKER_SPHPAIR_CPP
+#define BHTREE_WORKER_SPHPAIR_CPP
+
+/*
+ *  bhtree_worker_sphpair.cpp
+ *
+ *  the symmetric SPH sums over the pair lists of the neighbour list
+ *  cache, each pair is evaluated once. the CZ cells are split into
+ *  one block per thread and a thread owns the rows of its cells,
+ *  which are the cells given to the build of the cache. contributions
+ *  to rows of an other thread are kept in a list for their owner,
+ *  which adds them after all pairs have been evaluated. the pair
+ *  functions provide a contribT and are called by
+ *  pair(i, j, rvec, rr, ci, cj) and postSum(i, c).
+ *
+ *  Created by Andreas Reufer on 12.02.10.
+ *  Copyright 2010 University of Berne. All rights reserved.
+ *
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+#include <vector>
+
+#ifdef SPHLATCH_OPENMP
+ #include <omp.h>
+#endif
+
+#include "bhtree_worker.cpp"
+#include "bhtree_particle.h"
+#include "bhtree_neighlist_cache.cpp"
+#include "timer.cpp"
+
+namespace sphlatch {
+template<typename _pairT, typename _partT>
+class SPHpairWorker : public BHTreeWorker {
+public:
+   typedef typename _pairT::contribT                     contribT;
+   typedef std::vector<std::pair<size_t, contribT> >     haloListT;
+
+   SPHpairWorker(const treePtrT _treePtr) : BHTreeWorker(_treePtr) { }
+   SPHpairWorker(const SPHpairWorker& _SPHwork) :
+      BHTreeWorker(_SPHwork) { }
+   ~SPHpairWorker() { }
+
+   ///
+   /// the sum for all particles in the frozen <_cells>, the pair
+   /// lists of the cache have to be built. not to be called from
+   /// inside a parallel region.
+   ///
+   void operator()(const BHTree::czllPtrVectT&    _cells,
+                   const NeighListCache<_partT>& _cache);
+
+   typedef sphlatch::Timer   timerT;
+};
+
+template<typename _pairT, typename _partT>
+void SPHpairWorker<_pairT, _partT>::operator()(
+   const BHTree::czllPtrVectT&    _cells,
+   const NeighListCache<_partT>&  _cache)
+{
+   typedef typename NeighListCache<_partT>::rowT   rowT;
+
+   const int    noCells = _cells.size();
+   const size_t noRows  = _cache.getNoRows();
+
+   assert(_cache.cellRow.size() == static_cast<size_t>(noCells + 1));
+
+#ifdef SPHLATCH_OPENMP
+   const int noThreads = omp_get_max_threads();
+#else
+   const int noThreads = 1;
+#endif
+
+   std::vector<contribT> sums(noRows);
+
+   // the current positions and search radii of the rows
+   std::vector<vect3dT> rowPos(noRows);
+   std::vector<fType>   rowSrad(noRows);
+
+   // the first row of each thread and
+   // halo[t * noThreads + o] holds the contributions of t for o
+   std::vector<rowT>      threadRow(noThreads + 1, noRows);
+   std::vector<haloListT> halo(noThreads * noThreads);
+
+#pragma omp parallel
+   {
+#ifdef SPHLATCH_OPENMP
+      const int tid = omp_get_thread_num();
+      const int nth = omp_get_num_threads();
+#else
+      const int tid = 0;
+      const int nth = 1;
+#endif
+      const int  cFrst = (noCells * tid) / nth;
+      const int  cLast = (noCells * (tid + 1)) / nth;
+      const rowT rFrst = _cache.cellRow[cFrst];
+      const rowT rLast = _cache.cellRow[cLast];
+
+      _pairT Pair;
+      timerT Timer;
+
+      threadRow[tid] = rFrst;
+      for (rowT i = rFrst; i < rLast; i++)
+      {
+         rowPos[i]  = _cache.rowPart[i]->pos;
+         rowSrad[i] = 2. * _cache.rowPart[i]->h;
+      }
+#pragma omp barrier
+
+      ///
+      /// evaluate the pairs of the owned rows, the rows of a thread
+      /// are the ones of its cells. the particle itself is a
+      /// neighbour, its contribution is taken once.
+      ///
+      const vect3dT zero(0., 0., 0.);
+      for (int c = cFrst; c < cLast; c++)
+      {
+         Timer.start();
+         const rowT cEnd = _cache.cellRow[c + 1];
+         for (rowT irow = _cache.cellRow[c]; irow < cEnd; irow++)
+         {
+            _partT* const ipartPtr = _cache.rowPart[irow];
+            const vect3dT ppos     = rowPos[irow];
+            const fType   srad2i   = rowSrad[irow] * rowSrad[irow];
+
+            contribT si, ci, cj;
+            Pair(ipartPtr, ipartPtr, zero, 0., ci, cj);
+            si += ci;
+
+            const size_t kEnd = _cache.pairEnd[irow];
+            for (size_t k = _cache.pairBegin[irow]; k < kEnd; k++)
+            {
+               const rowT    jrow  = _cache.pairNeigh[k];
+               const vect3dT rvec  = ppos - rowPos[jrow];
+               const fType   rr    = dot(rvec, rvec);
+               const fType   sradj = rowSrad[jrow];
+
+               const bool withI = rr < srad2i;
+               const bool withJ = rr < sradj * sradj;
+               if (not (withI || withJ))
+                  continue;
+
+               Pair(ipartPtr, _cache.rowPart[jrow], rvec, rr, ci, cj);
+               if (withI)
+                  si += ci;
+               if (withJ)
+               {
+                  if (jrow >= rFrst && jrow < rLast)
+                     sums[jrow] += cj;
+                  else
+                  {
+                     const int jown = std::upper_bound(threadRow.begin(),
+                                                       threadRow.begin() + nth,
+                                                       jrow) -
+                                      threadRow.begin() - 1;
+                     halo[tid * noThreads + jown].push_back(
+                        std::make_pair(jrow, cj));
+                  }
+               }
+            }
+            sums[irow] += si;
+         }
+         _cells[c]->compTime += static_cast<fType>(Timer.getRoundTime());
+      }
+#pragma omp barrier
+
+      ///
+      /// add the contributions of the other threads
+      /// and write the sums to the owned particles
+      ///
+      for (int t = 0; t < nth; t++)
+      {
+         const haloListT& hlist(halo[t * noThreads + tid]);
+         const size_t     noHalo = hlist.size();
+         for (size_t k = 0; k < noHalo; k++)
+            sums[hlist[k].first] += hlist[k].second;
+      }
+
+      for (rowT i = rFrst; i < rLast; i++)
+         Pair.postSum(_cache.rowPart[i], sums[i]);
+   }
+}
+};
+
+#endif
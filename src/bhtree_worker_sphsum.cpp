@@ -14,6 +14,7 @@
 #include "timer.cpp"
 
 #include "bhtree_worker_neighfunc.cpp"
+#include "bhtree_neighlist_cache.cpp"
 
 namespace sphlatch {
 template<typename _sumT, typename _partT>
@@ -32,10 +33,14 @@ public:
 
    void operator()(const czllPtrT _czll);
    void operator()(_partT* const _partPtr);
+   void operator()(const czllPtrT _czll,
+                   const NeighListCache<_partT>& _cache);
 
    typedef sphlatch::Timer   timerT;
 
 private:
+   void sumGroup(const BHTreeFrozen::idxT _g);
+
    timerT Timer;
 };
 
@@ -43,6 +48,43 @@ private:
 template<typename _sumT, typename _partT>
 void SPHsumWorker<_sumT, _partT>::operator()(const czllPtrT _czll)
 {
+   if (BHTreeWorker::treePtr->isFrozen())
+   {
+      typedef typename NeighWorker<_sumT, _partT>::idxT   idxT;
+      const BHTreeFrozen& frz(BHTreeWorker::treePtr->getFrozen());
+      const idxT          last      = frz.hot[_czll->frozenIdx].skip;
+      const size_t        groupSize = NeighWorker<_sumT, _partT>::groupSize;
+
+      Timer.start();
+      idxT i = _czll->frozenIdx + 1;
+      while (i < last)
+      {
+         if (groupSize > 1 && not frz.hot[i].isParticle &&
+             frz.noParts[i] <= groupSize)
+         {
+            if (frz.noParts[i] > 0)
+               sumGroup(i);
+            i = frz.hot[i].skip;
+         }
+         else
+         {
+            if (frz.hot[i].isParticle)
+            {
+               _partT* const partPtr = static_cast<_partT*>(frz.part[i]);
+               const fType   srad    = 2. * partPtr->h;
+
+               NeighWorker<_sumT, _partT>::Func.preSum(partPtr);
+               NeighWorker<_sumT, _partT>::neighExecFunc(i, srad);
+               NeighWorker<_sumT, _partT>::Func.postSum(partPtr);
+            }
+            i++;
+         }
+      }
+      const double compTime = Timer.getRoundTime();
+      _czll->compTime += static_cast<fType>(compTime);
+      return;
+   }
+
    nodePtrT       curPart  = _czll->chldFrst;
    const nodePtrT stopChld = _czll->chldLast->next;
 
@@ -55,8 +97,7 @@ void SPHsumWorker<_sumT, _partT>::operator()(const czllPtrT _czll)
    {
       if (curPart->isParticle)
       {
-         _partT* const partPtr = static_cast<_partT*>(
-            static_cast<pnodPtrT>(curPart)->partPtr);
+         _partT* const partPtr = static_cast<_partT*>(curPart);
          const fType hi   = partPtr->h;
          const fType srad = 2. * hi;
 
@@ -72,17 +113,82 @@ void SPHsumWorker<_sumT, _partT>::operator()(const czllPtrT _czll)
    _czll->compTime += static_cast<fType>(compTime);
 }
 
+///
+/// the members of the cell <_g> share the walk for their candidates
+///
 template<typename _sumT, typename _partT>
-void SPHsumWorker<_sumT, _partT>::operator()(_partT* const _partPtr)
+void SPHsumWorker<_sumT, _partT>::sumGroup(const BHTreeFrozen::idxT _g)
+{
+   typedef NeighWorker<_sumT, _partT>   parentT;
+   const BHTreeFrozen& frz(BHTreeWorker::treePtr->getFrozen());
+
+   parentT::neighCollectGroup(_g, 2.);
+
+   const size_t noMembers = parentT::grpList.size();
+   for (size_t k = 0; k < noMembers; k++)
+   {
+      _partT* const partPtr =
+         static_cast<_partT*>(frz.part[parentT::grpList[k]]);
+
+      parentT::Func.preSum(partPtr);
+      parentT::neighExecMember(k, 2. * partPtr->h);
+      parentT::Func.postSum(partPtr);
+   }
+}
+
+///
+/// the same sum over the cached neighbour lists, the neighbours
+/// are again checked against the current positions
+///
+template<typename _sumT, typename _partT>
+void SPHsumWorker<_sumT, _partT>::operator()(const czllPtrT _czll,
+                                             const NeighListCache<_partT>& _cache)
 {
-   pnodPtrT const pnodPtr = _partPtr->treeNode;
+   typedef typename NeighWorker<_sumT, _partT>::idxT   idxT;
+   const BHTreeFrozen& frz(BHTreeWorker::treePtr->getFrozen());
+   const idxT          last = frz.hot[_czll->frozenIdx].skip;
 
+   if (_cache.neigh.empty())
+      return;
+   _partT* const* const neigh = &_cache.neigh[0];
+
+   Timer.start();
+   for (idxT i = _czll->frozenIdx + 1; i < last; i++)
+   {
+      if (frz.hot[i].isParticle)
+      {
+         _partT* const partPtr = static_cast<_partT*>(frz.part[i]);
+         const size_t  row     = _cache.getRow(partPtr);
+         const size_t  nend    = _cache.rowEnd[row];
+         const vect3dT ppos    = partPtr->pos;
+         const fType   srad    = 2. * partPtr->h;
+         const fType   srad2   = srad * srad;
+
+         NeighWorker<_sumT, _partT>::Func.preSum(partPtr);
+         for (size_t j = _cache.rowBegin[row]; j < nend; j++)
+         {
+            const vect3dT rvec = ppos - neigh[j]->pos;
+            const fType   rr   = dot(rvec, rvec);
+
+            if (rr < srad2)
+               NeighWorker<_sumT, _partT>::Func(partPtr, neigh[j],
+                                                rvec, rr, srad);
+         }
+         NeighWorker<_sumT, _partT>::Func.postSum(partPtr);
+      }
+   }
+   const double compTime = Timer.getRoundTime();
+   _czll->compTime += static_cast<fType>(compTime);
+}
+
+template<typename _sumT, typename _partT>
+void SPHsumWorker<_sumT, _partT>::operator()(_partT* const _partPtr)
+{
    const fType hi   = _partPtr->h;
    const fType srad = 2. * hi;
 
    NeighWorker<_sumT, _partT>::Func.preSum(_partPtr);
-   NeighWorker<_sumT, _partT>::neighExecFunc(static_cast<pnodPtrT>(pnodPtr),
-                                             srad);
+   NeighWorker<_sumT, _partT>::neighExecFunc(_partPtr, srad);
    NeighWorker<_sumT, _partT>::Func.postSum(_partPtr);
 }
 };
@@ -28,7 +28,7 @@ class FOF : public ParticleSet<Clump<_partT> >
 public:
    typedef _partT                 partT;
    typedef ParticleSet<_partT>    partSetT;
-   typedef std::list<_partT*>     partPtrLT;
+   typedef std::vector<_partT*>   partPtrVT;
 
    typedef BHTree                 treeT;
 
@@ -138,11 +138,11 @@ void FOF<_partT>::search(const fType _rhoMin, const fType _hMult,
          if ((parts[i].friendid == FRIENDNONE) ||
              (parts[i].friendid == FRIENDNOTSET))
          {
-            const fType srad   = _hMult * cPart->h;
-            partPtrLT   neighs = NFW(cPart, srad);
+            const fType      srad = _hMult * cPart->h;
+            const partPtrVT& neighs(NFW(cPart, srad));
 
             std::set<cType> neighFOF;
-            typename partPtrLT::iterator nitr;
+            typename partPtrVT::const_iterator nitr;
             for (nitr = neighs.begin(); nitr != neighs.end(); nitr++)
                if (((*nitr)->rho > _rhoMin) && ((*nitr)->friendid > 0))
                   neighFOF.insert((*nitr)->friendid);
@@ -156,7 +156,7 @@ void FOF<_partT>::search(const fType _rhoMin, const fType _hMult,
                cType nfriendid = nextFreeId;
                nextFreeId++;
 
-               partPtrLT clumpees;
+               partPtrVT clumpees;
                for (nitr = neighs.begin(); nitr != neighs.end(); nitr++)
                   if ((*nitr)->rho > _rhoMin)
                   {
@@ -176,10 +176,11 @@ void FOF<_partT>::search(const fType _rhoMin, const fType _hMult,
                   curf->friendid = nfriendid;
                   nocp++;
 
-                  neighs.clear();
-                  neighs = NFW(curf, curf->h);
+                  // the neighbours of cPart are not needed anymore,
+                  // so the list of the worker can be reused
+                  const partPtrVT& cneighs(NFW(curf, curf->h));
 
-                  for (nitr = neighs.begin(); nitr != neighs.end(); nitr++)
+                  for (nitr = cneighs.begin(); nitr != cneighs.end(); nitr++)
                   {
                      if ((*nitr)->rho > _rhoMin)
                      {
@@ -98,7 +98,7 @@ box3dT ParticleSet<_partT>::getBox()
    fType xmax = -fTypeInf, ymax = -fTypeInf, zmax = -fTypeInf;
 
    const size_t nop = parts.size();
-   for (size_t i = 1; i < nop; i++)
+   for (size_t i = 0; i < nop; i++)
    {
       xmin = xmin < parts[i].pos[0] ? xmin : parts[i].pos[0];
       ymin = ymin < parts[i].pos[1] ? ymin : parts[i].pos[1];
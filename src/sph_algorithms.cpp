@@ -12,7 +12,7 @@ struct densSum
 #else
    fType  rhoi;
 #endif
-   void   preSum(_partT* const _i)
+   void   preSum(_partT* const)
    {
 #ifdef SPHLATCH_MISCIBLE
       deltai = 0.;
@@ -21,9 +21,9 @@ struct densSum
 #endif
    }
 
-   void operator()(_partT* const _i,
+   void operator()(_partT* const,
                    const _partT* const _j,
-                   const vect3dT& _rvec,
+                   const vect3dT&,
                    const fType _rr,
                    const fType _srad)
    {
@@ -91,7 +91,7 @@ struct accPowSum
 #endif
    }
 
-   void operator()(_partT* const _i,
+   void operator()(_partT* const,
                    const _partT* const _j,
                    const vect3dT& _rvec,
                    const fType _rr,
@@ -250,6 +250,196 @@ struct accPowSum
 };
 
 
+#ifndef SPHLATCH_MISCIBLE
+///
+/// the pair forms of the sums above, each pair of particles is
+/// evaluated once and gives the contributions <_ci> to i and <_cj>
+/// to j. the contributions of the neighbours and of the particle
+/// itself are summed up and then written by postSum().
+///
+template<typename _partT, typename _krnlT>
+struct densPairSum
+{
+   _krnlT K;
+
+   class contribT {
+public:
+      contribT() : rho(0.) { }
+
+      contribT& operator+=(const contribT& _c)
+      {
+         rho += _c.rho;
+         return(*this);
+      }
+
+      fType rho;
+   };
+
+   void operator()(const _partT* const _i,
+                   const _partT* const _j,
+                   const vect3dT&,
+                   const fType _rr,
+                   contribT& _ci,
+                   contribT& _cj)
+   {
+      const fType r   = sqrt(_rr);
+      const fType hij = 0.5 * (_i->h + _j->h);
+      const fType Wij = K.value(r, hij);
+
+      _ci.rho = _j->m * Wij;
+      _cj.rho = _i->m * Wij;
+   }
+
+   void postSum(_partT* const _i, const contribT& _c)
+   {
+      _i->rho = _c.rho;
+   }
+};
+
+template<typename _partT, typename _krnlT>
+struct accPowPairSum
+{
+   _krnlT K;
+
+   class contribT {
+public:
+      contribT()
+      {
+         acc = 0., 0., 0.;
+#ifdef SPHLATCH_TIMEDEP_ENERGY
+         dudt = 0.;
+#endif
+#ifdef SPHLATCH_TRACK_UAV
+         dudtav = 0.;
+#endif
+#ifdef SPHLATCH_VELDIV
+         divv = 0.;
+#endif
+#ifdef SPHLATCH_NONEIGH
+         noneigh = 0;
+#endif
+      }
+
+      contribT& operator+=(const contribT& _c)
+      {
+         acc += _c.acc;
+#ifdef SPHLATCH_TIMEDEP_ENERGY
+         dudt += _c.dudt;
+#endif
+#ifdef SPHLATCH_TRACK_UAV
+         dudtav += _c.dudtav;
+#endif
+#ifdef SPHLATCH_VELDIV
+         divv += _c.divv;
+#endif
+#ifdef SPHLATCH_NONEIGH
+         noneigh += _c.noneigh;
+#endif
+         return(*this);
+      }
+
+      vect3dT acc;
+#ifdef SPHLATCH_TIMEDEP_ENERGY
+      fType   dudt;
+#endif
+#ifdef SPHLATCH_TRACK_UAV
+      fType   dudtav;
+#endif
+#ifdef SPHLATCH_VELDIV
+      fType   divv;
+#endif
+#ifdef SPHLATCH_NONEIGH
+      cType   noneigh;
+#endif
+   };
+
+   ///
+   /// the artificial viscosity and the pressure term are symmetric
+   /// in i and j, the kernel gradient changes its sign
+   ///
+   void operator()(const _partT* const _i,
+                   const _partT* const _j,
+                   const vect3dT& _rvec,
+                   const fType _rr,
+                   contribT& _ci,
+                   contribT& _cj)
+   {
+      //FIXME: that doesn't belong here
+      const fType alpha = 1.;
+      const fType beta  = 2.;
+
+      const fType r   = sqrt(_rr);
+      const fType hij = 0.5 * (_i->h + _j->h);
+
+      const fType rhoi = _i->rho, rhoj = _j->rho;
+      const fType mi   = _i->m, mj = _j->m;
+
+      const vect3dT vij    = _i->vel - _j->vel;
+      const fType   vijrij = dot(_rvec, vij);
+
+      fType av = 0.;
+
+      if (vijrij < 0.)
+      {
+         const fType cij  = 0.5 * (_i->cs + _j->cs);
+         const fType muij = hij * vijrij / (_rr + 0.01 * hij * hij);
+
+         const fType rhoij = 0.5 * (rhoi + rhoj);
+         av = (-alpha * cij * muij + beta * muij * muij) / rhoij;
+      }
+      K.derive(r, hij, _rvec);
+
+      const fType accTerm = (_i->p / (rhoi * rhoi)) +
+                            (_j->p / (rhoj * rhoj)) + av;
+      _ci.acc = (-mj * accTerm) * K.deriv;
+      _cj.acc = (mi * accTerm) * K.deriv;
+
+#if defined SPHLATCH_VELDIV || defined SPHLATCH_TIMEDEP_ENERGY
+      const fType vijdivWij = dot(vij, K.deriv);
+#endif
+#ifdef SPHLATCH_VELDIV
+      _ci.divv = -mj * vijdivWij / rhoj;
+      _cj.divv = -mi * vijdivWij / rhoi;
+#endif
+#ifdef SPHLATCH_TIMEDEP_ENERGY
+      _ci.dudt = 0.5 * accTerm * mj * vijdivWij;
+      _cj.dudt = 0.5 * accTerm * mi * vijdivWij;
+#endif
+#ifdef SPHLATCH_TRACK_UAV
+      _ci.dudtav = 0.5 * av * mj * vijdivWij;
+      _cj.dudtav = 0.5 * av * mi * vijdivWij;
+#endif
+#ifdef SPHLATCH_NONEIGH
+      _ci.noneigh = 1;
+      _cj.noneigh = 1;
+#endif
+   }
+
+   void postSum(_partT* const _i, const contribT& _c)
+   {
+      _i->acc += _c.acc;
+#ifdef SPHLATCH_TRACK_ACCP
+      _i->accp = _c.acc;
+#endif
+#ifdef SPHLATCH_VELDIV
+      _i->divv = _c.divv;
+#endif
+#ifdef SPHLATCH_TIMEDEP_ENERGY
+      _i->dudt = _c.dudt;
+#endif
+#ifdef SPHLATCH_TRACK_UAV
+      _i->dudtav = _c.dudtav;
+#endif
+#ifdef SPHLATCH_INTEGRATERHO
+      _i->drhodt = -_c.divv * _i->rho;
+#endif
+#ifdef SPHLATCH_NONEIGH
+      _i->noneigh = _c.noneigh;
+#endif
+   }
+};
+#endif
+
 
 template<typename _partT>
 void setDhDt(_partT& _i)
@@ -0,0 +1,322 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the ballistic particles: a moving clump is surrounded by stray
+/// particles, some of them close to the clump, some far away and some
+/// far away but with neighbours. the clump is found at time 0 and the
+/// particles are flagged at a later time, so the clump has to be moved
+/// along. the tree is built from the particles which are not ballistic
+/// and the ballistic ones feel the clump as a point mass. all particles
+/// are compared to the brute force sum over the tree particles.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+#define SPHLATCH_GRAVITY_POTENTIAL
+#define SPHLATCH_NONEIGH
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+#include "clump_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart,
+   public sphlatch::clumpPart
+{
+public:
+   vect3dT accbf;
+   fType   potbf;
+   bool    ballistic;
+
+   ///
+   /// what the particle is expected to be
+   ///
+   bool    expBallistic;
+};
+
+typedef particle   partT;
+
+class partSet {
+public:
+   size_t getNop()
+   {
+      return(parts.size());
+   }
+
+   partT& operator[](const size_t _i)
+   {
+      return(parts[_i]);
+   }
+
+   std::vector<partT> parts;
+};
+
+///
+/// the clumps as the clump finder provides them,
+/// clump 0 holds the particles of no clump
+///
+class clump {
+public:
+   vect3dT pos, vel;
+   fType   m, rc;
+};
+
+class clumpSet {
+public:
+   size_t getNop()
+   {
+      return(clumps.size());
+   }
+
+   clump& operator[](const size_t _i)
+   {
+      return(clumps[_i]);
+   }
+
+   std::vector<clump> clumps;
+};
+
+#include "bhtree_worker_grav.cpp"
+typedef sphlatch::thetaMAC                     macT;
+typedef sphlatch::GravityWorker<macT, partT>   gravT;
+
+#include "ballistic_particles.cpp"
+typedef sphlatch::BallisticParticles<partT>   ballisticT;
+
+partSet  parts;
+clumpSet clumps;
+
+fType rnd()
+{
+   return(2. * (rand() / static_cast<fType>(RAND_MAX)) - 1.);
+}
+
+///
+/// a particle at <_pos> with velocity <_vel>
+///
+void addPart(const vect3dT& _pos, const vect3dT& _vel, const fType _m,
+             const int _cid, const size_t _noneigh, const bool _ballistic)
+{
+   partT p;
+   p.pos          = _pos;
+   p.vel          = _vel;
+   p.m            = _m;
+   p.h            = 0.05;
+   p.id           = parts.parts.size();
+   p.cost         = 1.;
+   p.clumpid      = _cid;
+   p.noneigh      = _noneigh;
+   p.ballistic    = false;
+   p.expBallistic = _ballistic;
+   parts.parts.push_back(p);
+}
+
+///
+/// a random position with a distance between <_rmin> and <_rmax>
+///
+vect3dT randomPos(const vect3dT& _cen, const fType _rmin, const fType _rmax)
+{
+   vect3dT dir;
+   fType   dd;
+   do
+   {
+      dir = rnd(), rnd(), rnd();
+      dd  = dot(dir, dir);
+   } while (dd > 1. || dd < 1.e-6);
+
+   const fType r = _rmin + 0.5 * (rnd() + 1.) * (_rmax - _rmin);
+   return(_cen + (r / sqrt(dd)) * dir);
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 2)
+   {
+      std::cerr << "usage: ballistic (<noParts>)\n";
+      return(1);
+   }
+
+   size_t nop = 20000;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+
+   const fType bfact = 3., time = 2., G = 1.;
+
+   ///
+   /// the clump of radius 1 at the origin moves with vel, it is
+   /// found at time 0 and the particles are flagged at <time>
+   ///
+   srand(1);
+   vect3dT vel, cen0, cen;
+   vel  = 0.3, -0.1, 0.2;
+   cen0 = 0., 0., 0.;
+   cen  = cen0 + time * vel;
+
+   const size_t noClump = 9 * nop / 10;
+   for (size_t i = 0; i < noClump; i++)
+      addPart(randomPos(cen, 0., 1.), vel, 1. / noClump, 1, 40, false);
+
+   ///
+   /// stray particles close to the clump, far away with neighbours
+   /// and far away without. their masses are negligible, so the
+   /// brute force field is the one of the clump alone
+   ///
+   const size_t noStray = nop - noClump;
+   vect3dT      zero;
+   zero = 0., 0., 0.;
+   for (size_t i = 0; i < noStray; i++)
+   {
+      const fType m = 1.e-9;
+      switch (i % 3)
+      {
+      case 0:
+         addPart(randomPos(cen, 1.2, 0.9 * bfact), zero, m, 0, 0, false);
+         break;
+
+      case 1:
+         addPart(randomPos(cen, 1.1 * bfact, 20.), zero, m, 0, 2, false);
+         break;
+
+      default:
+         addPart(randomPos(cen, 1.1 * bfact, 20.), zero, m, 0, 1, true);
+      }
+   }
+   nop = parts.getNop();
+
+   clump none, body;
+   none.m   = 0.;
+   body.pos = 0., 0., 0.;
+   body.m   = 0.;
+   for (size_t i = 0; i < noClump; i++)
+   {
+      body.pos += parts[i].m * (parts[i].pos - time * vel);
+      body.m   += parts[i].m;
+   }
+   body.pos /= body.m;
+   body.vel  = vel;
+   body.rc   = 1.;
+   clumps.clumps.push_back(none);
+   clumps.clumps.push_back(body);
+
+   ///
+   /// flag the particles, a second flagging changes nothing
+   ///
+   ballisticT ballistic;
+   ballistic.setClumpsTime(0.);
+   const bool changedFrst = ballistic.flag(parts, clumps, time, bfact);
+   const bool changedScnd = ballistic.flag(parts, clumps, time, bfact);
+
+   size_t noWrong = 0, noBallistic = 0;
+   for (size_t i = 0; i < nop; i++)
+   {
+      if (parts[i].ballistic != parts[i].expBallistic)
+         noWrong++;
+      if (parts[i].ballistic)
+         noBallistic++;
+   }
+   std::cout << noBallistic << " ballistic particles, " << noWrong
+             << " wrongly flagged, " << ballistic.treeParts.getNop()
+             << " in the tree\n";
+
+   ///
+   /// the brute force sum over the tree particles
+   ///
+#pragma omp parallel for
+   for (int i = 0; i < static_cast<int>(nop); i++)
+   {
+      vect3dT accbf;
+      fType   potbf = 0.;
+      accbf = 0., 0., 0.;
+      for (size_t j = 0; j < nop; j++)
+      {
+         if (static_cast<size_t>(i) != j && not parts[j].ballistic)
+         {
+            const vect3dT rv = parts[i].pos - parts[j].pos;
+            const fType   rr = dot(rv, rv);
+            const fType   r  = sqrt(rr);
+            accbf -= (parts[j].m / (rr * r)) * rv;
+            potbf -= parts[j].m / r;
+         }
+      }
+      parts[i].accbf = G * accbf;
+      parts[i].potbf = G * potbf;
+   }
+
+   treeT& Tree(treeT::instance());
+   Tree.setExtent(ballistic.treeParts.getBox() * 1.1);
+   Tree.build(ballistic.treeParts);
+   Tree.update(0.8, 1.2);
+   Tree.freeze();
+   Tree.releaseCells();
+
+   for (size_t i = 0; i < nop; i++)
+   {
+      parts[i].acc = 0., 0., 0.;
+      parts[i].pot = 0.;
+   }
+
+   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+   const int           noCZbottomLoc = CZbottomLoc.size();
+   gravT               gravWorker(&Tree, G, macT(0.6));
+#pragma omp parallel for firstprivate(gravWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      gravWorker.calcAcc(CZbottomLoc[i], true);
+   ballistic.calcAcc(parts, clumps, time, G, true);
+   Tree.clear();
+
+   ///
+   /// the mean relative error of the tree particles and the largest
+   /// one of the ballistic particles. a ballistic particle gets no
+   /// acceleration from the tree and a tree particle none from the
+   /// clumps, otherwise they would count twice.
+   ///
+   fType meanErrT = 0., maxErrB = 0., maxPotErrB = 0.;
+   for (size_t i = 0; i < nop; i++)
+   {
+      const vect3dT dacc = parts[i].acc - parts[i].accbf;
+      const fType   err  = sqrt(dot(dacc, dacc) /
+                                dot(parts[i].accbf, parts[i].accbf));
+      if (parts[i].ballistic)
+      {
+         const fType perr = fabs((parts[i].pot - parts[i].potbf) /
+                                 parts[i].potbf);
+         maxErrB    = err > maxErrB ? err : maxErrB;
+         maxPotErrB = perr > maxPotErrB ? perr : maxPotErrB;
+      }
+      else
+         meanErrT += err;
+   }
+   meanErrT /= (nop - noBallistic);
+   std::cout << "tree particles      acc err mean " << meanErrT << "\n"
+             << "ballistic particles acc err max " << maxErrB
+             << ", pot err max " << maxPotErrB << "\n";
+
+   ///
+   /// the point mass misses the higher moments of the clump,
+   /// which are small at more than ballisticfactor clump radii
+   ///
+   const bool passed = changedFrst && (not changedScnd) && (noWrong == 0) &&
+                       (noBallistic > 0) &&
+                       (ballistic.treeParts.getNop() == nop - noBallistic) &&
+                       (meanErrT < 2.e-3) && (maxErrB < 1.e-3) &&
+                       (maxPotErrB < 1.e-3);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
@@ -141,8 +141,10 @@ void derive()
             const fType   mj = parts[j].m;
 
 #ifdef SPHLATCH_GRAVITY_SPLINESMOOTHING
+            typedef sphlatch::gravScalarT<fType>   scalarT;
             const fType hj   = parts[j].h;
-            const fType mOr3 = mj * gravWorker.splineOSmoR3(r, hj);
+            const fType mOr3 = mj * sphlatch::splineSoftening::OsmoR3(
+               scalarT(r), scalarT(rr), scalarT(hj), scalarT(1. / hj)).v;
 #elif SPHLATCH_GRAVITY_EPSSMOOTHING
             const fType epsj = parts[j].eps;
             const fType re   = r + epsj;
@@ -0,0 +1,286 @@
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the fast multipole gravity against the brute force sum and the
+/// grouped tree walk for growing particle numbers. the time per
+/// particle of the multipole traversal has to stay about constant,
+/// the one of the walk grows with log N. the potentials of a subset
+/// tree holding the smaller body alone are compared to the direct
+/// sum over its particles.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+#define SPHLATCH_GRAVITY_POTENTIAL
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart
+{
+public:
+   vect3dT accbf;
+   fType   potbf, potbfI;
+   int     body;
+};
+
+typedef particle   partT;
+
+#include "bhtree_worker_grav.cpp"
+#include "bhtree_worker_fmm.cpp"
+typedef sphlatch::thetaMAC                     macT;
+typedef sphlatch::GravityWorker<macT, partT>   gravT;
+typedef sphlatch::FMMWorker<partT>             fmmT;
+typedef sphlatch::BHTreeFrozen                 frzT;
+
+std::vector<partT> parts;
+
+class bodySelector {
+public:
+   bodySelector(const int _body) : body(_body) { }
+
+   bool operator()(const sphlatch::treeghoPtrT _part) const
+   {
+      return(static_cast<partT*>(_part)->body == body);
+   }
+
+private:
+   const int body;
+};
+
+///
+/// uniform sphere of <_nop> particles with mass <_m> and radius <_r>
+///
+void addBody(const size_t _nop, const fType _m, const fType _r,
+             const vect3dT& _cen, const int _body)
+{
+   size_t i = 0;
+   while (i < _nop)
+   {
+      vect3dT pos;
+      for (size_t k = 0; k < 3; k++)
+         pos[k] = 2. * (rand() / static_cast<fType>(RAND_MAX)) - 1.;
+      if (dot(pos, pos) > 1.)
+         continue;
+
+      partT p;
+      p.pos  = _cen + _r * pos;
+      p.vel  = 0., 0., 0.;
+      p.m    = _m / _nop;
+      p.h    = _r / pow(static_cast<fType>(_nop), 1. / 3.);
+      p.id   = parts.size();
+      p.cost = 1.;
+      p.body = _body;
+      parts.push_back(p);
+      i++;
+   }
+}
+
+///
+/// the brute force sums of every <_stride>th particle, over all
+/// particles and over the particles of the same body
+///
+void bruteForce(const size_t _stride)
+{
+   const int nop = parts.size();
+#pragma omp parallel for
+   for (int i = 0; i < nop; i += _stride)
+   {
+      vect3dT accbf;
+      fType   potbf = 0., potbfI = 0.;
+      accbf = 0., 0., 0.;
+      for (int j = 0; j < nop; j++)
+      {
+         if (i != j)
+         {
+            const vect3dT rv = parts[i].pos - parts[j].pos;
+            const fType   rr = dot(rv, rv);
+            const fType   r  = sqrt(rr);
+            accbf -= (parts[j].m / (rr * r)) * rv;
+            potbf -= parts[j].m / r;
+            if (parts[i].body == parts[j].body)
+               potbfI -= parts[j].m / r;
+         }
+      }
+      parts[i].accbf  = accbf;
+      parts[i].potbf  = potbf;
+      parts[i].potbfI = potbfI;
+   }
+}
+
+///
+/// the mean and largest relative acceleration error and the largest
+/// relative potential error of every <_stride>th particle
+///
+void calcErrors(const size_t _stride, fType& _meanErr, fType& _maxErr,
+                fType& _potErr)
+{
+   const size_t nop = parts.size();
+   size_t       nos = 0;
+   _meanErr = _maxErr = _potErr = 0.;
+   for (size_t i = 0; i < nop; i += _stride)
+   {
+      const vect3dT dacc = parts[i].acc - parts[i].accbf;
+      const fType   err  = sqrt(dot(dacc, dacc) /
+                                dot(parts[i].accbf, parts[i].accbf));
+      const fType   perr = fabs((parts[i].pot - parts[i].potbf) /
+                                parts[i].potbf);
+      _meanErr += err;
+      _maxErr   = err > _maxErr ? err : _maxErr;
+      _potErr   = perr > _potErr ? perr : _potErr;
+      nos++;
+   }
+   _meanErr /= nos;
+}
+
+void clearAcc()
+{
+   const size_t nop = parts.size();
+   for (size_t i = 0; i < nop; i++)
+   {
+      parts[i].acc = 0., 0., 0.;
+      parts[i].pot = 0.;
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 2)
+   {
+      std::cerr << "usage: fmm (<maxNoParts>)\n";
+      return(1);
+   }
+
+   size_t maxNop = 200000;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> maxNop;
+   }
+
+   treeT& Tree(treeT::instance());
+   box3dT box;
+   box.cen  = 0.5, 0., 0.;
+   box.size = 3.2;
+
+   vect3dT cenT, cenI;
+   cenT = 0., 0., 0.;
+   cenI = 1.5, 0.2, 0.;
+
+   std::cout << "      nop        fmm    us/part   acc err mean    max"
+             << "        pot err max      walk    us/part"
+             << "   acc err mean    max\n";
+
+   fType maxMean = 0., maxMax = 0., maxPot = 0., maxPotI = 0.;
+   for (size_t nop = maxNop / 8 > 0 ? maxNop / 8 : 1; nop <= maxNop;
+        nop *= 2)
+   {
+      parts.clear();
+      srand(1);
+      addBody(9 * nop / 10, 1., 1., cenT, 1);
+      addBody(nop - 9 * nop / 10, 0.1, 0.5, cenI, 2);
+
+      const size_t stride = nop / 2000 > 0 ? nop / 2000 : 1;
+      bruteForce(stride);
+
+      Tree.clear();
+      Tree.setExtent(box);
+      for (size_t i = 0; i < nop; i++)
+         Tree.insertPart(parts[i]);
+      Tree.update(0.8, 1.2);
+      Tree.freeze();
+      Tree.releaseCells();
+
+      treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+      const int           noCZbottomLoc = CZbottomLoc.size();
+
+      ///
+      /// the multipole traversal
+      ///
+      clearAcc();
+      fmmT fmmWorker(&Tree, 1.);
+
+      double start   = omp_get_wtime();
+      fmmWorker.calcAcc(CZbottomLoc, true);
+      const double fmmTime = omp_get_wtime() - start;
+
+      fType meanErr, maxErr, potErr;
+      calcErrors(stride, meanErr, maxErr, potErr);
+      maxMean = meanErr > maxMean ? meanErr : maxMean;
+      maxMax  = maxErr > maxMax ? maxErr : maxMax;
+      maxPot  = potErr > maxPot ? potErr : maxPot;
+
+      ///
+      /// the potentials of the smaller body alone
+      ///
+      frzT bodyTree;
+      bodyTree.setSubset(Tree.getFrozen(), bodySelector(2));
+      fmmWorker.calcPot(bodyTree);
+      for (size_t i = 0; i < nop; i += stride)
+      {
+         if (parts[i].body != 2)
+            continue;
+         const fType perr = fabs((parts[i].pot - parts[i].potbfI) /
+                                 parts[i].potbfI);
+         maxPotI = perr > maxPotI ? perr : maxPotI;
+      }
+
+      ///
+      /// the grouped tree walk
+      ///
+      clearAcc();
+      gravT gravWorker(&Tree, 1., macT(0.6));
+      gravWorker.setGroupSize(16);
+
+      start = omp_get_wtime();
+#pragma omp parallel for firstprivate(gravWorker)
+      for (int i = 0; i < noCZbottomLoc; i++)
+         gravWorker.calcAcc(CZbottomLoc[i]);
+      const double walkTime = omp_get_wtime() - start;
+
+      fType meanErrW, maxErrW, potErrW;
+      calcErrors(stride, meanErrW, maxErrW, potErrW);
+
+      std::cout << std::fixed << std::setprecision(3)
+                << " " << std::setw(8) << nop
+                << " " << std::setw(9) << fmmTime << "s"
+                << " " << std::setw(9) << 1.e6 * fmmTime / nop
+                << std::scientific << std::setprecision(2)
+                << "   " << meanErr << " " << maxErr
+                << "   " << potErr
+                << std::fixed << std::setprecision(3)
+                << " " << std::setw(9) << walkTime << "s"
+                << " " << std::setw(9) << 1.e6 * walkTime / nop
+                << std::scientific << std::setprecision(2)
+                << "   " << meanErrW << " " << maxErrW << "\n";
+   }
+   Tree.clear();
+
+   std::cout << "subset tree pot err max " << maxPotI << "\n";
+
+   ///
+   /// the walk at this opening angle has about the same mean error.
+   /// the expansions end at the quadrupoles, so single particles at
+   /// the border of a sink get errors of some percent at theta 0.5.
+   ///
+   const bool passed = (maxMean < 2.e-3) && (maxMax < 5.e-2) &&
+                       (maxPot < 1.e-3) && (maxPotI < 1.e-3);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
@@ -0,0 +1,230 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the relative force errors of the opening criteria against the
+/// brute force sum, on the dynamic tree and on the frozen tree with
+/// single and grouped walks. bmax on the frozen tree is the extent
+/// of the particles and smaller than the cell size, so bmaxMAC needs
+/// a smaller opening angle for the same errors. the relative
+/// criterion gets the brute force acceleration as the previous
+/// acceleration aold, its errors have to stay below alpha.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart
+{
+public:
+   vect3dT accbf;
+   fType   aold;
+};
+
+typedef particle   partT;
+
+#include "bhtree_worker_grav.cpp"
+
+std::vector<partT> parts;
+
+///
+/// uniform sphere of <_nop> particles with mass <_m> and radius <_r>
+///
+void addBody(const size_t _nop, const fType _m, const fType _r,
+             const vect3dT& _cen)
+{
+   size_t i = 0;
+   while (i < _nop)
+   {
+      vect3dT pos;
+      for (size_t k = 0; k < 3; k++)
+         pos[k] = 2. * (rand() / static_cast<fType>(RAND_MAX)) - 1.;
+      if (dot(pos, pos) > 1.)
+         continue;
+
+      partT p;
+      p.pos  = _cen + _r * pos;
+      p.vel  = 0., 0., 0.;
+      p.m    = _m / _nop;
+      p.h    = _r / pow(static_cast<fType>(_nop), 1. / 3.);
+      p.id   = parts.size();
+      p.cost = 1.;
+      p.aold = 0.;
+      parts.push_back(p);
+      i++;
+   }
+}
+
+void buildTree(const bool _freeze)
+{
+   treeT& Tree(treeT::instance());
+
+   box3dT box;
+   box.cen  = 0.5, 0., 0.;
+   box.size = 3.2;
+   Tree.setExtent(box);
+
+   const size_t nop = parts.size();
+   for (size_t i = 0; i < nop; i++)
+      Tree.insertPart(parts[i]);
+   Tree.update(0.8, 1.2);
+   if (_freeze)
+      Tree.freeze();
+}
+
+///
+/// the mean and the largest relative acceleration error of every
+/// <_stride>th particle with the criterion <_MAC> for walks with
+/// <_groupSize> particles, a group size of 0 walks the dynamic tree
+///
+template<typename _macT>
+void calcErrors(const _macT& _MAC, const size_t _groupSize,
+                const size_t _stride, fType& _meanErr, fType& _maxErr)
+{
+   typedef sphlatch::GravityWorker<_macT, partT>   gravT;
+
+   buildTree(_groupSize > 0);
+
+   treeT& Tree(treeT::instance());
+   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+   const int           noCZbottomLoc = CZbottomLoc.size();
+
+   const size_t nop = parts.size();
+   for (size_t i = 0; i < nop; i++)
+      parts[i].acc = 0., 0., 0.;
+
+   gravT gravWorker(&Tree, 1., _MAC);
+   gravWorker.setGroupSize(_groupSize);
+
+   const double start = omp_get_wtime();
+#pragma omp parallel for firstprivate(gravWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      gravWorker.calcAcc(CZbottomLoc[i]);
+   const double time = omp_get_wtime() - start;
+   Tree.clear();
+
+   size_t nos = 0;
+   _meanErr = _maxErr = 0.;
+   for (size_t i = 0; i < nop; i += _stride)
+   {
+      const vect3dT dacc = parts[i].acc - parts[i].accbf;
+      const fType   err  = sqrt(dot(dacc, dacc) /
+                                dot(parts[i].accbf, parts[i].accbf));
+
+      _meanErr += err;
+      _maxErr   = err > _maxErr ? err : _maxErr;
+      nos++;
+   }
+   _meanErr /= nos;
+
+   std::cout << "   group size " << _groupSize << ": acc err mean "
+             << _meanErr << " max " << _maxErr << ", walk " << time << "s\n";
+}
+
+///
+/// the largest mean and maximal error over the dynamic
+/// tree and the single and grouped frozen walks
+///
+template<typename _macT>
+void checkMAC(const _macT& _MAC, const size_t _stride,
+              fType& _meanErr, fType& _maxErr)
+{
+   const size_t groupSizes[3] = { 0, 1, 16 };
+
+   _meanErr = _maxErr = 0.;
+   for (size_t g = 0; g < 3; g++)
+   {
+      fType meanErr, maxErr;
+      calcErrors(_MAC, groupSizes[g], _stride, meanErr, maxErr);
+      _meanErr = meanErr > _meanErr ? meanErr : _meanErr;
+      _maxErr  = maxErr > _maxErr ? maxErr : _maxErr;
+   }
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 2)
+   {
+      std::cerr << "usage: macs (<noParts>)\n";
+      return(1);
+   }
+
+   size_t nop = 50000;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+
+   srand(1);
+   vect3dT cenT, cenI;
+   cenT = 0., 0., 0.;
+   cenI = 1.5, 0.2, 0.;
+   addBody(9 * nop / 10, 1., 1., cenT);
+   addBody(nop - 9 * nop / 10, 0.1, 0.5, cenI);
+   nop = parts.size();
+
+   const size_t stride = nop / 2000 > 0 ? nop / 2000 : 1;
+#pragma omp parallel for
+   for (int i = 0; i < static_cast<int>(nop); i += stride)
+   {
+      vect3dT accbf;
+      accbf = 0., 0., 0.;
+      for (size_t j = 0; j < nop; j++)
+      {
+         if (static_cast<size_t>(i) != j)
+         {
+            const vect3dT rv = parts[i].pos - parts[j].pos;
+            const fType   rr = dot(rv, rv);
+            const fType   r  = sqrt(rr);
+            accbf -= (parts[j].m / (rr * r)) * rv;
+         }
+      }
+      parts[i].accbf = accbf;
+      parts[i].aold  = sqrt(dot(accbf, accbf));
+   }
+
+   ///
+   /// the particles without a brute force acceleration
+   /// get the one of the closest particle with one
+   ///
+   for (size_t i = 0; i < nop; i++)
+      parts[i].aold = parts[i - i % stride].aold;
+
+   const fType theta = 0.6, thetaB = 0.4, alpha = 0.002;
+   fType       meanT, maxT, meanB, maxB, meanR, maxR;
+
+   std::cout << "thetaMAC, theta " << theta << "\n";
+   checkMAC(sphlatch::thetaMAC(theta), stride, meanT, maxT);
+   std::cout << "bmaxMAC, theta " << thetaB << "\n";
+   checkMAC(sphlatch::bmaxMAC(thetaB), stride, meanB, maxB);
+   std::cout << "relativeMAC, alpha " << alpha << "\n";
+   checkMAC(sphlatch::relativeMAC(theta, alpha, 1.), stride, meanR, maxR);
+
+   ///
+   /// the bounds of the geometric criteria for quadrupoles at
+   /// these opening angles, the relative criterion by alpha
+   ///
+   const bool passed = (meanT < 2.e-3) && (maxT < 2.e-2) &&
+                       (meanB < 2.e-3) && (maxB < 2.e-2) &&
+                       (meanR < alpha) && (maxR < 2. * alpha);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
@@ -0,0 +1,239 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// accuracy of the single precision interaction lists: the grouped
+/// walk on the frozen tree is done once with double and once with
+/// float lists and both are compared to the brute force sum. only
+/// the lists are float, the frozen tree stays in double. the
+/// particles are set up in cgs units, two bodies of the mass of the
+/// earth and of mars, to cover the range of the moments.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+#define SPHLATCH_GRAVITY_POTENTIAL
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart
+{
+public:
+   vect3dT accbf;
+   fType   potbf;
+};
+
+typedef particle   partT;
+
+#include "bhtree_worker_grav.cpp"
+typedef sphlatch::fixThetaMAC                                 macT;
+typedef sphlatch::GravityWorker<macT, partT,
+                                sphlatch::quadrupoles, double>   gravDT;
+typedef sphlatch::GravityWorker<macT, partT,
+                                sphlatch::quadrupoles, float>    gravFT;
+
+std::vector<partT> parts;
+
+///
+/// uniform sphere of <_nop> particles with mass <_m> and radius <_r>
+///
+void addBody(const size_t _nop, const fType _m, const fType _r,
+             const vect3dT& _cen)
+{
+   size_t i = 0;
+   while (i < _nop)
+   {
+      vect3dT pos;
+      for (size_t k = 0; k < 3; k++)
+         pos[k] = 2. * (rand() / static_cast<fType>(RAND_MAX)) - 1.;
+      if (dot(pos, pos) > 1.)
+         continue;
+
+      partT p;
+      p.pos  = _cen + _r * pos;
+      p.vel  = 0., 0., 0.;
+      p.m    = _m / _nop;
+      p.h    = _r / pow(static_cast<fType>(_nop), 1. / 3.);
+      p.id   = parts.size();
+      p.cost = 1.;
+      parts.push_back(p);
+      i++;
+   }
+}
+
+template<typename _gravT>
+void calcGravity(std::vector<vect3dT>& _acc, std::vector<fType>& _pot,
+                 const size_t _groupSize)
+{
+   treeT& Tree(treeT::instance());
+
+   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+   const int           noCZbottomLoc = CZbottomLoc.size();
+
+   const size_t nop = parts.size();
+   for (size_t i = 0; i < nop; i++)
+      parts[i].acc = 0., 0., 0.;
+
+   _gravT gravWorker(&Tree, 1.);
+   gravWorker.setGroupSize(_groupSize);
+
+   const double start = omp_get_wtime();
+#pragma omp parallel for firstprivate(gravWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      gravWorker.calcAcc(CZbottomLoc[i], true);
+   std::cout << "   walk " << omp_get_wtime() - start << "s\n";
+
+   _acc.resize(nop);
+   _pot.resize(nop);
+   for (size_t i = 0; i < nop; i++)
+   {
+      _acc[i] = parts[i].acc;
+      _pot[i] = parts[i].pot;
+   }
+}
+
+///
+/// relative errors of the accelerations and the potential of every
+/// <_stride>th particle to the brute force sums
+///
+void errors(const std::vector<vect3dT>& _acc, const std::vector<fType>& _pot,
+            const size_t _stride, fType& _meanErr, fType& _maxErr,
+            fType& _maxPotErr)
+{
+   const size_t nop = parts.size();
+   size_t       nos = 0;
+
+   _meanErr = _maxErr = _maxPotErr = 0.;
+   for (size_t i = 0; i < nop; i += _stride)
+   {
+      const vect3dT dacc = _acc[i] - parts[i].accbf;
+      const fType   err  = sqrt(dot(dacc, dacc) /
+                                dot(parts[i].accbf, parts[i].accbf));
+      const fType   perr = fabs((_pot[i] - parts[i].potbf) / parts[i].potbf);
+
+      _meanErr  += err;
+      _maxErr    = err > _maxErr ? err : _maxErr;
+      _maxPotErr = perr > _maxPotErr ? perr : _maxPotErr;
+      nos++;
+   }
+   _meanErr /= nos;
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 3)
+   {
+      std::cerr << "usage: mixedprec (<noParts>) (<groupSize>)\n";
+      return(1);
+   }
+
+   size_t nop = 100000, groupSize = 16;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+   if (argc > 2)
+   {
+      std::istringstream gsStr(argv[2]);
+      gsStr >> groupSize;
+   }
+
+   ///
+   /// an earth and a mars sized body in contact, in cgs units
+   ///
+   srand(1);
+   vect3dT cenT, cenI;
+   cenT = 0., 0., 0.;
+   cenI = 9.5e8, 0., 0.;
+   addBody(9 * nop / 10, 5.97e27, 6.37e8, cenT);
+   addBody(nop - 9 * nop / 10, 6.42e26, 3.39e8, cenI);
+   nop = parts.size();
+
+   const size_t stride = nop / 1000 > 0 ? nop / 1000 : 1;
+#pragma omp parallel for
+   for (int i = 0; i < static_cast<int>(nop); i += stride)
+   {
+      vect3dT accbf;
+      fType   potbf = 0.;
+      accbf = 0., 0., 0.;
+      for (size_t j = 0; j < nop; j++)
+      {
+         if (static_cast<size_t>(i) != j)
+         {
+            const vect3dT rv = parts[i].pos - parts[j].pos;
+            const fType   rr = dot(rv, rv);
+            const fType   r  = sqrt(rr);
+            accbf -= (parts[j].m / (rr * r)) * rv;
+            potbf -= parts[j].m / r;
+         }
+      }
+      parts[i].accbf = accbf;
+      parts[i].potbf = potbf;
+   }
+
+   treeT& Tree(treeT::instance());
+   box3dT box;
+   box.cen  = 0.3e8, 0., 0.;
+   box.size = 2.2e9;
+   Tree.setExtent(box);
+   for (size_t i = 0; i < nop; i++)
+      Tree.insertPart(parts[i]);
+   Tree.update(0.8, 1.2);
+   Tree.freeze();
+
+   std::vector<vect3dT> accD, accF;
+   std::vector<fType>   potD, potF;
+   fType meanD, maxD, maxPotD, meanF, maxF, maxPotF;
+
+   std::cout << "double lists\n";
+   calcGravity<gravDT>(accD, potD, groupSize);
+   errors(accD, potD, stride, meanD, maxD, maxPotD);
+   std::cout << "   acc err mean " << meanD << " max " << maxD
+             << ", pot err max " << maxPotD << "\n";
+
+   std::cout << "float lists\n";
+   calcGravity<gravFT>(accF, potF, groupSize);
+   errors(accF, potF, stride, meanF, maxF, maxPotF);
+   std::cout << "   acc err mean " << meanF << " max " << maxF
+             << ", pot err max " << maxPotF << "\n";
+
+   ///
+   /// the rounding error of the float lists, relative
+   /// to the result with the double lists
+   ///
+   fType maxRound = 0.;
+   for (size_t i = 0; i < nop; i++)
+   {
+      const vect3dT dacc = accF[i] - accD[i];
+      const fType   err  = sqrt(dot(dacc, dacc) / dot(accD[i], accD[i]));
+      maxRound = err > maxRound ? err : maxRound;
+   }
+   std::cout << "rounding err max " << maxRound << "\n";
+
+   Tree.clear();
+
+   ///
+   /// the rounding of the float lists is about 2e-5 for the default
+   /// setup, which is two orders of magnitude below the MAC error
+   ///
+   const bool passed = (maxRound < 5.e-5) &&
+                       (meanF < 1.01 * meanD) && (maxF < 1.01 * maxD);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
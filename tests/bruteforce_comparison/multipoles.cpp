@@ -0,0 +1,215 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the accuracy of the frozen tree walks for the multipole orders
+/// 2 (quadrupoles), 3 (octupoles) and 4 (hexadecapoles) against the
+/// brute force sum. the opening angle is the same for all orders, so
+/// the error has to fall with every order. the particles are two
+/// bodies with a centrally condensed density profile, which gives
+/// the cells strong higher moments.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+#define SPHLATCH_GRAVITY_POTENTIAL
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart
+{
+public:
+   vect3dT accbf;
+   fType   potbf;
+};
+
+typedef particle   partT;
+
+#include "bhtree_worker_grav.cpp"
+typedef sphlatch::thetaMAC                                        macT;
+typedef sphlatch::GravityWorker<macT, partT, sphlatch::quadrupoles>
+                                                                  grav2T;
+typedef sphlatch::GravityWorker<macT, partT, sphlatch::octupoles>
+                                                                  grav3T;
+typedef sphlatch::GravityWorker<macT, partT, sphlatch::hexadecapoles>
+                                                                  grav4T;
+
+std::vector<partT> parts;
+
+///
+/// a body of <_nop> particles with mass <_m> and radius <_r>, the
+/// density falls with the square of the distance to the center
+///
+void addBody(const size_t _nop, const fType _m, const fType _r,
+             const vect3dT& _cen)
+{
+   size_t i = 0;
+   while (i < _nop)
+   {
+      vect3dT dir;
+      for (size_t k = 0; k < 3; k++)
+         dir[k] = 2. * (rand() / static_cast<fType>(RAND_MAX)) - 1.;
+      const fType dd = dot(dir, dir);
+      if (dd > 1. || dd < 1.e-6)
+         continue;
+
+      partT p;
+      p.pos  = _cen + (_r * (rand() / static_cast<fType>(RAND_MAX)) /
+                       sqrt(dd)) * dir;
+      p.vel  = 0., 0., 0.;
+      p.m    = _m / _nop;
+      p.h    = _r / pow(static_cast<fType>(_nop), 1. / 3.);
+      p.id   = parts.size();
+      p.cost = 1.;
+      parts.push_back(p);
+      i++;
+   }
+}
+
+///
+/// mean and largest relative error of the accelerations
+/// and the potential of every <_stride>th particle
+///
+template<typename _gravT>
+void calcErrors(const fType _theta, const size_t _stride,
+                fType& _meanErr, fType& _maxErr, fType& _meanPotErr)
+{
+   treeT& Tree(treeT::instance());
+
+   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+   const int           noCZbottomLoc = CZbottomLoc.size();
+
+   const size_t nop = parts.size();
+   for (size_t i = 0; i < nop; i++)
+   {
+      parts[i].acc = 0., 0., 0.;
+      parts[i].pot = 0.;
+   }
+
+   _gravT gravWorker(&Tree, 1., macT(_theta));
+
+   const double start = omp_get_wtime();
+#pragma omp parallel for firstprivate(gravWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      gravWorker.calcAcc(CZbottomLoc[i], true);
+   std::cout << "   walk " << omp_get_wtime() - start << "s\n";
+
+   size_t nos = 0;
+   _meanErr = _maxErr = _meanPotErr = 0.;
+   for (size_t i = 0; i < nop; i += _stride)
+   {
+      const vect3dT dacc = parts[i].acc - parts[i].accbf;
+      const fType   err  = sqrt(dot(dacc, dacc) /
+                                dot(parts[i].accbf, parts[i].accbf));
+
+      _meanErr    += err;
+      _maxErr      = err > _maxErr ? err : _maxErr;
+      _meanPotErr += fabs((parts[i].pot - parts[i].potbf) / parts[i].potbf);
+      nos++;
+   }
+   _meanErr    /= nos;
+   _meanPotErr /= nos;
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 3)
+   {
+      std::cerr << "usage: multipoles (<noParts>) (<theta>)\n";
+      return(1);
+   }
+
+   size_t nop   = 50000;
+   fType  theta = 0.7;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+   if (argc > 2)
+   {
+      std::istringstream thetaStr(argv[2]);
+      thetaStr >> theta;
+   }
+
+   srand(1);
+   vect3dT cenT, cenI;
+   cenT = 0., 0., 0.;
+   cenI = 1.5, 0.2, 0.;
+   addBody(4 * nop / 5, 1., 1., cenT);
+   addBody(nop - 4 * nop / 5, 0.1, 0.5, cenI);
+   nop = parts.size();
+
+   const size_t stride = nop / 2000 > 0 ? nop / 2000 : 1;
+#pragma omp parallel for
+   for (int i = 0; i < static_cast<int>(nop); i += stride)
+   {
+      vect3dT accbf;
+      fType   potbf = 0.;
+      accbf = 0., 0., 0.;
+      for (size_t j = 0; j < nop; j++)
+      {
+         if (static_cast<size_t>(i) != j)
+         {
+            const vect3dT rv = parts[i].pos - parts[j].pos;
+            const fType   rr = dot(rv, rv);
+            const fType   r  = sqrt(rr);
+            accbf -= (parts[j].m / (rr * r)) * rv;
+            potbf -= parts[j].m / r;
+         }
+      }
+      parts[i].accbf = accbf;
+      parts[i].potbf = potbf;
+   }
+
+   treeT& Tree(treeT::instance());
+   box3dT box;
+   box.cen  = 0.5, 0., 0.;
+   box.size = 3.2;
+   Tree.setExtent(box);
+   Tree.setMultipoleOrder(4);
+   for (size_t i = 0; i < nop; i++)
+      Tree.insertPart(parts[i]);
+   Tree.update(0.8, 1.2);
+   Tree.freeze();
+
+   fType mean[3], max[3], potErr[3];
+
+   std::cout << "quadrupoles\n";
+   calcErrors<grav2T>(theta, stride, mean[0], max[0], potErr[0]);
+   std::cout << "octupoles\n";
+   calcErrors<grav3T>(theta, stride, mean[1], max[1], potErr[1]);
+   std::cout << "hexadecapoles\n";
+   calcErrors<grav4T>(theta, stride, mean[2], max[2], potErr[2]);
+   Tree.clear();
+
+   for (size_t o = 0; o < 3; o++)
+      std::cout << "order " << o + 2 << ": acc err mean " << mean[o]
+                << " max " << max[o] << ", pot err mean " << potErr[o]
+                << "\n";
+
+   ///
+   /// every order has to reduce the mean errors clearly
+   ///
+   bool passed = true;
+   for (size_t o = 1; o < 3; o++)
+      passed = passed && (mean[o] < 0.7 * mean[o - 1]) &&
+               (potErr[o] < 0.7 * potErr[o - 1]);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
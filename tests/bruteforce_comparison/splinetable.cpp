@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+///
+/// the tabulated spline softening against the analytic one. the
+/// table is linear in q = u^2, so its intervals in u are widest and
+/// the q^(3/2) term is least linear at small u. the relative errors
+/// of OsmoR3 and OsmoR1 are checked on a grid in u, which is denser
+/// towards u = 0, for the table in double and in float precision.
+///
+
+#include "typedefs.h"
+typedef sphlatch::fType   fType;
+
+#include "bhtree_grav_softening.cpp"
+
+///
+/// the largest relative errors on [0,_umax) of the table in
+/// the precision <_realT> for the softening length <_h>
+///
+template<typename _realT>
+void tableErrors(const double _umax, const double _h,
+                 double& _errR3, double& _errR1)
+{
+   typedef sphlatch::gravScalarT<double>   scalarT;
+   typedef sphlatch::gravScalarT<_realT>   tscalarT;
+
+   const size_t noSteps = 100000;
+   const double Oh      = 1. / _h;
+
+   _errR3 = _errR1 = 0.;
+   for (size_t i = 1; i < noSteps; i++)
+   {
+      const double s  = static_cast<double>(i) / noSteps;
+      const double u  = _umax * s * s;
+      const double r  = u * _h;
+      const double rr = r * r;
+
+      const double aR3 = sphlatch::splineSoftening::OsmoR3(
+         scalarT(r), scalarT(rr), scalarT(_h), scalarT(Oh)).v;
+      const double aR1 = sphlatch::splineSoftening::OsmoR1(
+         scalarT(r), scalarT(rr), scalarT(_h), scalarT(Oh)).v;
+
+      const double tR3 = sphlatch::splineTableSoftening::OsmoR3(
+         tscalarT(r), tscalarT(rr), tscalarT(_h), tscalarT(Oh)).v;
+      const double tR1 = sphlatch::splineTableSoftening::OsmoR1(
+         tscalarT(r), tscalarT(rr), tscalarT(_h), tscalarT(Oh)).v;
+
+      const double eR3 = fabs(tR3 - aR3) / aR3;
+      const double eR1 = fabs(tR1 - aR1) / aR1;
+      _errR3 = eR3 > _errR3 ? eR3 : _errR3;
+      _errR1 = eR1 > _errR1 ? eR1 : _errR1;
+   }
+}
+
+int main()
+{
+   const double h = 3.7e7;
+
+   ///
+   /// the analytic policy itself: continuous at u = 1 and
+   /// u = 2 and the limits of the B spline kernel at u = 0
+   ///
+   typedef sphlatch::gravScalarT<double>   scalarT;
+   double maxJump = 0.;
+   for (double u = 1.; u < 2.5; u += 1.)
+   {
+      const double rl = (1. - 1.e-12) * u * h, ru = (1. + 1.e-12) * u * h;
+      const double l3 = sphlatch::splineSoftening::OsmoR3(
+         scalarT(rl), scalarT(rl * rl), scalarT(h), scalarT(1. / h)).v;
+      const double u3 = sphlatch::splineSoftening::OsmoR3(
+         scalarT(ru), scalarT(ru * ru), scalarT(h), scalarT(1. / h)).v;
+      const double l1 = sphlatch::splineSoftening::OsmoR1(
+         scalarT(rl), scalarT(rl * rl), scalarT(h), scalarT(1. / h)).v;
+      const double u1 = sphlatch::splineSoftening::OsmoR1(
+         scalarT(ru), scalarT(ru * ru), scalarT(h), scalarT(1. / h)).v;
+      maxJump = std::max(maxJump, std::max(fabs(u3 - l3) / l3,
+                                           fabs(u1 - l1) / l1));
+   }
+   const double r0  = 1.e-9 * h;
+   const double c3  = sphlatch::splineSoftening::OsmoR3(
+      scalarT(r0), scalarT(r0 * r0), scalarT(h), scalarT(1. / h)).v;
+   const double c1  = sphlatch::splineSoftening::OsmoR1(
+      scalarT(r0), scalarT(r0 * r0), scalarT(h), scalarT(1. / h)).v;
+   const double cerr = std::max(fabs(c3 * h * h * h - 4. / 3.) / (4. / 3.),
+                                fabs(c1 * h - 7. / 5.) / (7. / 5.));
+   std::cout << "analytic: jump at u = 1,2 " << maxJump
+             << ", centre err " << cerr << "\n";
+
+   double dR3, dR1, dR3s, dR1s, fR3, fR1, fR3s, fR1s;
+   tableErrors<double>(2.5, h, dR3, dR1);
+   tableErrors<double>(0.1, h, dR3s, dR1s);
+   tableErrors<float>(2.5, h, fR3, fR1);
+   tableErrors<float>(0.1, h, fR3s, fR1s);
+
+   std::cout << "double table: OsmoR3 err " << dR3 << " (u < 0.1: " << dR3s
+             << "), OsmoR1 err " << dR1 << " (u < 0.1: " << dR1s << ")\n"
+             << "float  table: OsmoR3 err " << fR3 << " (u < 0.1: " << fR3s
+             << "), OsmoR1 err " << fR1 << " (u < 0.1: " << fR1s << ")\n";
+
+   ///
+   /// the interpolation error of the 1024 intervals has
+   /// to stay well below the error of the multipole walks
+   ///
+   const bool passed = (maxJump < 1.e-9) && (cerr < 1.e-9) &&
+                       (dR3 < 2.e-5) && (dR1 < 2.e-6) &&
+                       (fR3 < 2.e-5) && (fR1 < 2.e-6);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
@@ -0,0 +1,224 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the potentials of single clumps from subset trees: the frozen tree
+/// of all particles is reduced to the members of a clump with
+/// BHTreeFrozen::setSubset() and the walks are split up over the nodes
+/// of getCover(), as in the output step of simple_sph. the potentials
+/// of the members and the potential energy of the clump are compared
+/// to the direct sum over the members alone, the potentials of the
+/// other particles have to stay untouched.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+#define SPHLATCH_GRAVITY_POTENTIAL
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart
+{
+public:
+   fType potbf;
+   int   clumpid;
+};
+
+typedef particle   partT;
+
+#include "bhtree_worker_grav.cpp"
+typedef sphlatch::thetaMAC                     macT;
+typedef sphlatch::GravityWorker<macT, partT>   gravT;
+typedef sphlatch::BHTreeFrozen                 frzT;
+
+std::vector<partT> parts;
+
+class clumpSelector {
+public:
+   clumpSelector(const int _cid) : cid(_cid) { }
+
+   bool operator()(const sphlatch::treeghoPtrT _part) const
+   {
+      return(static_cast<partT*>(_part)->clumpid == cid);
+   }
+
+private:
+   const int cid;
+};
+
+///
+/// uniform sphere of <_nop> particles with mass <_m>
+/// and radius <_r>, belonging to clump <_cid>
+///
+void addBody(const size_t _nop, const fType _m, const fType _r,
+             const vect3dT& _cen, const int _cid)
+{
+   size_t i = 0;
+   while (i < _nop)
+   {
+      vect3dT pos;
+      for (size_t k = 0; k < 3; k++)
+         pos[k] = 2. * (rand() / static_cast<fType>(RAND_MAX)) - 1.;
+      if (dot(pos, pos) > 1.)
+         continue;
+
+      partT p;
+      p.pos     = _cen + _r * pos;
+      p.vel     = 0., 0., 0.;
+      p.m       = _m / _nop;
+      p.h       = _r / pow(static_cast<fType>(_nop), 1. / 3.);
+      p.id      = parts.size();
+      p.cost    = 1.;
+      p.clumpid = _cid;
+      parts.push_back(p);
+      i++;
+   }
+}
+
+///
+/// the clump potentials with walks of <_groupSize> particles,
+/// returns the largest relative error of a member potential and
+/// sets the relative error of the potential energy
+///
+fType checkClump(const int _cid, const size_t _groupSize, fType& _EpotErr)
+{
+   treeT& Tree(treeT::instance());
+
+   const size_t nop = parts.size();
+   for (size_t i = 0; i < nop; i++)
+      parts[i].pot = 1.;
+
+   gravT gravWorker(&Tree, 1., macT(0.6));
+   gravWorker.setGroupSize(_groupSize);
+
+   frzT clumpTree;
+   clumpTree.setSubset(Tree.getFrozen(), clumpSelector(_cid));
+
+   const std::vector<frzT::idxT> cover =
+      clumpTree.getCover(clumpTree.noParts[0] / 256 + 1);
+   const int noCover = cover.size();
+#pragma omp parallel for firstprivate(gravWorker) schedule(dynamic)
+   for (int j = 0; j < noCover; j++)
+      gravWorker.calcPot(clumpTree, cover[j]);
+
+   fType  maxErr = 0., Epot = 0., EpotBF = 0.;
+   size_t noMembers = 0, noTouched = 0;
+   for (size_t i = 0; i < nop; i++)
+   {
+      if (parts[i].clumpid != _cid)
+      {
+         if (parts[i].pot != 1.)
+            noTouched++;
+         continue;
+      }
+      const fType err = fabs((parts[i].pot - parts[i].potbf) /
+                             parts[i].potbf);
+      maxErr  = err > maxErr ? err : maxErr;
+      Epot   += 0.5 * parts[i].m * parts[i].pot;
+      EpotBF += 0.5 * parts[i].m * parts[i].potbf;
+      noMembers++;
+   }
+   _EpotErr = fabs((Epot - EpotBF) / EpotBF);
+
+   std::cout << "   clump " << _cid << ", group size " << _groupSize
+             << ": " << noMembers << " members in " << clumpTree.size()
+             << " nodes, " << noCover << " walks, pot err max " << maxErr
+             << ", Epot err " << _EpotErr << "\n";
+
+   if (noTouched > 0)
+   {
+      std::cout << "   potential of " << noTouched
+                << " other particles changed\n";
+      return(1.);
+   }
+   return(maxErr);
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 2)
+   {
+      std::cerr << "usage: subsetpot (<noParts>)\n";
+      return(1);
+   }
+
+   size_t nop = 50000;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+
+   ///
+   /// two bodies in contact and particles which
+   /// belong to no clump spread around them
+   ///
+   srand(1);
+   vect3dT cenT, cenI, cenB;
+   cenT = 0., 0., 0.;
+   cenI = 1.4, 0.2, 0.;
+   cenB = 0.5, 0., 0.;
+   addBody(8 * nop / 10, 1., 1., cenT, 1);
+   addBody(nop / 10, 0.1, 0.5, cenI, 2);
+   addBody(nop - 9 * nop / 10, 0.01, 1.5, cenB, 0);
+   nop = parts.size();
+
+#pragma omp parallel for
+   for (int i = 0; i < static_cast<int>(nop); i++)
+   {
+      fType potbf = 0.;
+      for (size_t j = 0; j < nop; j++)
+      {
+         if (static_cast<size_t>(i) != j &&
+             parts[i].clumpid == parts[j].clumpid)
+         {
+            const vect3dT rv = parts[i].pos - parts[j].pos;
+            potbf -= parts[j].m / sqrt(dot(rv, rv));
+         }
+      }
+      parts[i].potbf = potbf;
+   }
+
+   treeT& Tree(treeT::instance());
+   box3dT box;
+   box.cen  = 0.5, 0., 0.;
+   box.size = 3.2;
+   Tree.setExtent(box);
+   for (size_t i = 0; i < nop; i++)
+      Tree.insertPart(parts[i]);
+   Tree.update(0.8, 1.2);
+   Tree.freeze();
+   Tree.releaseCells();
+
+   fType maxErr = 0., maxEpotErr = 0.;
+   for (int cid = 1; cid < 3; cid++)
+   {
+      for (size_t groupSize = 1; groupSize < 32; groupSize *= 16)
+      {
+         fType       EpotErr;
+         const fType err = checkClump(cid, groupSize, EpotErr);
+         maxErr     = err > maxErr ? err : maxErr;
+         maxEpotErr = EpotErr > maxEpotErr ? EpotErr : maxEpotErr;
+      }
+   }
+   Tree.clear();
+
+   const bool passed = (maxErr < 1.e-3) && (maxEpotErr < 1.e-4);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
@@ -1,10 +1,9 @@
 #include <iostream>
 #include <vector>
+#include <cstdlib>
 
 #include <omp.h>
 
-#define SPHLATCH_PADD64
-
 #include "bhtree.cpp"
 #include "typedefs.h"
 
@@ -14,12 +13,13 @@ typedef sphlatch::gcllT       gcllT;
 typedef sphlatch::mcllT       mcllT;
 typedef sphlatch::qcllT       qcllT;
 typedef sphlatch::czllT       czllT;
+typedef sphlatch::czdtT       czdtT;
 
 typedef sphlatch::treeGhost   partT;
 
 typedef sphlatch::BHTree      treeT;
 
-int main()
+int main(int argc, char* argv[])
 {
    std::cout << " generic   node " << sizeof(nodeT) << "   "
              << (sizeof(nodeT) % 64 ) << "\n"
@@ -33,8 +33,60 @@ int main()
              << (sizeof(qcllT) % 64 ) << "\n"
              << " CZ   cell node " << sizeof(czllT) << "   " 
              << (sizeof(czllT) % 64 ) << "\n"
+             << " CZ   cell data " << sizeof(czdtT) << "   " 
+             << (sizeof(czdtT) % 64 ) << "\n"
              << " particle       " << sizeof(partT) << "   " 
              << (sizeof(partT) % 64 ) << "\n";
 
+   ///
+   /// build trees of random particles with different
+   /// bucket sizes and report the memory per particle
+   ///
+   const size_t nop = argc > 1 ? atoi(argv[1]) : 1000000;
+
+   std::vector<partT> parts(nop);
+   for (size_t i = 0; i < nop; i++)
+   {
+      parts[i].pos = rand() / static_cast<sphlatch::fType>(RAND_MAX),
+                     rand() / static_cast<sphlatch::fType>(RAND_MAX),
+                     rand() / static_cast<sphlatch::fType>(RAND_MAX);
+      parts[i].m    = 1. / nop;
+      parts[i].cost = 1. / nop;
+      parts[i].id   = i;
+   }
+
+   treeT& Tree(treeT::instance());
+   sphlatch::box3dT box;
+   box.cen  = 0.5, 0.5, 0.5;
+   box.size = 1.01;
+
+   ///
+   /// the cells and the frozen tree both exist at the freeze, this is
+   /// the peak. releasing the cells afterwards does not lower it.
+   ///
+   std::cout << "\n " << nop << " particles\n"
+             << " bucket size   nodes B/part   frozen B/part"
+             << "   peak B/part\n";
+   for (size_t bucketSize = 1; bucketSize <= treeT::maxBucketSize;
+        bucketSize *= 2)
+   {
+      Tree.clear();
+      Tree.setExtent(box);
+      Tree.setBucketSize(bucketSize);
+      for (size_t i = 0; i < nop; i++)
+         Tree.insertPart(parts[i]);
+      Tree.update(0.8, 1.2);
+      Tree.freeze();
+
+      const double nodeMem   = Tree.getNodeMemory();
+      const double frozenMem = Tree.getFrozenMemory();
+      const double peakMem   = nodeMem + frozenMem;
+
+      std::cout << " " << bucketSize << "             "
+                << nodeMem / nop << "          "
+                << frozenMem / nop << "          "
+                << peakMem / nop << "\n";
+   }
+
    return(0);
 }
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the distances to the k-th nearest neighbour from the KNNWorker
+/// on the frozen tree have to match those of a brute force search.
+/// the particles are clustered, so the search radii vary strongly.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart
+{ };
+
+typedef particle   partT;
+
+class partSet {
+public:
+   size_t getNop()
+   {
+      return(parts.size());
+   }
+
+   partT& operator[](const size_t _i)
+   {
+      return(parts[_i]);
+   }
+
+   std::vector<partT> parts;
+};
+
+#include "bhtree_worker_neighfunc.cpp"
+typedef sphlatch::KNNWorker<partT>          knnT;
+typedef sphlatch::SmoLenFindWorker<partT>   smolT;
+
+partSet parts;
+
+fType rnd()
+{
+   return(rand() / static_cast<fType>(RAND_MAX));
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 3)
+   {
+      std::cerr << "usage: knn (<noParts>) (<k>)\n";
+      return(1);
+   }
+
+   size_t nop = 100000, k = 50;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+   if (argc > 2)
+   {
+      std::istringstream kStr(argv[2]);
+      kStr >> k;
+   }
+
+   ///
+   /// half of the particles in a unit cube, the other
+   /// half in a small dense cube in one corner
+   ///
+   srand(1);
+   parts.parts.resize(nop);
+   for (size_t i = 0; i < nop; i++)
+   {
+      const fType scale = i % 2 == 0 ? 1. : 0.05;
+      parts[i].pos     = scale * rnd(), scale * rnd(), scale * rnd();
+      parts[i].vel     = 0., 0., 0.;
+      parts[i].m       = 1. / nop;
+      parts[i].h       = 0.;
+      parts[i].id      = i;
+      parts[i].cost    = 1. / nop;
+      parts[i].noneigh = k - 1;
+   }
+
+   treeT& Tree(treeT::instance());
+   box3dT box;
+   box.cen  = 0.5, 0.5, 0.5;
+   box.size = 1.2;
+   Tree.setExtent(box);
+   Tree.build(parts);
+   Tree.update(0.8, 1.2);
+   Tree.freeze();
+
+   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+   const int           noCZbottomLoc = CZbottomLoc.size();
+
+   smolT        smolWorker(&Tree, 1.);
+   const double start = omp_get_wtime();
+#pragma omp parallel for firstprivate(smolWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      smolWorker(CZbottomLoc[i]);
+   std::cout << "knn search " << omp_get_wtime() - start << "s\n";
+
+   ///
+   /// compare every 1000th particle to the brute force search,
+   /// the particle itself is its nearest neighbour
+   ///
+   const size_t stride = nop / 1000 > 0 ? nop / 1000 : 1;
+   fType        maxErr = 0.;
+   std::vector<fType> rr(nop);
+   for (size_t i = 0; i < nop; i += stride)
+   {
+      for (size_t j = 0; j < nop; j++)
+      {
+         const vect3dT rvec = parts[i].pos - parts[j].pos;
+         rr[j] = dot(rvec, rvec);
+      }
+      std::nth_element(rr.begin(), rr.begin() + (k - 1), rr.end());
+
+      const fType err = fabs(parts[i].h - sqrt(rr[k - 1])) / sqrt(rr[k - 1]);
+      maxErr = err > maxErr ? err : maxErr;
+   }
+   std::cout << "max rel. error " << maxErr << "\n";
+
+   ///
+   /// the sorted neighbour set of one particle
+   ///
+   typedef sphlatch::BHTreeFrozen   frzT;
+   const frzT& frz(Tree.getFrozen());
+   frzT::idxT  idx = 0;
+   while (frz.part[idx] != &parts[0])
+      idx++;
+
+   knnT              knnWorker(&Tree);
+   const fType       kdist = knnWorker(idx, k);
+   const knnT::pptrDLT& neighs(knnWorker.getNeighbours());
+
+   bool sorted = (neighs.size() == k) && (neighs[0].ptr == &parts[0]) &&
+                 (sqrt(neighs[k - 1].rr) == kdist);
+   for (size_t i = 1; i < neighs.size(); i++)
+      sorted = sorted && (neighs[i - 1].rr <= neighs[i].rr);
+   std::cout << "neighbour set " << (sorted ? "sorted" : "not sorted") << "\n";
+
+   Tree.clear();
+
+   const bool passed = (maxErr < 1.e-14) && sorted;
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
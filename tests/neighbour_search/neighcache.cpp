@@ -0,0 +1,194 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the density sum over the cached neighbour lists has to give the
+/// same densities as the tree walk, also after the particles have
+/// moved by less than the skin. a larger move has to invalidate
+/// the lists.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart
+{ };
+
+typedef particle   partT;
+
+class partSet {
+public:
+   size_t getNop()
+   {
+      return(parts.size());
+   }
+
+   partT& operator[](const size_t _i)
+   {
+      return(parts[_i]);
+   }
+
+   std::vector<partT> parts;
+};
+
+#include "sph_algorithms.cpp"
+#include "sph_kernels.cpp"
+#include "bhtree_worker_sphsum.cpp"
+typedef sphlatch::CubicSpline3D                  krnlT;
+typedef sphlatch::densSum<partT, krnlT>          densT;
+typedef sphlatch::SPHsumWorker<densT, partT>     densSumT;
+typedef sphlatch::NeighListCache<partT>          neighCacheT;
+
+partSet parts;
+
+fType rnd()
+{
+   return(rand() / static_cast<fType>(RAND_MAX));
+}
+
+void buildTree()
+{
+   treeT& Tree(treeT::instance());
+
+   box3dT box;
+   box.cen  = 0.5, 0.5, 0.5;
+   box.size = 1.2;
+   Tree.setExtent(box);
+   Tree.build(parts);
+   Tree.update(0.8, 1.2);
+   Tree.freeze();
+}
+
+///
+/// the densities with the tree walk and with the cache,
+/// returns the largest relative difference
+///
+fType compare(neighCacheT& _cache)
+{
+   treeT& Tree(treeT::instance());
+
+   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+   const int           noCZbottomLoc = CZbottomLoc.size();
+   const size_t        nop           = parts.getNop();
+
+   densSumT densWorker(&Tree);
+
+   double start = omp_get_wtime();
+#pragma omp parallel for firstprivate(densWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      densWorker(CZbottomLoc[i]);
+   std::cout << "   tree walk  " << omp_get_wtime() - start << "s\n";
+
+   std::vector<fType> rhoT(nop);
+   for (size_t i = 0; i < nop; i++)
+      rhoT[i] = parts[i].rho;
+
+   start = omp_get_wtime();
+#pragma omp parallel for firstprivate(densWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      densWorker(CZbottomLoc[i], _cache);
+   std::cout << "   cached sum " << omp_get_wtime() - start << "s\n";
+
+   fType maxDiff = 0.;
+   for (size_t i = 0; i < nop; i++)
+   {
+      const fType diff = fabs(parts[i].rho - rhoT[i]) / rhoT[i];
+      maxDiff = diff > maxDiff ? diff : maxDiff;
+   }
+   std::cout << "   max rel. difference " << maxDiff << "\n";
+   return(maxDiff);
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 2)
+   {
+      std::cerr << "usage: neighcache (<noParts>)\n";
+      return(1);
+   }
+
+   size_t nop = 100000;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+
+   ///
+   /// a unit cube with smoothing lengths for about
+   /// 50 neighbours, varied by up to 20%
+   ///
+   srand(1);
+   const fType hmean = pow(50. / (4.19 * 8. * nop), 1. / 3.);
+   parts.parts.resize(nop);
+   for (size_t i = 0; i < nop; i++)
+   {
+      parts[i].pos  = rnd(), rnd(), rnd();
+      parts[i].vel  = 0., 0., 0.;
+      parts[i].m    = 1. / nop;
+      parts[i].h    = hmean * (0.9 + 0.2 * rnd());
+      parts[i].id   = i;
+      parts[i].cost = 1. / nop;
+   }
+
+   treeT&      Tree(treeT::instance());
+   neighCacheT cache;
+   cache.setSkin(0.2);
+
+   buildTree();
+   treeT::czllPtrVectT CZbottomLoc = Tree.getCZbottomLoc();
+   const double        start       = omp_get_wtime();
+   cache.build(Tree, CZbottomLoc, parts);
+   std::cout << "build " << omp_get_wtime() - start << "s, "
+             << cache.neigh.size() / static_cast<fType>(nop)
+             << " neighbours per particle\n";
+
+   std::cout << "at build\n";
+   const fType diffBuild = compare(cache);
+   Tree.clear();
+
+   ///
+   /// move the particles by less than a quarter of the skin
+   ///
+   for (size_t i = 0; i < nop; i++)
+   {
+      vect3dT dir;
+      dir = rnd() - 0.5, rnd() - 0.5, rnd() - 0.5;
+      parts[i].pos += (0.1 * 0.2 * parts[i].h / sqrt(dot(dir, dir))) * dir;
+   }
+   const bool validSmall = cache.isValid(parts);
+
+   buildTree();
+   std::cout << "after small move (valid " << validSmall << ")\n";
+   const fType diffMoved = compare(cache);
+   Tree.clear();
+
+   ///
+   /// one particle moved by the skin invalidates the lists
+   ///
+   parts[0].pos[0] += 0.4 * parts[0].h;
+   const bool validLarge = cache.isValid(parts);
+   std::cout << "after large move (valid " << validLarge << ")\n";
+
+   const bool passed = validSmall && (not validLarge) &&
+                       (diffBuild < 1.e-14) && (diffMoved < 1.e-14);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
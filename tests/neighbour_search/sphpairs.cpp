@@ -0,0 +1,225 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+///
+/// the symmetric sums over the pair lists have to give the same
+/// densities and accelerations as the sums over the neighbours of
+/// each particle, up to the rounding of the summation order.
+///
+
+#include <omp.h>
+#define SPHLATCH_OPENMP
+#define SPHLATCH_VELDIV
+#define SPHLATCH_TIMEDEP_ENERGY
+#define SPHLATCH_NONEIGH
+
+#include "typedefs.h"
+typedef sphlatch::fType     fType;
+typedef sphlatch::vect3dT   vect3dT;
+typedef sphlatch::box3dT    box3dT;
+
+#include "bhtree.cpp"
+typedef sphlatch::BHTree    treeT;
+
+#include "bhtree_particle.h"
+#include "sph_fluid_particle.h"
+
+class particle :
+   public sphlatch::treePart,
+   public sphlatch::movingPart,
+   public sphlatch::SPHfluidPart,
+   public sphlatch::energyPart,
+   public sphlatch::varHPart
+{ };
+
+typedef particle   partT;
+
+class partSet {
+public:
+   size_t getNop()
+   {
+      return(parts.size());
+   }
+
+   partT& operator[](const size_t _i)
+   {
+      return(parts[_i]);
+   }
+
+   std::vector<partT> parts;
+};
+
+#include "sph_algorithms.cpp"
+#include "sph_kernels.cpp"
+#include "bhtree_worker_sphsum.cpp"
+#include "bhtree_worker_sphpair.cpp"
+typedef sphlatch::CubicSpline3D                      krnlT;
+typedef sphlatch::densSum<partT, krnlT>              densT;
+typedef sphlatch::SPHsumWorker<densT, partT>         densSumT;
+typedef sphlatch::accPowSum<partT, krnlT>            accPowT;
+typedef sphlatch::SPHsumWorker<accPowT, partT>       accPowSumT;
+typedef sphlatch::densPairSum<partT, krnlT>          densPairT;
+typedef sphlatch::SPHpairWorker<densPairT, partT>    densPairSumT;
+typedef sphlatch::accPowPairSum<partT, krnlT>        accPowPairT;
+typedef sphlatch::SPHpairWorker<accPowPairT, partT>  accPowPairSumT;
+typedef sphlatch::NeighListCache<partT>              neighCacheT;
+
+partSet parts;
+
+fType rnd()
+{
+   return(rand() / static_cast<fType>(RAND_MAX));
+}
+
+fType relDiff(const fType _a, const fType _b, const fType _scale)
+{
+   return(fabs(_a - _b) / _scale);
+}
+
+int main(int argc, char* argv[])
+{
+   if (argc > 2)
+   {
+      std::cerr << "usage: sphpairs (<noParts>)\n";
+      return(1);
+   }
+
+   size_t nop = 100000;
+   if (argc > 1)
+   {
+      std::istringstream nopStr(argv[1]);
+      nopStr >> nop;
+   }
+
+   ///
+   /// a unit cube with smoothing lengths varied by up to 50%, every
+   /// second particle has the same one, so there are pairs with equal
+   /// smoothing lengths. a converging velocity field and random
+   /// pressures
+   ///
+   srand(1);
+   const fType hmean = pow(50. / (4.19 * 8. * nop), 1. / 3.);
+   parts.parts.resize(nop);
+   for (size_t i = 0; i < nop; i++)
+   {
+      parts[i].pos  = rnd(), rnd(), rnd();
+      parts[i].vel  = 0.5 - parts[i].pos;
+      parts[i].vel += 0.1 * (rnd() - 0.5);
+      parts[i].m    = 1. / nop;
+      parts[i].h    = i % 2 ? hmean * (0.75 + 0.5 * rnd()) : hmean;
+      parts[i].p    = 1. + rnd();
+      parts[i].cs   = 1.;
+      parts[i].id   = i;
+      parts[i].cost = 1. / nop;
+   }
+
+   treeT& Tree(treeT::instance());
+   box3dT box;
+   box.cen  = 0.5, 0.5, 0.5;
+   box.size = 1.2;
+   Tree.setExtent(box);
+   Tree.build(parts);
+   Tree.update(0.8, 1.2);
+   Tree.freeze();
+
+   treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
+   const int           noCZbottomLoc = CZbottomLoc.size();
+
+   ///
+   /// the neighbour lists for the sums over the neighbours and
+   /// the pair lists for the symmetric sums, both from one search
+   ///
+   neighCacheT cache, pairCache;
+   double      start = omp_get_wtime();
+   cache.build(Tree, CZbottomLoc, parts);
+   std::cout << "build           " << omp_get_wtime() - start << "s, "
+             << cache.neigh.size() << " neighbours\n";
+
+   start = omp_get_wtime();
+   pairCache.buildPairs(Tree, CZbottomLoc, parts);
+   std::cout << "buildPairs      " << omp_get_wtime() - start << "s, "
+             << pairCache.pairNeigh.size() << " pairs\n";
+
+   ///
+   /// the sums over the neighbours of each particle
+   ///
+   densSumT   densWorker(&Tree);
+   accPowSumT accPowWorker(&Tree);
+
+   start = omp_get_wtime();
+#pragma omp parallel for firstprivate(densWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      densWorker(CZbottomLoc[i], cache);
+   for (size_t i = 0; i < nop; i++)
+      parts[i].acc = 0., 0., 0.;
+#pragma omp parallel for firstprivate(accPowWorker)
+   for (int i = 0; i < noCZbottomLoc; i++)
+      accPowWorker(CZbottomLoc[i], cache);
+   std::cout << "neighbour sums  " << omp_get_wtime() - start << "s\n";
+
+   std::vector<fType>   rhoN(nop), dudtN(nop), divvN(nop);
+   std::vector<vect3dT> accN(nop);
+   std::vector<size_t>  noneighN(nop);
+   for (size_t i = 0; i < nop; i++)
+   {
+      rhoN[i]     = parts[i].rho;
+      accN[i]     = parts[i].acc;
+      dudtN[i]    = parts[i].dudt;
+      divvN[i]    = parts[i].divv;
+      noneighN[i] = parts[i].noneigh;
+   }
+
+   ///
+   /// the symmetric sums, the pressure force is
+   /// calculated with the new densities again
+   ///
+   densPairSumT   densPairWorker(&Tree);
+   accPowPairSumT accPowPairWorker(&Tree);
+
+   start = omp_get_wtime();
+   densPairWorker(CZbottomLoc, pairCache);
+   for (size_t i = 0; i < nop; i++)
+      parts[i].acc = 0., 0., 0.;
+   accPowPairWorker(CZbottomLoc, pairCache);
+   std::cout << "pair sums       " << omp_get_wtime() - start << "s\n";
+
+   fType accScale = 0., dudtScale = 0., divvScale = 0.;
+   for (size_t i = 0; i < nop; i++)
+   {
+      accScale  += sqrt(dot(accN[i], accN[i]));
+      dudtScale += fabs(dudtN[i]);
+      divvScale += fabs(divvN[i]);
+   }
+   accScale  /= nop;
+   dudtScale /= nop;
+   divvScale /= nop;
+
+   fType  maxRho = 0., maxAcc = 0., maxDudt = 0., maxDivv = 0.;
+   size_t noneighDiff = 0;
+   for (size_t i = 0; i < nop; i++)
+   {
+      const vect3dT dacc = parts[i].acc - accN[i];
+      maxRho  = std::max(maxRho, relDiff(parts[i].rho, rhoN[i], rhoN[i]));
+      maxAcc  = std::max(maxAcc, sqrt(dot(dacc, dacc)) / accScale);
+      maxDudt = std::max(maxDudt, relDiff(parts[i].dudt, dudtN[i], dudtScale));
+      maxDivv = std::max(maxDivv, relDiff(parts[i].divv, divvN[i], divvScale));
+      if (static_cast<size_t>(parts[i].noneigh) != noneighN[i])
+         noneighDiff++;
+   }
+   std::cout << "max rel. difference rho " << maxRho
+             << ", acc " << maxAcc
+             << ", dudt " << maxDudt
+             << ", divv " << maxDivv
+             << ", " << noneighDiff << " different neighbour counts\n";
+
+   Tree.clear();
+
+   const bool passed = (maxRho < 1.e-12) && (maxAcc < 1.e-10) &&
+                       (maxDudt < 1.e-10) && (maxDivv < 1.e-10) &&
+                       (noneighDiff == 0);
+   std::cout << (passed ? "passed\n" : "FAILED\n");
+   return(passed ? 0 : 1);
+}
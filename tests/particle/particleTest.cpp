@@ -59,9 +59,6 @@ public:
       _tmp     = _swpPart;
       _swpPart = *this;
       *this    = _tmp;
-
-      _swpPart.treeNode->partPtr = &_swpPart;
-      treeNode->partPtr          = this;
    }
 };
 
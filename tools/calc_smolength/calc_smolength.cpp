@@ -115,6 +115,7 @@ int main(int argc, char* argv[])
    }
 
    Tree.update(0.8, 1.2);
+   Tree.freeze();
 
    treeT::czllPtrVectT CZbottomLoc   = Tree.getCZbottomLoc();
    const int           noCZbottomLoc = CZbottomLoc.size();
@@ -276,7 +276,6 @@ int main(int argc, char* argv[])
                parts[j].m = parts[j].morig;
             else
                parts[j].m = 0.;
-            parts[j].treeNode->update();
          }
 
          Tree.redoMultipoles();